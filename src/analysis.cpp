@@ -1,205 +1,144 @@
 #include "analysis.h"
 
-#include "parser.h"
 #include "error.h"
 
 namespace nova {
 
-void Analysis::buildSymbolTable() {
-    Func pre_func = [this](AstPtr node) {
-        if (node->getAstType() == AstType::kVariable) {
-            VariableAstPtr ptr = std::dynamic_pointer_cast<VariableAst>(node);
-            if (ptr) {
-                symbol_table_.insert(ptr->name(), ptr->getTokenLocation());
-            }
-        }
-    };
+namespace {
 
-    traversal(root_, pre_func, Func());
+void expectType(ExpressionType actual, ExpressionType expected) {
+    if (actual != expected) {
+        errorSyntax("cannot convert from '" + expressionTypeName(actual) + "' to '" + 
+                    expressionTypeName(expected) + "'");
+    }
 }
 
-void Analysis::typeCheck() {
-    Func post_func = std::bind(&Analysis::checkNode, this, std::placeholders::_1);
-    traversal(root_, Func(), post_func);
+// type of a binary expression, kVoid if the operands do not fit
+ExpressionType binaryType(TokenValue op, ExpressionType left, ExpressionType right) {
+    if (op == TokenValue::kEqual || op == TokenValue::kLess) {
+        return ExpressionType::kBoolean;
+    } 
+    if (left == ExpressionType::kInteger && right == ExpressionType::kInteger) {
+        return ExpressionType::kInteger;
+    }
+    errorSyntax("cannot covert from '" + expressionTypeName(right) + "' to '" + expressionTypeName(left) + "'");
+    return ExpressionType::kVoid;
 }
- 
-void Analysis::traversal(AstPtr node, Func pre_func, Func post_func) {
-    while (node != nullptr) {
-        if (pre_func) {
-            pre_func(node);   
-        }
 
-        switch (node->getAstType()) {
-            case AstType::kIf: {
-                IfStatementAstPtr ptr = std::dynamic_pointer_cast<IfStatementAst>(node);
-                if (ptr) {
-                    traversal(ptr->testPart(), pre_func, post_func);
-                    traversal(ptr->thenPart(), pre_func, post_func);
-                    if (ptr->elsePart()) {
-                        traversal(ptr->elsePart(), pre_func, post_func);      
-                    }
-                }
-                break;
-            }
-
-            case AstType::kRepeat: {
-                RepeatStatementAstPtr ptr = std::dynamic_pointer_cast<RepeatStatementAst>(node);
-                if (ptr) {
-                    traversal(ptr->bodyPart(), pre_func, post_func);
-                    traversal(ptr->testPart(), pre_func, post_func);
-                }
-                break;
-            }
-
-            case AstType::kAssign: {
-                AssignStatementAstPtr ptr = std::dynamic_pointer_cast<AssignStatementAst>(node);
-                if (ptr) {
-                    traversal(ptr->variable(), pre_func, post_func);
-                    traversal(ptr->expression(), pre_func, post_func);
-                }
-                break;
-            }
-
-            case AstType::kRead: {
-                ReadStatementAstPtr ptr = std::dynamic_pointer_cast<ReadStatementAst>(node);
-                if (ptr) {
-                    traversal(ptr->variable(), pre_func, post_func);       
-                }
-                break;
-            }
-
-            case AstType::kWrite: {
-                WriteStatementAstPtr ptr = std::dynamic_pointer_cast<WriteStatementAst>(node);
-                if (ptr) {
-                    traversal(ptr->expression(), pre_func, post_func);                
-                }
-                break;
-            }
-
-            case AstType::kExpression: {
-                ExpressionAstPtr ptr = std::dynamic_pointer_cast<ExpressionAst>(node);
-                if (ptr) {
-                    traversal(ptr->leftPart(), pre_func, post_func);
-                    traversal(ptr->rightPart(), pre_func, post_func);
-                }
-                break;
-            }
-
-            default:
-                break;
-        }
+class FlatSymbolCollector : public FlatAstVisitor<FlatSymbolCollector> {
+public:
+    FlatSymbolCollector(const FlatAst& ast, SymbolTable& symbol_table)
+        : FlatAstVisitor<FlatSymbolCollector>(ast),
+          symbol_table_(symbol_table) {
+    }
 
-        if (post_func) {
-            post_func(node);   
-        }
+    void visitVariable(NodeId node) {
+        symbol_table_.intern(ast().name(node), ast().location(node));
+    }
 
-        node = node->next();
+private:
+    SymbolTable& symbol_table_;
+};
+
+class FlatTypeChecker : public FlatAstVisitor<FlatTypeChecker> {
+public:
+    explicit FlatTypeChecker(FlatAst& ast)
+        : FlatAstVisitor<FlatTypeChecker>(ast),
+          ast_(ast) {
     }
-}
-   
-void Analysis::checkNode(AstPtr node) {
-    switch (node->getAstType()) {
-        case AstType::kVariable:
-        case AstType::kConstant: {
-            node->setExpressionType(ExpressionType::kInteger);
-            break;
-        }
 
-        case AstType::kExpression: {
-            ExpressionAstPtr ptr = std::dynamic_pointer_cast<ExpressionAst>(node);
-            if (ptr) {
-                if (ptr->operatorTokenValue() == TokenValue::kEqual ||
-                    ptr->operatorTokenValue() == TokenValue::kLess) {
-                    ptr->setExpressionType(ExpressionType::kBoolean);   
-                } else {
-                    if (ptr->leftPart()->getExpressionType() == ExpressionType::kInteger &&
-                        ptr->rightPart()->getExpressionType() == ExpressionType::kInteger) {
-                        ptr->setExpressionType(ExpressionType::kInteger);      
-                    } else {
-                        std::string message = "cannot covert from '" + ptr->rightPart()->getExpressionName() +
-                            "' to '" + ptr->leftPart()->getExpressionName() + "'";
-                        errorReport(message);
-                    }
-                }
-            }
-            break;
-        }
+    void visitIf(NodeId node) { expectType(childType(node, 0), ExpressionType::kBoolean); }
+    void visitRepeat(NodeId node) { expectType(childType(node, 1), ExpressionType::kBoolean); }
+    void visitAssign(NodeId node) { expectType(childType(node, 1), ExpressionType::kInteger); }
+    void visitRead(NodeId node) { expectType(childType(node, 0), ExpressionType::kInteger); }
+    void visitWrite(NodeId node) { expectType(childType(node, 0), ExpressionType::kInteger); }
 
-        case AstType::kIf: {
-            IfStatementAstPtr ptr = std::dynamic_pointer_cast<IfStatementAst>(node);
-            if (ptr) {
-                if (ptr->testPart()->getExpressionType() != ExpressionType::kBoolean) {
-                    std::string message = "cannot convert from '" + ptr->testPart()->getExpressionName() + 
-                        "' to 'boolean'";
-                    errorReport(message);
-                }   
-            }
-            break;
+    void visitExpression(NodeId node) {
+        ExpressionType type = binaryType(ast_.op(node), childType(node, 0), childType(node, 1));
+        if (type != ExpressionType::kVoid) {
+            ast_.setType(node, type);
         }
+    }
 
-        case AstType::kRepeat: {
-            RepeatStatementAstPtr ptr = std::dynamic_pointer_cast<RepeatStatementAst>(node);
-            if (ptr) {
-                if (ptr->testPart()->getExpressionType() != ExpressionType::kBoolean) {
-                    std::string message = "cannot convert from '" + ptr->testPart()->getExpressionName() + 
-                        "' to 'boolean'";
-                    errorReport(message);
-                }   
-            }
-            break;
-        }
+    void visitConstant(NodeId node) { ast_.setType(node, ExpressionType::kInteger); }
+    void visitVariable(NodeId node) { ast_.setType(node, ExpressionType::kInteger); }
 
-        case AstType::kAssign: {
-            AssignStatementAstPtr ptr = std::dynamic_pointer_cast<AssignStatementAst>(node);
-            if (ptr) {
-                if (ptr->expression()->getExpressionType() != ExpressionType::kInteger) {
-                    std::string message = "cannot convert from '" + ptr->expression()->getExpressionName() + 
-                        "' to 'integer'";
-                    errorReport(message);
-                }   
-            }
-            break;
-        }
+private:
+    ExpressionType childType(NodeId node, int i) const { return ast_.type(ast_.child(node, i)); }
 
-        case AstType::kRead: {
-            ReadStatementAstPtr ptr = std::dynamic_pointer_cast<ReadStatementAst>(node);
-            if (ptr) {
-                if (ptr->variable()->getExpressionType() != ExpressionType::kInteger) {
-                    std::string message = "cannot convert from '" + ptr->variable()->getExpressionName() + 
-                        "' to 'integer'";
-                    errorReport(message);
-                }   
-            }
-            break;
-        }
+private:
+    FlatAst& ast_;
+};
 
-        case AstType::kWrite: {
-            WriteStatementAstPtr ptr = std::dynamic_pointer_cast<WriteStatementAst>(node);
-            if (ptr) {
-                if (ptr->expression()->getExpressionType() != ExpressionType::kInteger) {
-                    std::string message = "cannot convert from '" + ptr->expression()->getExpressionName() + 
-                        "' to 'integer'";
-                    errorReport(message);
-                }      
-            }
-            break;
-        }
+} // namespace
+
+void TypeChecker::visitIf(IfStatementAstPtr node) { 
+    expectType(node->testPart()->getExpressionType(), ExpressionType::kBoolean); 
+}
+
+void TypeChecker::visitRepeat(RepeatStatementAstPtr node) { 
+    expectType(node->testPart()->getExpressionType(), ExpressionType::kBoolean); 
+}
+
+void TypeChecker::visitAssign(AssignStatementAstPtr node) { 
+    expectType(node->expression()->getExpressionType(), ExpressionType::kInteger); 
+}
+
+void TypeChecker::visitRead(ReadStatementAstPtr node) { 
+    expectType(node->variable()->getExpressionType(), ExpressionType::kInteger); 
+}
+
+void TypeChecker::visitWrite(WriteStatementAstPtr node) { 
+    expectType(node->expression()->getExpressionType(), ExpressionType::kInteger); 
+}
+
+void TypeChecker::visitExpression(ExpressionAstPtr node) {
+    ExpressionType type = binaryType(node->operatorTokenValue(), 
+                                     node->leftPart()->getExpressionType(), 
+                                     node->rightPart()->getExpressionType());
+    if (type != ExpressionType::kVoid) {
+        node->setExpressionType(type);
+    }
+}
+
+void Analysis::analyze() {
+    if (flat_root_ != nullptr) {
+        buildSymbolTable();
+        typeCheck();
+    } else {
+        analyzeTree(root_);
+    }
+    symbols_resolved_ = true;
+}
 
-        default:
-            break;   
+void Analysis::useSymbolTable(SymbolTable& symbol_table) {
+    symbol_table_ = &symbol_table;
+    symbols_resolved_ = true;
+}
+
+void Analysis::buildSymbolTable() {
+    if (flat_root_ != nullptr) {
+        FlatSymbolCollector(*flat_root_, *symbol_table_).traverse(flat_root_->root());
+    } else {
+        SymbolResolver(*symbol_table_).traverse(root_);
     }
+    symbols_resolved_ = true;
 }
 
-void Analysis::errorReport(const std::string& message) {
-    errorSyntax(message);
+void Analysis::typeCheck() {
+    if (flat_root_ != nullptr) {
+        FlatTypeChecker(*flat_root_).traverse(flat_root_->root());
+    } else {
+        TypeChecker().traverse(root_);
+    }
 }
 
 void Analysis::printSymbolTable() const {
-    symbol_table_.printSymbolTable();
+    symbol_table_->printSymbolTable();
 }
 
-int Analysis::lookupSymbolTable(const std::string& name) const {
-    return symbol_table_.lookup(name);
+int Analysis::lookupSymbolTable(StringPiece name) const {
+    return symbol_table_->lookup(name);
 }
 
 } // namespace nova
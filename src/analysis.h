@@ -2,36 +2,111 @@
 #define __NOVA_ANALYSIS_H__
 
 #include "ast.h"
+#include "ast_visitor.h"
+#include "flat_ast.h"
 #include "symbol_table.h"
 
 namespace nova {
 
+// Interns every variable into a symbol table and stores its slot in the node.
+class SymbolResolver : public AstVisitor<SymbolResolver> {
+public:
+    explicit SymbolResolver(SymbolTable& symbol_table)
+        : symbol_table_(symbol_table) {
+    }
+
+    void visitVariable(VariableAstPtr node) {
+        node->setSlot(symbol_table_.intern(node->name(), node->getTokenLocation()));
+    }
+
+private:
+    SymbolTable& symbol_table_;
+};
+
+// Types the expressions bottom-up and reports the statements and operators
+// whose operands have the wrong type.
+class TypeChecker : public AstVisitor<TypeChecker> {
+public:
+    void visitIf(IfStatementAstPtr node);
+    void visitRepeat(RepeatStatementAstPtr node);
+    void visitAssign(AssignStatementAstPtr node);
+    void visitRead(ReadStatementAstPtr node);
+    void visitWrite(WriteStatementAstPtr node);
+    void visitExpression(ExpressionAstPtr node);
+    void visitConstant(ConstantAstPtr node) { node->setExpressionType(ExpressionType::kInteger); }
+    void visitVariable(VariableAstPtr node) { node->setExpressionType(ExpressionType::kInteger); }
+};
+
 class Analysis {
 public:
     explicit Analysis(AstPtr ast_root)
-        : root_(ast_root) {
+        : root_(ast_root),
+          flat_root_(nullptr),
+          symbol_table_(&own_symbol_table_),
+          symbols_resolved_(false) {
+    }
+
+    // analyses the flat layout instead, expression types are stored in it
+    explicit Analysis(FlatAst& flat_ast)
+        : root_(nullptr),
+          flat_root_(&flat_ast),
+          symbol_table_(&own_symbol_table_),
+          symbols_resolved_(false) {
     }
 
     Analysis(const Analysis&) = delete;
     Analysis& operator=(const Analysis&) = delete;
-    
+
+    // The semantic pass in one post-order walk: interns the variables unless
+    // useSymbolTable() says the parser did, types the expressions and reports
+    // type errors. More passes, AstVisitor classes defining the visit*
+    // members they need, can ride along in the same walk; they see each node
+    // after it has been resolved and typed. The flat layout runs its two
+    // passes one after the other.
+    void analyze();
+    template<typename... Passes>
+    void analyze(Passes&... passes) { 
+        analyzeTree(root_, passes...); 
+        symbols_resolved_ = true;
+    }
+    // the semantic pass over one statement, for the streaming pipeline
+    template<typename... Passes>
+    void analyzeStatement(AstPtr statement, Passes&... passes) { analyzeTree(statement, passes...); }
+
+    // the variables were interned into symbol_table while parsing and the
+    // nodes carry their slots, which the analysis uses as they are
+    void useSymbolTable(SymbolTable& symbol_table);
+    // separate passes, interning afresh and type checking
     void buildSymbolTable();
     void typeCheck();
+    // cross-reference mode of the analysis' own symbol table
+    void setRecordLocations(bool record) { own_symbol_table_.setRecordLocations(record); }
     void printSymbolTable() const;
-    int lookupSymbolTable(const std::string& name) const;
+    int lookupSymbolTable(StringPiece name) const;
 
 private:
-    typedef std::function<void (AstPtr)> Func;
-
-    void traversal(AstPtr node, Func pre_func, Func post_func);
-    void checkNode(AstPtr node);
-    void errorReport(const std::string& message);
+    template<typename... Passes>
+    void analyzeTree(AstPtr root, Passes&... passes);
 
 private:
     AstPtr root_;
-    SymbolTable symbol_table_;
+    FlatAst* flat_root_;
+    SymbolTable own_symbol_table_;
+    SymbolTable* symbol_table_;
+    bool symbols_resolved_;
 };
 
+template<typename... Passes>
+void Analysis::analyzeTree(AstPtr root, Passes&... passes) {
+    TypeChecker type_checker;
+    if (symbols_resolved_) {
+        FusedVisitor<TypeChecker, Passes...>(type_checker, passes...).traverse(root);
+    } else {
+        SymbolResolver symbol_resolver(*symbol_table_);
+        FusedVisitor<SymbolResolver, TypeChecker, Passes...>(symbol_resolver, type_checker, passes...).traverse(root);
+    }
+}
+
 } // namespace nova
 
 #endif
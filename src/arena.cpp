@@ -0,0 +1,30 @@
+#include "arena.h"
+
+namespace nova {
+
+char* Arena::newBlock(size_t min_size) {
+    size_t size = min_size > kBlockSize ? min_size : kBlockSize;
+    blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    current_ = blocks_.back().data.get();
+    end_ = current_ + size;
+    return current_;
+}
+
+void Arena::reset() {
+    if (blocks_.size() > 1) {
+        blocks_.resize(1);
+    }
+    current_ = blocks_.empty() ? nullptr : blocks_.front().data.get();
+    end_ = blocks_.empty() ? nullptr : current_ + blocks_.front().size;
+    bytes_allocated_ = 0;
+}
+
+size_t Arena::bytesReserved() const {
+    size_t total = 0;
+    for (const Block& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
+    
+} // namespace nova
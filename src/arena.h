@@ -0,0 +1,76 @@
+#ifndef __NOVA_ARENA_H__
+#define __NOVA_ARENA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace nova {
+
+// Bump allocator. Objects are never destroyed one by one, all memory is
+// released at once when the arena dies, so only trivially destructible
+// types may be created in it.
+class Arena {
+public:
+    static const size_t kBlockSize = 64 * 1024;
+
+    Arena()
+        : current_(nullptr),
+          end_(nullptr),
+          bytes_allocated_(0) {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment) {
+        char* p = align(current_, alignment);
+        // after an oversized block of odd size, aligning may go past end_
+        if (p == nullptr || p > end_ || size > static_cast<size_t>(end_ - p)) {
+            p = align(newBlock(size + alignment), alignment);
+        }
+        current_ = p + size;
+        bytes_allocated_ += size;
+        return p;
+    }
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // releases everything allocated so far, keeping the first block for reuse
+    void reset();
+
+    // bytes handed out and bytes reserved from the system
+    size_t bytesAllocated() const { return bytes_allocated_; }
+    size_t bytesReserved() const;
+
+private:
+    static char* align(char* p, size_t alignment) {
+        uintptr_t mask = alignment - 1;
+        return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + mask) & ~mask);
+    }
+
+    char* newBlock(size_t min_size);
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    char* current_;
+    char* end_;
+    size_t bytes_allocated_;
+};
+    
+} // namespace nova
+
+#endif
@@ -5,11 +5,12 @@ namespace nova {
 Ast::Ast(const TokenLocation& location, AstType type)
     : location_(location), 
       ast_type_(type), 
-      expression_type_(ExpressionType::kVoid) { 
+      expression_type_(ExpressionType::kVoid),
+      next_(nullptr) { 
 }
 
-const std::string Ast::getExpressionName() const {
-    switch (expression_type_) {
+const std::string expressionTypeName(ExpressionType type) {
+    switch (type) {
         case ExpressionType::kVoid:
             return "void";
 
@@ -24,6 +25,10 @@ const std::string Ast::getExpressionName() const {
     } 
 }
 
+const std::string Ast::getExpressionName() const {
+    return expressionTypeName(expression_type_);
+}
+
 IfStatementAst::IfStatementAst(const TokenLocation& location, 
                                AstType type, 
                                AstPtr test_part, 
@@ -65,7 +70,7 @@ WriteStatementAst::WriteStatementAst(const TokenLocation& location, AstType type
 
 ExpressionAst::ExpressionAst(const TokenLocation& location, 
                              AstType type, 
-                             const std::string& name,
+                             StringPiece name,
                              TokenValue token_value,
                              AstPtr left_part, 
                              AstPtr right_part)
@@ -80,7 +85,9 @@ ExpressionAst::ExpressionAst(const TokenLocation& location,
                              AstType type, 
                              AstPtr left_part) 
     : Ast(location, type),
-      left_part_(left_part) { 
+      operator_value_(TokenValue::kUnReserved),
+      left_part_(left_part),
+      right_part_(nullptr) { 
 }
 
 
@@ -89,9 +96,10 @@ ConstantAst::ConstantAst(const TokenLocation& location, AstType type, int64_t va
       int_value_(value) { 
 }
 
-VariableAst::VariableAst(const TokenLocation& location, AstType type, const std::string& var_name)
+VariableAst::VariableAst(const TokenLocation& location, AstType type, StringPiece var_name, int slot)
     : Ast(location, type), 
-      name_(var_name) { 
+      name_(var_name),
+      slot_(slot) { 
 }
 
 } // namespace nova
@@ -2,9 +2,10 @@
 #define __NOVA_AST_H__
 
 #include <string>
-#include <memory>
 
 #include "token.h"
+#include "arena.h"
+#include "symbol_table.h"
 
 namespace nova {
 
@@ -26,6 +27,8 @@ enum class ExpressionType {
     kBoolean,
 };
 
+const std::string expressionTypeName(ExpressionType type);
+
 class Ast;
 class IfStatementAst;
 class RepeatStatementAst;
@@ -36,23 +39,23 @@ class ExpressionAst;
 class ConstantAst;
 class VariableAst;
 
-typedef std::shared_ptr<Ast> AstPtr;
-typedef std::shared_ptr<IfStatementAst> IfStatementAstPtr;
-typedef std::shared_ptr<RepeatStatementAst> RepeatStatementAstPtr;
-typedef std::shared_ptr<AssignStatementAst> AssignStatementAstPtr;
-typedef std::shared_ptr<ReadStatementAst> ReadStatementAstPtr;
-typedef std::shared_ptr<WriteStatementAst> WriteStatementAstPtr;
-typedef std::shared_ptr<ExpressionAst> ExpressionAstPtr;
-typedef std::shared_ptr<ConstantAst> ConstantAstPtr;
-typedef std::shared_ptr<VariableAst> VariableAstPtr;
+// Nodes live in the arena of an AstContext and are released with it.
+typedef Ast* AstPtr;
+typedef IfStatementAst* IfStatementAstPtr;
+typedef RepeatStatementAst* RepeatStatementAstPtr;
+typedef AssignStatementAst* AssignStatementAstPtr;
+typedef ReadStatementAst* ReadStatementAstPtr;
+typedef WriteStatementAst* WriteStatementAstPtr;
+typedef ExpressionAst* ExpressionAstPtr;
+typedef ConstantAst* ConstantAstPtr;
+typedef VariableAst* VariableAstPtr;
 
 class Ast {
 public:
     Ast(const TokenLocation& location, AstType type);
-    virtual ~Ast() = default;
 
     AstType getAstType() const { return ast_type_; }
-    void setNext(const AstPtr& p) { next_ = p; }
+    void setNext(AstPtr p) { next_ = p; }
     AstPtr next() const { return next_; }
     TokenLocation getTokenLocation() const { return location_; }
     void setExpressionType(ExpressionType type) { expression_type_ = type; }
@@ -70,11 +73,13 @@ private:
 class IfStatementAst : public Ast {
 public:
     IfStatementAst(const TokenLocation& location, AstType type, AstPtr test_part, AstPtr then_part, AstPtr else_part);
-    virtual ~IfStatementAst() = default;
    
     AstPtr testPart() const { return test_part_; }
+    void setTestPart(AstPtr test_part) { test_part_ = test_part; }
     AstPtr thenPart() const { return then_part_; }
+    void setThenPart(AstPtr then_part) { then_part_ = then_part; }
     AstPtr elsePart() const { return else_part_; }
+    void setElsePart(AstPtr else_part) { else_part_ = else_part; }
         
 private:
     AstPtr test_part_;
@@ -85,10 +90,11 @@ private:
 class RepeatStatementAst : public Ast {
 public:
     RepeatStatementAst(const TokenLocation& location, AstType type, AstPtr body_part, AstPtr test_part);
-    virtual ~RepeatStatementAst() = default;
 
     AstPtr bodyPart() const { return body_part_; }
+    void setBodyPart(AstPtr body_part) { body_part_ = body_part; }
     AstPtr testPart() const { return test_part_; }
+    void setTestPart(AstPtr test_part) { test_part_ = test_part; }
 
 private:
     AstPtr body_part_;
@@ -98,10 +104,10 @@ private:
 class AssignStatementAst : public Ast {
 public:
     AssignStatementAst(const TokenLocation& location, AstType type, VariableAstPtr var, AstPtr expr);
-    virtual ~AssignStatementAst() = default;
 
     VariableAstPtr variable() const { return variable_; }
     AstPtr expression() const { return expression_; }
+    void setExpression(AstPtr expr) { expression_ = expr; }
 
 private:
     VariableAstPtr variable_;
@@ -111,7 +117,6 @@ private:
 class ReadStatementAst : public Ast {
 public:
     ReadStatementAst(const TokenLocation& location, AstType type, VariableAstPtr var);
-    virtual ~ReadStatementAst() = default;
 
     VariableAstPtr variable() const { return variable_; }
 
@@ -122,9 +127,9 @@ private:
 class WriteStatementAst : public Ast {
 public:
     WriteStatementAst(const TokenLocation& location, AstType type, AstPtr expr);
-    virtual ~WriteStatementAst() = default;
 
     AstPtr expression() const { return expression_; }
+    void setExpression(AstPtr expr) { expression_ = expr; }
 
 private:
     AstPtr expression_;
@@ -135,19 +140,20 @@ public:
     ExpressionAst(const TokenLocation& location, AstType type, AstPtr left_part);
     ExpressionAst(const TokenLocation& location, 
                   AstType type, 
-                  const std::string& name, 
+                  StringPiece name, 
                   TokenValue token_value,
                   AstPtr left_part, 
                   AstPtr right_part);
-    virtual ~ExpressionAst() = default;
 
-    const std::string& operatorName() const { return operator_name_; }
+    StringPiece operatorName() const { return operator_name_; }
     TokenValue operatorTokenValue() const { return operator_value_; }
     AstPtr leftPart() const { return left_part_; }
     AstPtr rightPart() const { return right_part_; }
+    void setLeftPart(AstPtr left_part) { left_part_ = left_part; }
+    void setRightPart(AstPtr right_part) { right_part_ = right_part; }
 
 private:
-    std::string operator_name_;
+    StringPiece operator_name_;
     TokenValue operator_value_;
     AstPtr left_part_;
     AstPtr right_part_;
@@ -156,7 +162,6 @@ private:
 class ConstantAst : public Ast {
 public:
     ConstantAst(const TokenLocation& location, AstType type, int64_t value);
-    virtual ~ConstantAst() = default;
 
     int64_t intValue() const { return int_value_; }
 
@@ -166,13 +171,42 @@ private:
 
 class VariableAst : public Ast {
 public:
-    VariableAst(const TokenLocation& location, AstType type, const std::string& var_name);
-    virtual ~VariableAst() = default;
+    VariableAst(const TokenLocation& location, AstType type, StringPiece var_name, int slot);
+
+    // a view of the source text, kept alive by the FileTable
+    StringPiece name() const { return name_; }
+    // the variable's slot in the SymbolTable it was interned in
+    int slot() const { return slot_; }
+    void setSlot(int slot) { slot_ = slot; }
+
+private:
+    StringPiece name_;
+    int slot_;
+};
+
+// Owns the memory of the AST nodes built during one compilation, all nodes
+// are freed at once when the context is destroyed, and the table the names
+// of their variables are interned in.
+class AstContext {
+public:
+    AstContext() = default;
+    AstContext(const AstContext&) = delete;
+    AstContext& operator=(const AstContext&) = delete;
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        return arena_.make<T>(std::forward<Args>(args)...);
+    }
+
+    // frees every node made so far, the symbols stay
+    void clear() { arena_.reset(); }
+    size_t bytesAllocated() const { return arena_.bytesAllocated(); }
 
-    const std::string& name() const { return name_; }
+    SymbolTable& symbolTable() { return symbol_table_; }
 
 private:
-    std::string name_;
+    Arena arena_;
+    SymbolTable symbol_table_;
 };
     
 } // namespace nova
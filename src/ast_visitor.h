@@ -0,0 +1,130 @@
+#ifndef __NOVA_AST_VISITOR_H__
+#define __NOVA_AST_VISITOR_H__
+
+#include <tuple>
+#include <utility>
+
+#include "ast.h"
+
+namespace nova {
+
+// Post-order walk over a statement sequence of the pointer AST. Nodes are
+// dispatched on their AstType to the visit* member of Derived, which hides
+// the ones it cares about; there are no virtual calls or RTTI involved.
+// Leaves are visited in source order.
+template<typename Derived>
+class AstVisitor {
+public:
+    void traverse(AstPtr node) {
+        for (; node != nullptr; node = node->next()) {
+            switch (node->getAstType()) {
+                case AstType::kIf: {
+                    IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(node);
+                    traverse(ptr->testPart());
+                    traverse(ptr->thenPart());
+                    traverse(ptr->elsePart());
+                    derived().visitIf(ptr);
+                    break;
+                }
+
+                case AstType::kRepeat: {
+                    RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(node);
+                    traverse(ptr->bodyPart());
+                    traverse(ptr->testPart());
+                    derived().visitRepeat(ptr);
+                    break;
+                }
+
+                case AstType::kAssign: {
+                    AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(node);
+                    traverse(ptr->variable());
+                    traverse(ptr->expression());
+                    derived().visitAssign(ptr);
+                    break;
+                }
+
+                case AstType::kRead: {
+                    ReadStatementAstPtr ptr = static_cast<ReadStatementAstPtr>(node);
+                    traverse(ptr->variable());
+                    derived().visitRead(ptr);
+                    break;
+                }
+
+                case AstType::kWrite: {
+                    WriteStatementAstPtr ptr = static_cast<WriteStatementAstPtr>(node);
+                    traverse(ptr->expression());
+                    derived().visitWrite(ptr);
+                    break;
+                }
+
+                case AstType::kExpression: {
+                    ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+                    traverse(ptr->leftPart());
+                    traverse(ptr->rightPart());
+                    derived().visitExpression(ptr);
+                    break;
+                }
+
+                case AstType::kConstant:
+                    derived().visitConstant(static_cast<ConstantAstPtr>(node));
+                    break;
+
+                case AstType::kVariable:
+                    derived().visitVariable(static_cast<VariableAstPtr>(node));
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    void visitIf(IfStatementAstPtr) {}
+    void visitRepeat(RepeatStatementAstPtr) {}
+    void visitAssign(AssignStatementAstPtr) {}
+    void visitRead(ReadStatementAstPtr) {}
+    void visitWrite(WriteStatementAstPtr) {}
+    void visitExpression(ExpressionAstPtr) {}
+    void visitConstant(ConstantAstPtr) {}
+    void visitVariable(VariableAstPtr) {}
+
+private:
+    Derived& derived() { return *static_cast<Derived*>(this); }
+};
+
+// Runs several AstVisitor passes in one traversal. Each node is handed to
+// the passes in order, so a pass sees what the earlier ones did to the node
+// and, the walk being post-order, to all of its children.
+template<typename... Passes>
+class FusedVisitor : public AstVisitor<FusedVisitor<Passes...>> {
+public:
+    explicit FusedVisitor(Passes&... passes)
+        : passes_(passes...) {
+    }
+
+    void visitIf(IfStatementAstPtr node) { forEach([node](auto& pass) { pass.visitIf(node); }); }
+    void visitRepeat(RepeatStatementAstPtr node) { forEach([node](auto& pass) { pass.visitRepeat(node); }); }
+    void visitAssign(AssignStatementAstPtr node) { forEach([node](auto& pass) { pass.visitAssign(node); }); }
+    void visitRead(ReadStatementAstPtr node) { forEach([node](auto& pass) { pass.visitRead(node); }); }
+    void visitWrite(WriteStatementAstPtr node) { forEach([node](auto& pass) { pass.visitWrite(node); }); }
+    void visitExpression(ExpressionAstPtr node) { forEach([node](auto& pass) { pass.visitExpression(node); }); }
+    void visitConstant(ConstantAstPtr node) { forEach([node](auto& pass) { pass.visitConstant(node); }); }
+    void visitVariable(VariableAstPtr node) { forEach([node](auto& pass) { pass.visitVariable(node); }); }
+
+private:
+    template<typename Func>
+    void forEach(Func func) { forEach(func, std::index_sequence_for<Passes...>()); }
+
+    template<typename Func, size_t... I>
+    void forEach(Func func, std::index_sequence<I...>) {
+        int expand[] = { 0, (func(std::get<I>(passes_)), 0)... };
+        (void)expand;
+    }
+
+private:
+    std::tuple<Passes&...> passes_;
+};
+
+} // namespace nova
+
+#endif
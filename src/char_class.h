@@ -0,0 +1,190 @@
+#ifndef __NOVA_CHAR_CLASS_H__
+#define __NOVA_CHAR_CLASS_H__
+
+#include <stdint.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace nova {
+
+// Character classes of the TINY lexer. The classification matches the "C"
+// locale isspace/isdigit/isalpha the scanner used to call.
+enum CharClass : uint8_t {
+    kCharOther,      // invalid anywhere outside comments
+    kCharSpace,      // ' ' '\t' '\n' '\v' '\f' '\r'
+    kCharDigit,      // 0-9
+    kCharLetter,     // a-z A-Z
+    kCharLeftBrace,  // {
+    kCharRightBrace, // }
+    kCharColon,      // :
+    kCharEqual,      // =
+    kCharOperator,   // + - * / < ( ) ;
+    kCharEnd,        // end of input, never stored in the table
+    kCharClassCount,
+};
+
+struct CharClassTable {
+    constexpr CharClassTable()
+        : classes() {
+        for (int c = 0; c < 256; ++c) {
+            classes[c] = classify(c);
+        }
+    }
+
+    static constexpr CharClass classify(int c) {
+        return (c == ' ' || (c >= '\t' && c <= '\r')) ? kCharSpace
+             : (c >= '0' && c <= '9') ? kCharDigit
+             : ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) ? kCharLetter
+             : c == '{' ? kCharLeftBrace
+             : c == '}' ? kCharRightBrace
+             : c == ':' ? kCharColon
+             : c == '=' ? kCharEqual
+             : (c == '+' || c == '-' || c == '*' || c == '/' || c == '<' ||
+                c == '(' || c == ')' || c == ';') ? kCharOperator
+             : kCharOther;
+    }
+
+    CharClass classes[256];
+};
+
+constexpr CharClassTable kCharClassTable;
+
+inline CharClass charClass(char c) {
+    return kCharClassTable.classes[static_cast<unsigned char>(c)];
+}
+
+// Run scanners for the self loops of the lexer DFA. Each returns the first
+// position in [p, end) that does not belong to the run. The vector paths
+// only load whole blocks that lie inside [p, end) and finish with the
+// scalar loop, so no padding is needed after the buffer.
+
+namespace detail {
+
+#if defined(__AVX2__)
+const int kBlockSize = 32;
+typedef __m256i Block;
+
+inline Block loadBlock(const char* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+inline uint32_t equalMask(Block v, char c) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))));
+}
+
+// bytes with low <= byte <= low + span, unsigned
+inline uint32_t rangeMask(Block v, char low, char span) {
+    Block t = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(span)), t)));
+}
+
+inline Block toLower(Block v) {
+    return _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+}
+#elif defined(__SSE2__)
+const int kBlockSize = 16;
+typedef __m128i Block;
+
+inline Block loadBlock(const char* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline uint32_t equalMask(Block v, char c) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c))));
+}
+
+inline uint32_t rangeMask(Block v, char low, char span) {
+    Block t = _mm_sub_epi8(v, _mm_set1_epi8(low));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(span)), t)));
+}
+
+inline Block toLower(Block v) {
+    return _mm_or_si128(v, _mm_set1_epi8(0x20));
+}
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+const uint32_t kFullMask = kBlockSize == 32 ? 0xffffffffu : 0xffffu;
+#endif
+
+} // namespace detail
+
+inline const char* skipSpaces(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    using namespace detail;
+    while (end - p >= kBlockSize) {
+        if (charClass(*p) != kCharSpace) {
+            return p;
+        }
+        Block v = loadBlock(p);
+        uint32_t spaces = equalMask(v, ' ') | rangeMask(v, '\t', '\r' - '\t');
+        if (spaces != kFullMask) {
+            return p + __builtin_ctz(~spaces);
+        }
+        p += kBlockSize;
+    }
+#endif
+    while (p != end && charClass(*p) == kCharSpace) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* skipDigits(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    using namespace detail;
+    while (end - p >= kBlockSize) {
+        uint32_t digits = rangeMask(loadBlock(p), '0', 9);
+        if (digits != kFullMask) {
+            return p + __builtin_ctz(~digits);
+        }
+        p += kBlockSize;
+    }
+#endif
+    while (p != end && charClass(*p) == kCharDigit) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* skipLetters(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    using namespace detail;
+    while (end - p >= kBlockSize) {
+        uint32_t letters = rangeMask(toLower(loadBlock(p)), 'a', 25);
+        if (letters != kFullMask) {
+            return p + __builtin_ctz(~letters);
+        }
+        p += kBlockSize;
+    }
+#endif
+    while (p != end && charClass(*p) == kCharLetter) {
+        ++p;
+    }
+    return p;
+}
+
+// returns the position of the closing '}', or end
+inline const char* skipCommentBody(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+    using namespace detail;
+    while (end - p >= kBlockSize) {
+        uint32_t braces = equalMask(loadBlock(p), '}');
+        if (braces != 0) {
+            return p + __builtin_ctz(braces);
+        }
+        p += kBlockSize;
+    }
+#endif
+    while (p != end && *p != '}') {
+        ++p;
+    }
+    return p;
+}
+
+} // namespace nova
+
+#endif
@@ -13,18 +13,78 @@ CodeGenerator::CodeGenerator(Analysis& analyst,
     : analyst_(analyst),
       root_(ptr), 
       file_name_(file_name), 
+      out_(buffer_),
       current_line_(0),
       tmp_offset_(0),
-      trace_code_(trace_code) {
+      trace_code_(trace_code),
+      source_line_(0),
+      first_pc_(0),
+      last_flushed_line_(-1) {
+}
+
+CodeGenerator::CodeGenerator(Analysis& analyst, 
+                             std::ostream& os, 
+                             const std::string& file_name,
+                             bool trace_code)
+    : analyst_(analyst),
+      root_(nullptr), 
+      file_name_(file_name), 
+      out_(os),
+      current_line_(0),
+      tmp_offset_(0),
+      trace_code_(trace_code),
+      source_line_(0),
+      first_pc_(0),
+      last_flushed_line_(-1) {
+}
+
+void CodeGenerator::markSourceLine(int line) {
+    size_t index = static_cast<size_t>(line - first_pc_);
+    if (source_lines_.size() <= index) {
+        source_lines_.resize(index + 1, 0);
+    }
+    source_lines_[index] = source_line_;
+}
+
+// Instructions emitted from now on belong to node, returns the previous
+// source line so that the caller can restore it.
+int CodeGenerator::enterNode(const AstPtr& node) {
+    int saved_line = source_line_;
+    source_line_ = lines_.line(node->getTokenLocation());
+    return saved_line;
+}
+
+void CodeGenerator::buildLineTable() {
+    line_table_.clear();
+    line_table_.setFileName(file_name_);
+    for (size_t pc = 1; pc < source_lines_.size(); ++pc) {
+        line_table_.add(static_cast<int>(pc), source_lines_[pc]);
+    }
+}
+
+// Streaming mode: writes the *.loc entries of every pc emitted so far and
+// forgets them. Only called between top-level statements, once all of
+// their jumps are patched.
+void CodeGenerator::flushLineTable() {
+    for (size_t i = 0; i < source_lines_.size(); ++i) {
+        int pc = first_pc_ + static_cast<int>(i);
+        if (pc > 0 && source_lines_[i] != last_flushed_line_) {
+            out_ << "*.loc " << pc << " " << source_lines_[i] << '\n';
+            last_flushed_line_ = source_lines_[i];
+        }
+    }
+    source_lines_.clear();
+    first_pc_ = current_line_ + 1;
 }
 
 void CodeGenerator::emitCodeLine(const std::string& code, const std::string& comment) {
     ++current_line_;
-    buffer_ << current_line_ << ":   " << code;
+    markSourceLine(current_line_);
+    out_ << current_line_ << ":   " << code;
     if (trace_code_) {
-        buffer_ << "\t\t* " << comment;   
+        out_ << "\t\t* " << comment;   
     }
-    buffer_ << std::endl;
+    out_ << '\n';
 }
 
 // opcode r,s,t
@@ -34,12 +94,13 @@ void CodeGenerator::emitRo(const std::string& code,
                            Register t, 
                            const std::string& comment) {
     ++current_line_;
-    buffer_ << current_line_ << ":   " << code << " " << static_cast<int>(r) << "," 
+    markSourceLine(current_line_);
+    out_ << current_line_ << ":   " << code << " " << static_cast<int>(r) << "," 
             << static_cast<int>(s) << "," << static_cast<int>(t);
     if (trace_code_) {
-        buffer_ << "\t\t* " << comment;   
+        out_ << "\t\t* " << comment;   
     }
-    buffer_ << std::endl;
+    out_ << '\n';
 }
 
 // opcode r,d(s)
@@ -58,17 +119,18 @@ void CodeGenerator::emitRm(int line,
                            int64_t d, 
                            Register s, 
                            const std::string& comment) {
-    buffer_ << line << ":   " << code << " " << static_cast<int>(r) << "," << d
+    markSourceLine(line);
+    out_ << line << ":   " << code << " " << static_cast<int>(r) << "," << d
             << "(" << static_cast<int>(s) << ")";
     if (trace_code_) {
-        buffer_ << "\t\t* " << comment;   
+        out_ << "\t\t* " << comment;   
     }
-    buffer_ << std::endl;
+    out_ << '\n';
 }
 
 void CodeGenerator::emitCommentLine(const std::string& comment) {
     if (trace_code_) {
-        buffer_ << comment << std::endl;
+        out_ << comment << '\n';
     }
 }
 
@@ -86,11 +148,33 @@ CodeBuffer CodeGenerator::generateCode() {
     generateStatementSequence(root_);
     emitCommentLine("* End of execution");
     emitRo("HALT", Register::ac, Register::ac, Register::ac);
+    buildLineTable();
+    line_table_.write(buffer_);
     return buffer_.str();
 }
 
+void CodeGenerator::beginCode() {
+    out_ << "*.file " << file_name_ << '\n';
+    generatePrelude();
+    flushLineTable();
+}
+
+void CodeGenerator::generateStatement(AstPtr statement) {
+    generateStatementSequence(statement);
+    flushLineTable();
+}
+
+void CodeGenerator::endCode() {
+    emitCommentLine("* End of execution");
+    emitRo("HALT", Register::ac, Register::ac, Register::ac);
+    flushLineTable();
+    out_.flush();
+}
+
 void CodeGenerator::generateStatementSequence(AstPtr node) {
+    int saved_line = source_line_;
     while (node != nullptr) {
+        source_line_ = lines_.line(node->getTokenLocation());
         switch (node->getAstType()) {
             case AstType::kIf:
                 generateIfStatement(node);
@@ -122,16 +206,17 @@ void CodeGenerator::generateStatementSequence(AstPtr node) {
         }
         node = node->next();
     }
+    source_line_ = saved_line;
 }
 
 void CodeGenerator::generateIfStatement(AstPtr node) {
-    IfStatementAstPtr ptr = std::dynamic_pointer_cast<IfStatementAst>(node);
+    IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(node);
     if (!ptr) {
         return;   
     }
 
     emitCommentLine("* -> if");
-    generateStatementSequence(ptr->testPart());
+    std::string jump_if_false = generateTest(ptr->testPart());
     emitCommentLine("* if: jump to else belongs here");
 
     ++current_line_;
@@ -141,7 +226,7 @@ void CodeGenerator::generateIfStatement(AstPtr node) {
 
     ++current_line_;
     int saved_loc2 = current_line_;
-    emitRm(saved_loc, "JEQ", Register::ac, current_line_ - saved_loc, Register::pc, "if: jmp to false");
+    emitRm(saved_loc, jump_if_false, Register::ac, current_line_ - saved_loc, Register::pc, "if: jmp to false");
 
     if (ptr->elsePart()) {
         generateStatementSequence(ptr->elsePart());  
@@ -152,7 +237,7 @@ void CodeGenerator::generateIfStatement(AstPtr node) {
 }
 
 void CodeGenerator::generateRepeatStatement(AstPtr node) {
-    RepeatStatementAstPtr ptr = std::dynamic_pointer_cast<RepeatStatementAst>(node);
+    RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(node);
     if (!ptr) {
         return;   
     }
@@ -160,35 +245,35 @@ void CodeGenerator::generateRepeatStatement(AstPtr node) {
     emitCommentLine("* repeat: jump after body comes back here");
     int saved_loc = current_line_ + 1;
     generateStatementSequence(ptr->bodyPart());
-    generateExpression(ptr->testPart());
-    emitRm("JEQ", Register::ac, saved_loc - current_line_ - 2, Register::pc, "repeat: jmp back to body");
+    std::string jump_if_false = generateTest(ptr->testPart());
+    emitRm(jump_if_false, Register::ac, saved_loc - current_line_ - 2, Register::pc, "repeat: jmp back to body");
     emitCommentLine("* <- repeat");
 }
 
 void CodeGenerator::generateAssignStatement(AstPtr node) {
-    AssignStatementAstPtr ptr = std::dynamic_pointer_cast<AssignStatementAst>(node);
+    AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(node);
     if (!ptr) {
         return; 
     }
     emitCommentLine("* -> assign");
     generateExpression(ptr->expression());
-    int offset = analyst_.lookupSymbolTable(ptr->variable()->name());
+    int offset = ptr->variable()->slot();
     emitRm("ST", Register::ac, offset, Register::gp, "assign: store value");
     emitCommentLine("* <- assign");
 }
 
 void CodeGenerator::generateReadStatement(AstPtr node) {
-    ReadStatementAstPtr ptr = std::dynamic_pointer_cast<ReadStatementAst>(node);
+    ReadStatementAstPtr ptr = static_cast<ReadStatementAstPtr>(node);
     if (!ptr) {
         return;   
     }
     emitRo("IN", Register::ac, Register::ac, Register::ac, "read integer value");
-    int offset = analyst_.lookupSymbolTable(ptr->variable()->name());
+    int offset = ptr->variable()->slot();
     emitRm("ST", Register::ac, offset, Register::gp, "read: store value");
 }
 
 void CodeGenerator::generateWriteStatement(AstPtr node) {
-    WriteStatementAstPtr ptr = std::dynamic_pointer_cast<WriteStatementAst>(node);
+    WriteStatementAstPtr ptr = static_cast<WriteStatementAstPtr>(node);
     if (!ptr) {
         return;   
     }
@@ -196,7 +281,8 @@ void CodeGenerator::generateWriteStatement(AstPtr node) {
     emitRo("OUT", Register::ac, Register::ac, Register::ac, "write ac");
 }
 
-void CodeGenerator::generateExpression(AstPtr node) {
+// a comparison for a branch only leaves the difference of its operands
+void CodeGenerator::generateExpression(AstPtr node, bool branch) {
     switch (node->getAstType()) {
         case AstType::kVariable:
             generateVariable(node);
@@ -210,11 +296,12 @@ void CodeGenerator::generateExpression(AstPtr node) {
             break;
     }
 
-    ExpressionAstPtr ptr = std::dynamic_pointer_cast<ExpressionAst>(node);
+    ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
     if (!ptr) {
         return;   
     }
 
+    int saved_line = enterNode(node);
     emitCommentLine("* -> op");
     generateExpression(ptr->leftPart());
     emitRm("ST", Register::ac, tmp_offset_, Register::mp, "op: push left");
@@ -242,6 +329,9 @@ void CodeGenerator::generateExpression(AstPtr node) {
 
         case TokenValue::kLess:
             emitRo("SUB", Register::ac, Register::ac1, Register::ac, "op <");
+            if (branch) {
+                break;
+            }
             emitRm("JLT", Register::ac, 2, Register::pc, "br if true");
             emitRm("LDC", Register::ac, 0, Register::ac, "false case");
             emitRm("LDA", Register::pc, 1, Register::pc, "unconditional jmp");
@@ -250,6 +340,9 @@ void CodeGenerator::generateExpression(AstPtr node) {
 
         case TokenValue::kEqual:
             emitRo("SUB", Register::ac, Register::ac1, Register::ac, "op =");
+            if (branch) {
+                break;
+            }
             emitRm("JEQ", Register::ac, 2, Register::pc, "br if true");
             emitRm("LDC", Register::ac, 0, Register::ac, "false case");
             emitRm("LDA", Register::pc, 1, Register::pc, "unconditional jmp");
@@ -261,27 +354,52 @@ void CodeGenerator::generateExpression(AstPtr node) {
             break;
     }
     emitCommentLine("* <- op");
+    source_line_ = saved_line;
+}
+
+// Generates the test of an if or a repeat, returns the jump to take when
+// it is false. A comparison only leaves the difference of its operands in
+// ac for that jump to look at, rather than a 0 or 1 to compare again.
+std::string CodeGenerator::generateTest(AstPtr node) {
+    generateExpression(node, true);
+    if (node->getAstType() == AstType::kExpression) {
+        switch (static_cast<ExpressionAstPtr>(node)->operatorTokenValue()) {
+            case TokenValue::kLess:
+                return "JGE";
+
+            case TokenValue::kEqual:
+                return "JNE";
+
+            default:
+                break;
+        }
+    }
+    return "JEQ";
 }
 
 void CodeGenerator::generateVariable(AstPtr node) {
-    VariableAstPtr ptr = std::dynamic_pointer_cast<VariableAst>(node);
+    VariableAstPtr ptr = static_cast<VariableAstPtr>(node);
     if (!ptr) {
         return;   
     }
+    int saved_line = enterNode(node);
     emitCommentLine("* -> Id");
-    int offset = analyst_.lookupSymbolTable(ptr->name());    
+    int offset = ptr->slot();    
     emitRm("LD", Register::ac, offset, Register::gp, "load id value");
     emitCommentLine("* <- Id");
+    source_line_ = saved_line;
 }
 
 void CodeGenerator::generateConstant(AstPtr node) {
-    ConstantAstPtr ptr = std::dynamic_pointer_cast<ConstantAst>(node);
+    ConstantAstPtr ptr = static_cast<ConstantAstPtr>(node);
     if (!ptr) {
         return;   
     }
+    int saved_line = enterNode(node);
     emitCommentLine("* -> Const");
     emitRm("LDC", Register::ac, ptr->intValue(), Register::ac, "load const");
     emitCommentLine("* <- Const");
+    source_line_ = saved_line;
 }
 
 void CodeGenerator::errorReport(const std::string& message) {
@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <sstream>
+#include <ostream>
 
 #include "analysis.h"
+#include "file_table.h"
+#include "line_table.h"
 
 namespace nova {
 
@@ -12,6 +15,9 @@ enum class Register {
     invalid = -1,
     ac = 0,         // accumulator
     ac1 = 1,        // accumulator1
+    r2 = 2,         // 2 to 4 are given out by the register allocator
+    r3 = 3,
+    r4 = 4,
     gp = 5,         // global pointer
     mp = 6,         // memory pointer
     pc = 7,         // program count
@@ -26,8 +32,23 @@ public:
                   const std::string& file_name, 
                   bool trace_code = false);
 
+    // streaming: code is written to os while it is generated, call
+    // beginCode(), generateStatement() for each top-level statement, endCode()
+    CodeGenerator(Analysis& analyst, 
+                  std::ostream& os, 
+                  const std::string& file_name, 
+                  bool trace_code = false);
+
     CodeBuffer generateCode();
 
+    void beginCode();
+    void generateStatement(AstPtr statement);
+    void endCode();
+
+    // TM pc -> TINY source line, also appended to the listing as *.loc lines.
+    // Only built by generateCode(), the streaming mode writes it as it goes.
+    const LineTable& lineTable() const { return line_table_; }
+
     static bool getErrorFlag() { return error_flag_; }
     static void setErrorFlag(bool flag) { error_flag_ = flag; }
 
@@ -54,10 +75,15 @@ private:
                 const std::string& comment = std::string());
 
     void emitCommentLine(const std::string& comment);
+    void markSourceLine(int line);
+    int enterNode(const AstPtr& node);
+    void buildLineTable();
+    void flushLineTable();
 
     void generatePrelude();
     void generateStatementSequence(AstPtr node);
-    void generateExpression(AstPtr node);
+    void generateExpression(AstPtr node, bool branch = false);
+    std::string generateTest(AstPtr node);
     void generateIfStatement(AstPtr node);
     void generateRepeatStatement(AstPtr node);
     void generateAssignStatement(AstPtr node);
@@ -73,9 +99,16 @@ private:
     AstPtr root_;
     std::string file_name_;
     std::ostringstream buffer_;
+    std::ostream& out_;
     int current_line_;
     int tmp_offset_;
     bool trace_code_;
+    int source_line_;
+    LineResolver lines_;
+    std::vector<int> source_lines_;  // indexed by pc - first_pc_
+    int first_pc_;
+    int last_flushed_line_;
+    LineTable line_table_;
 
     static bool error_flag_;
 };
@@ -0,0 +1,120 @@
+#include "compiler.h"
+
+#include "parser.h"
+#include "parallel_parser.h"
+#include "analysis.h"
+#include "simplifier.h"
+#include "dead_code.h"
+#include "codegen.h"
+#include "ir_builder.h"
+#include "ssa.h"
+#include "value_numbering.h"
+#include "licm.h"
+#include "tm_lowering.h"
+#include "error.h"
+#include "file_table.h"
+
+namespace nova {
+
+namespace {
+
+bool hasFrontEndErrors() {
+    return Scanner::getErrorFlag() || Parser::getErrorFlag();
+}
+
+// Parses, analyses and generates one top-level statement at a time and
+// frees its AST before the next, so memory is bounded by the largest
+// statement rather than the program. All statements are still parsed and
+// checked after an error, but no more code is generated.
+bool compileStreaming(Scanner& scanner, bool optimize, std::ostream& os) {
+    AstContext context;
+    Parser parser(scanner, context);
+    Analysis analysis(nullptr);
+    analysis.useSymbolTable(parser.symbolTable());
+    Simplifier simplifier(context);
+    DeadCodeEliminator eliminator(parser.symbolTable());
+    CodeGenerator generator(analysis, os, scanner.fileName(), true);
+    generator.beginCode();
+    while (AstPtr statement = parser.parseNextStatement()) {
+        if (optimize) {
+            analysis.analyzeStatement(statement, simplifier);
+        } else {
+            analysis.analyzeStatement(statement);
+        }
+        if (optimize && !hasFrontEndErrors()) {
+            statement = eliminator.eliminate(statement, true);
+        }
+        if (!hasFrontEndErrors()) {
+            generator.generateStatement(statement);
+        }
+        context.clear();
+    }
+    generator.endCode();
+    return !hasFrontEndErrors() && !CodeGenerator::getErrorFlag();
+}
+
+bool compileAndRelease(Scanner& scanner, const CompileOptions& options, std::ostream& os) {
+    bool compiled = scanner.isFileOpened() && compile(scanner, options, os);
+    FileTable::instance().remove(scanner.fileId());
+    return compiled;
+}
+
+} // namespace
+
+bool compile(Scanner& scanner, const CompileOptions& options, std::ostream& os) {
+    if (options.stream) {
+        return compileStreaming(scanner, options.optimize, os);
+    }
+    ParallelParser parser(scanner, options.jobs);
+    AstPtr root = parser.parse();
+    Analysis analysis(root);
+    analysis.useSymbolTable(parser.symbolTable());
+    if (options.optimize) {
+        Simplifier simplifier(parser.context());
+        analysis.analyze(simplifier);
+    } else {
+        analysis.analyze();
+    }
+    if (hasFrontEndErrors()) {
+        return false;      
+    }
+    if (options.optimize) {
+        root = DeadCodeEliminator(parser.symbolTable()).eliminate(root, false);
+    }
+    ir::Function function = ir::IrBuilder(parser.symbolTable()).build(root);
+    ir::constructSsa(function);
+    int redundant = options.optimize ? ir::numberValues(function) : 0;
+    int hoisted = options.optimize ? ir::hoistLoopInvariants(function) : 0;
+    if (options.dump_ir != nullptr) {
+        function.dump(*options.dump_ir);
+    }
+    ir::destructSsa(function);
+    if (CodeGenerator::getErrorFlag()) {
+        return false;
+    }
+    PeepholeOptimizer peephole(options.peephole);
+    ir::TmLowering lowering(function, scanner.fileName(), true, options.optimize ? &peephole : nullptr);
+    os << lowering.generateCode();
+    if (options.stats != nullptr) {
+        *options.stats << "value-numbering removed " << redundant << '\n';
+        *options.stats << "licm hoisted " << hoisted << '\n';
+        peephole.writeStats(*options.stats);
+    }
+    return true;
+}
+
+bool compileSource(const std::string& name, const char* data, size_t size, 
+                   const CompileOptions& options, std::ostream& os) {
+    clearErrorFlags();
+    Scanner scanner(name, data, size);
+    return compileAndRelease(scanner, options, os);
+}
+
+bool compileSource(const std::string& name, std::istream& is, 
+                   const CompileOptions& options, std::ostream& os) {
+    clearErrorFlags();
+    Scanner scanner(name, is);
+    return compileAndRelease(scanner, options, os);
+}
+
+} // namespace nova
@@ -0,0 +1,57 @@
+#ifndef __NOVA_COMPILER_H__
+#define __NOVA_COMPILER_H__
+
+#include <string>
+#include <ostream>
+#include <istream>
+
+#include "peephole.h"
+#include "scanner.h"
+
+namespace nova {
+
+struct CompileOptions {
+    CompileOptions()
+        : stream(false),
+          jobs(0),
+          optimize(true),
+          dump_ir(nullptr),
+          stats(nullptr) {
+    }
+
+    // parse, check and emit one top-level statement at a time
+    bool stream;
+    // threads of the parallel parser, 0 for one per core
+    int jobs;
+    // simplify the expressions and remove dead code from the AST; through
+    // the IR also number values, hoist loop invariants and run the peephole
+    // optimizer over the TM code
+    bool optimize;
+    // the SSA form of the program is written here, not in streaming mode
+    std::ostream* dump_ir;
+    // the rules of the TM peephole optimizer, which runs when optimizing,
+    // not in streaming mode
+    PeepholeOptions peephole;
+    // how often each of them applied, and what the other optimizations of
+    // the IR removed, is written here
+    std::ostream* stats;
+};
+
+// Compiles the program read by scanner to TM code written to os. Errors are
+// reported on std::cerr and make it return false. The whole program goes
+// through the IR in ir.h, the streaming mode generates code straight from
+// the AST of each statement.
+bool compile(Scanner& scanner, const CompileOptions& options, std::ostream& os);
+
+// In-process entry points for programs held in memory or read from a
+// stream. They clear the error flags first and release the source from the
+// FileTable when done, so a process can compile any number of programs.
+// data is only read during the call and is not copied.
+bool compileSource(const std::string& name, const char* data, size_t size, 
+                   const CompileOptions& options, std::ostream& os);
+bool compileSource(const std::string& name, std::istream& is, 
+                   const CompileOptions& options, std::ostream& os);
+
+} // namespace nova
+
+#endif
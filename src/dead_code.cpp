@@ -0,0 +1,241 @@
+#include "dead_code.h"
+
+#include "simplifier.h"
+
+namespace nova {
+
+namespace {
+
+// the value of a constant test, false if the test is not a constant
+bool constantTest(AstPtr test, bool* value) {
+    if (test == nullptr || test->getAstType() != AstType::kConstant) {
+        return false;
+    }
+    *value = static_cast<ConstantAstPtr>(test)->intValue() != 0;
+    return true;
+}
+
+// marks the variables the expression reads
+void addUses(AstPtr node, std::vector<bool>& live) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->getAstType() == AstType::kVariable) {
+        live[static_cast<size_t>(static_cast<VariableAstPtr>(node)->slot())] = true;
+    } else if (node->getAstType() == AstType::kExpression) {
+        ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+        addUses(ptr->leftPart(), live);
+        addUses(ptr->rightPart(), live);
+    }
+}
+
+void unite(std::vector<bool>& into, const std::vector<bool>& from) {
+    for (size_t i = 0; i < into.size(); ++i) {
+        if (from[i]) {
+            into[i] = true;
+        }
+    }
+}
+
+// appends the statement with summary (gen, kill) in front of the sequence
+// with summary (seq_gen, seq_kill)
+void prepend(const std::vector<bool>& gen, const std::vector<bool>& kill,
+             std::vector<bool>& seq_gen, std::vector<bool>& seq_kill) {
+    for (size_t i = 0; i < seq_gen.size(); ++i) {
+        seq_gen[i] = gen[i] || (seq_gen[i] && !kill[i]);
+        seq_kill[i] = kill[i] || seq_kill[i];
+    }
+}
+
+size_t sequenceLength(AstPtr sequence) {
+    size_t length = 0;
+    for (; sequence != nullptr; sequence = sequence->next()) {
+        ++length;
+    }
+    return length;
+}
+
+} // namespace
+
+AstPtr DeadCodeEliminator::eliminate(AstPtr sequence, bool live_after) {
+    LiveSet live(static_cast<size_t>(symbol_table_.size()), live_after);
+    return eliminateSequence(sequence, live);
+}
+
+// live holds the variables read after the sequence, and on return those
+// read before it
+AstPtr DeadCodeEliminator::eliminateSequence(AstPtr sequence, LiveSet& live) {
+    std::vector<AstPtr> statements;
+    flatten(sequence, statements);
+    AstPtr head = nullptr;
+    for (auto it = statements.rbegin(); it != statements.rend(); ++it) {
+        if (eliminateStatement(*it, live)) {
+            (*it)->setNext(head);
+            head = *it;
+        } else {
+            ++removed_;
+        }
+    }
+    return head;
+}
+
+// Appends the statements of the sequence which can run, the ifs and repeats
+// with constant tests replaced by the statements they run. Returns false if
+// the sequence never ends, the statements after that are dropped.
+bool DeadCodeEliminator::flatten(AstPtr sequence, std::vector<AstPtr>& statements) {
+    for (AstPtr node = sequence; node != nullptr; node = node->next()) {
+        bool test = false;
+        bool runs_on = true;
+        if (node->getAstType() == AstType::kIf &&
+            constantTest(static_cast<IfStatementAstPtr>(node)->testPart(), &test)) {
+            IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(node);
+            ++removed_;
+            runs_on = flatten(test ? ptr->thenPart() : ptr->elsePart(), statements);
+        } else if (node->getAstType() == AstType::kRepeat &&
+                   constantTest(static_cast<RepeatStatementAstPtr>(node)->testPart(), &test)) {
+            if (test) {
+                ++removed_;
+                runs_on = flatten(static_cast<RepeatStatementAstPtr>(node)->bodyPart(), statements);
+            } else {
+                statements.push_back(node);
+                runs_on = false;
+            }
+        } else {
+            statements.push_back(node);
+        }
+        if (!runs_on) {
+            removed_ += sequenceLength(node->next());
+            return false;
+        }
+    }
+    return true;
+}
+
+// false if the statement is dead
+bool DeadCodeEliminator::eliminateStatement(AstPtr statement, LiveSet& live) {
+    switch (statement->getAstType()) {
+        case AstType::kAssign: {
+            AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(statement);
+            size_t slot = static_cast<size_t>(ptr->variable()->slot());
+            if (!live[slot] && !canTrap(ptr->expression())) {
+                return false;
+            }
+            live[slot] = false;
+            addUses(ptr->expression(), live);
+            return true;
+        }
+
+        case AstType::kRead:
+            live[static_cast<size_t>(static_cast<ReadStatementAstPtr>(statement)->variable()->slot())] = false;
+            return true;
+
+        case AstType::kWrite:
+            addUses(static_cast<WriteStatementAstPtr>(statement)->expression(), live);
+            return true;
+
+        case AstType::kIf: {
+            IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(statement);
+            LiveSet else_live = live;
+            ptr->setThenPart(eliminateSequence(ptr->thenPart(), live));
+            ptr->setElsePart(eliminateSequence(ptr->elsePart(), else_live));
+            if (ptr->thenPart() == nullptr && ptr->elsePart() == nullptr && !canTrap(ptr->testPart())) {
+                return false;
+            }
+            unite(live, else_live);
+            addUses(ptr->testPart(), live);
+            return true;
+        }
+
+        case AstType::kRepeat: {
+            RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(statement);
+            bool test = false;
+            if (constantTest(ptr->testPart(), &test) && !test) {
+                live.assign(live.size(), false);  // it never exits
+            }
+            addUses(ptr->testPart(), live);
+            LiveSet gen(live.size(), false);
+            LiveSet kill(live.size(), false);
+            summarize(ptr->bodyPart(), gen, kill);
+            unite(live, gen);
+            ptr->setBodyPart(eliminateSequence(ptr->bodyPart(), live));
+            return true;
+        }
+
+        default:
+            addUses(statement, live);
+            return true;
+    }
+}
+
+// gen: the variables the sequence may read before writing them, kill: those
+// it always writes, or all of them if it never ends
+void DeadCodeEliminator::summarize(AstPtr sequence, LiveSet& gen, LiveSet& kill) const {
+    std::vector<AstPtr> statements;
+    for (; sequence != nullptr; sequence = sequence->next()) {
+        statements.push_back(sequence);
+    }
+    LiveSet statement_gen(gen.size());
+    LiveSet statement_kill(kill.size());
+    for (auto it = statements.rbegin(); it != statements.rend(); ++it) {
+        statement_gen.assign(gen.size(), false);
+        statement_kill.assign(kill.size(), false);
+        summarizeStatement(*it, statement_gen, statement_kill);
+        prepend(statement_gen, statement_kill, gen, kill);
+    }
+}
+
+void DeadCodeEliminator::summarizeStatement(AstPtr statement, LiveSet& gen, LiveSet& kill) const {
+    switch (statement->getAstType()) {
+        case AstType::kAssign: {
+            AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(statement);
+            addUses(ptr->expression(), gen);
+            kill[static_cast<size_t>(ptr->variable()->slot())] = true;
+            break;
+        }
+
+        case AstType::kRead:
+            kill[static_cast<size_t>(static_cast<ReadStatementAstPtr>(statement)->variable()->slot())] = true;
+            break;
+
+        case AstType::kWrite:
+            addUses(static_cast<WriteStatementAstPtr>(statement)->expression(), gen);
+            break;
+
+        case AstType::kIf: {
+            IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(statement);
+            LiveSet else_gen(gen.size(), false);
+            LiveSet else_kill(kill.size(), false);
+            summarize(ptr->thenPart(), gen, kill);
+            summarize(ptr->elsePart(), else_gen, else_kill);
+            unite(gen, else_gen);
+            addUses(ptr->testPart(), gen);
+            for (size_t i = 0; i < kill.size(); ++i) {
+                kill[i] = kill[i] && else_kill[i];
+            }
+            break;
+        }
+
+        case AstType::kRepeat: {
+            // the body runs once and then again from its end, where what
+            // the test reads is also live
+            RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(statement);
+            LiveSet test_gen(gen.size(), false);
+            addUses(ptr->testPart(), test_gen);
+            summarize(ptr->bodyPart(), gen, kill);
+            for (size_t i = 0; i < gen.size(); ++i) {
+                gen[i] = gen[i] || (test_gen[i] && !kill[i]);
+            }
+            bool test = false;
+            if (constantTest(ptr->testPart(), &test) && !test) {
+                kill.assign(kill.size(), true);
+            }
+            break;
+        }
+
+        default:
+            addUses(statement, gen);
+            break;
+    }
+}
+
+} // namespace nova
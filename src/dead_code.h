@@ -0,0 +1,61 @@
+#ifndef __NOVA_DEAD_CODE_H__
+#define __NOVA_DEAD_CODE_H__
+
+#include <vector>
+
+#include "ast.h"
+#include "symbol_table.h"
+
+namespace nova {
+
+// Removes the statements of a simplified AST that never run or whose
+// results are never used:
+//  - an if whose test is a constant is replaced by the branch it takes,
+//    and an if with no statements left in either branch by nothing,
+//  - a repeat whose test is a nonzero constant runs its body once, the
+//    body takes its place, and the statements after a repeat whose test
+//    is 0 are never reached,
+//  - an assignment to a variable that is not read before it is assigned
+//    again or the program ends is a dead store, dropped unless its
+//    expression can trap.
+//
+// Liveness is computed backwards over the statements, a store only read by
+// dead stores is dead as well. The variables live at the end of a repeat
+// body are found without iterating, from a summary of the variables the
+// body may read before writing them and those it always writes. As that
+// summary counts every read, a store only read by dead stores inside the
+// same loop is kept.
+class DeadCodeEliminator {
+public:
+    explicit DeadCodeEliminator(const SymbolTable& symbol_table)
+        : symbol_table_(symbol_table),
+          removed_(0) {
+    }
+    DeadCodeEliminator(const DeadCodeEliminator&) = delete;
+    DeadCodeEliminator& operator=(const DeadCodeEliminator&) = delete;
+
+    // The new head of the statement sequence, nullptr if nothing is left.
+    // live_after says whether every variable may be read after it, as for
+    // a top-level statement of the streaming pipeline, or none as at the
+    // end of the program.
+    AstPtr eliminate(AstPtr sequence, bool live_after);
+    // statements removed so far
+    size_t removed() const { return removed_; }
+
+private:
+    typedef std::vector<bool> LiveSet;  // by slot
+
+    AstPtr eliminateSequence(AstPtr sequence, LiveSet& live);
+    bool flatten(AstPtr sequence, std::vector<AstPtr>& statements);
+    bool eliminateStatement(AstPtr statement, LiveSet& live);
+    void summarize(AstPtr sequence, LiveSet& gen, LiveSet& kill) const;
+    void summarizeStatement(AstPtr statement, LiveSet& gen, LiveSet& kill) const;
+
+private:
+    const SymbolTable& symbol_table_;
+    size_t removed_;
+};
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,136 @@
+#include "dominators.h"
+
+#include <utility>
+
+namespace nova {
+
+namespace ir {
+
+DominatorTree::DominatorTree(const Function& function)
+    : function_(function),
+      rpo_number_(static_cast<size_t>(function.blockCount()), -1),
+      idom_(static_cast<size_t>(function.blockCount()), kNoBlock),
+      children_(static_cast<size_t>(function.blockCount())),
+      preorder_(static_cast<size_t>(function.blockCount()), -1),
+      last_descendant_(static_cast<size_t>(function.blockCount()), -1) {
+    computeIdoms(function);
+    numberTree();
+}
+
+void DominatorTree::computeIdoms(const Function& function) {
+    // postorder with an explicit stack, programs nest deeply
+    std::vector<BlockId> postorder;
+    std::vector<bool> visited(static_cast<size_t>(function.blockCount()), false);
+    std::vector<std::pair<BlockId, int>> stack;
+    stack.push_back(std::make_pair(function.entry(), 0));
+    visited[index(function.entry())] = true;
+    while (!stack.empty()) {
+        BlockId block = stack.back().first;
+        const Terminator& terminator = function.block(block).terminator;
+        int next = stack.back().second++;
+        if (next < terminator.successorCount()) {
+            BlockId target = terminator.targets[next];
+            if (!visited[index(target)]) {
+                visited[index(target)] = true;
+                stack.push_back(std::make_pair(target, 0));
+            }
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+    reverse_postorder_.assign(postorder.rbegin(), postorder.rend());
+    for (size_t i = 0; i < reverse_postorder_.size(); ++i) {
+        rpo_number_[index(reverse_postorder_[i])] = static_cast<int>(i);
+    }
+
+    auto intersect = [this](BlockId a, BlockId b) {
+        while (a != b) {
+            while (rpo_number_[index(a)] > rpo_number_[index(b)]) {
+                a = idom_[index(a)];
+            }
+            while (rpo_number_[index(b)] > rpo_number_[index(a)]) {
+                b = idom_[index(b)];
+            }
+        }
+        return a;
+    };
+
+    BlockId entry = function.entry();
+    idom_[index(entry)] = entry;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 1; i < reverse_postorder_.size(); ++i) {
+            BlockId block = reverse_postorder_[i];
+            BlockId new_idom = kNoBlock;
+            for (BlockId pred : function.block(block).predecessors) {
+                if (idom_[index(pred)] == kNoBlock) {
+                    continue;
+                }
+                new_idom = new_idom == kNoBlock ? pred : intersect(pred, new_idom);
+            }
+            if (idom_[index(block)] != new_idom) {
+                idom_[index(block)] = new_idom;
+                changed = true;
+            }
+        }
+    }
+    idom_[index(entry)] = kNoBlock;
+    for (BlockId block : reverse_postorder_) {
+        if (idom_[index(block)] != kNoBlock) {
+            children_[index(idom_[index(block)])].push_back(block);
+        }
+    }
+}
+
+void DominatorTree::numberTree() {
+    int number = 0;
+    std::vector<std::pair<BlockId, size_t>> stack;
+    stack.push_back(std::make_pair(function_.entry(), 0));
+    preorder_[index(function_.entry())] = number++;
+    while (!stack.empty()) {
+        BlockId block = stack.back().first;
+        size_t next = stack.back().second++;
+        if (next < children_[index(block)].size()) {
+            BlockId child = children_[index(block)][next];
+            preorder_[index(child)] = number++;
+            stack.push_back(std::make_pair(child, 0));
+        } else {
+            last_descendant_[index(block)] = number - 1;
+            stack.pop_back();
+        }
+    }
+}
+
+bool DominatorTree::dominates(BlockId a, BlockId b) const {
+    if (!reachable(a) || !reachable(b)) {
+        return false;
+    }
+    return preorder_[index(a)] <= preorder_[index(b)] && preorder_[index(b)] <= last_descendant_[index(a)];
+}
+
+// Cooper, Harvey and Kennedy again: walk up from the predecessors of each
+// join to its immediate dominator.
+std::vector<std::vector<BlockId>> DominatorTree::frontiers() const {
+    std::vector<std::vector<BlockId>> frontier(static_cast<size_t>(function_.blockCount()));
+    for (BlockId block : reverse_postorder_) {
+        const std::vector<BlockId>& predecessors = function_.block(block).predecessors;
+        if (predecessors.size() < 2) {
+            continue;
+        }
+        for (BlockId pred : predecessors) {
+            for (BlockId runner = pred; reachable(runner) && runner != idom_[index(block)];
+                 runner = idom_[index(runner)]) {
+                std::vector<BlockId>& runner_frontier = frontier[index(runner)];
+                if (runner_frontier.empty() || runner_frontier.back() != block) {
+                    runner_frontier.push_back(block);
+                }
+            }
+        }
+    }
+    return frontier;
+}
+
+} // namespace ir
+
+} // namespace nova
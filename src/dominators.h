@@ -0,0 +1,54 @@
+#ifndef __NOVA_DOMINATORS_H__
+#define __NOVA_DOMINATORS_H__
+
+#include <vector>
+
+#include "ir.h"
+
+namespace nova {
+
+namespace ir {
+
+// The dominator tree of the blocks the entry of a function reaches, built
+// with the iterative algorithm of Cooper, Harvey and Kennedy over reverse
+// postorder. The tree is numbered in preorder, so dominates() is two
+// comparisons. It describes the function as it was when built.
+class DominatorTree {
+public:
+    explicit DominatorTree(const Function& function);
+    DominatorTree(const DominatorTree&) = delete;
+    DominatorTree& operator=(const DominatorTree&) = delete;
+
+    bool reachable(BlockId block) const { return rpo_number_[index(block)] >= 0; }
+    // kNoBlock for the entry and the unreachable blocks
+    BlockId idom(BlockId block) const { return idom_[index(block)]; }
+    const std::vector<BlockId>& children(BlockId block) const { return children_[index(block)]; }
+    // every block dominates itself
+    bool dominates(BlockId a, BlockId b) const;
+    // the reachable blocks, each after all of its dominators
+    const std::vector<BlockId>& reversePostorder() const { return reverse_postorder_; }
+
+    // the dominance frontier of every block
+    std::vector<std::vector<BlockId>> frontiers() const;
+
+private:
+    static size_t index(BlockId block) { return static_cast<size_t>(block); }
+
+    void computeIdoms(const Function& function);
+    void numberTree();
+
+private:
+    const Function& function_;
+    std::vector<BlockId> reverse_postorder_;
+    std::vector<int> rpo_number_;  // -1 for unreachable blocks
+    std::vector<BlockId> idom_;
+    std::vector<std::vector<BlockId>> children_;
+    std::vector<int> preorder_;    // of the tree
+    std::vector<int> last_descendant_;
+};
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
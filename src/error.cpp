@@ -8,19 +8,58 @@
 
 namespace nova {
 
+namespace {
+
+thread_local ErrorCapture* current_capture = nullptr;
+
+} // namespace
+
+ErrorCapture::ErrorCapture()
+    : previous_(current_capture),
+      error_count_(0) {
+    current_capture = this;
+}
+
+ErrorCapture::~ErrorCapture() {
+    current_capture = previous_;
+}
+
+bool ErrorCapture::capture() {
+    if (current_capture == nullptr) {
+        return false;
+    }
+    ++current_capture->error_count_;
+    return true;
+}
+
 void errorToken(const std::string& message) {
+    if (ErrorCapture::capture()) {
+        return;
+    }
     std::cerr << "Token Error: " << message << std::endl;
     Scanner::setErrorFlag(true);
 }
 
 void errorSyntax(const std::string& message) {
+    if (ErrorCapture::capture()) {
+        return;
+    }
     std::cerr << "Syntax Error: " << message << std::endl;
     Parser::setErrorFlag(true);
 }
 
 void errorCodeGen(const std::string& message) {
+    if (ErrorCapture::capture()) {
+        return;
+    }
     std::cerr << "Codegen Error: " << message << std::endl;
     CodeGenerator::setErrorFlag(true);
 }
+
+void clearErrorFlags() {
+    Scanner::setErrorFlag(false);
+    Parser::setErrorFlag(false);
+    CodeGenerator::setErrorFlag(false);
+}
     
 } // namespace nova
@@ -8,6 +8,29 @@ namespace nova {
 void errorToken(const std::string& message);
 void errorSyntax(const std::string& message);
 void errorCodeGen(const std::string& message);
+// resets the error flags of the scanner, parser and code generator
+void clearErrorFlags();
+
+// While alive, the errors raised on the thread that made it are counted
+// instead of printed and leave the error flags alone. Lets a worker thread
+// find out that its part of the input needs to be compiled again serially.
+class ErrorCapture {
+public:
+    ErrorCapture();
+    ~ErrorCapture();
+
+    ErrorCapture(const ErrorCapture&) = delete;
+    ErrorCapture& operator=(const ErrorCapture&) = delete;
+
+    int errorCount() const { return error_count_; }
+
+    // counts the error in the capture of the calling thread, if it has one
+    static bool capture();
+
+private:
+    ErrorCapture* previous_;
+    int error_count_;
+};
     
 } // namespace nova
 
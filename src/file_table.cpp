@@ -0,0 +1,76 @@
+#include "file_table.h"
+
+#include <algorithm>
+
+namespace nova {
+
+FileTable& FileTable::instance() {
+    static FileTable table;
+    return table;
+}
+
+FileTable::FileTable() {
+    files_.push_back(std::make_shared<SourceBuffer>("", "", 0));
+}
+
+uint32_t FileTable::add(const std::shared_ptr<const SourceBuffer>& buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_ids_.empty()) {
+        uint32_t file_id = free_ids_.back();
+        free_ids_.pop_back();
+        files_[file_id] = buffer;
+        return file_id;
+    }
+    files_.push_back(buffer);
+    return static_cast<uint32_t>(files_.size() - 1);
+}
+
+void FileTable::remove(uint32_t file_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_id != 0 && file_id < files_.size() && files_[file_id] != files_[0]) {
+        files_[file_id] = files_[0];
+        free_ids_.push_back(file_id);
+    }
+}
+
+std::shared_ptr<const SourceBuffer> FileTable::source(uint32_t file_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return files_[file_id < files_.size() ? file_id : 0];
+}
+
+std::string FileTable::name(uint32_t file_id) const {
+    return source(file_id)->name();
+}
+
+void FileTable::position(uint32_t file_id, uint32_t offset, int* line, int* column) const {
+    source(file_id)->position(offset, line, column);
+}
+
+LineResolver::LineResolver()
+    : file_id_(0),
+      cursor_(0) {
+}
+
+int LineResolver::line(const TokenLocation& location) {
+    if (source_ == nullptr || location.fileId() != file_id_) {
+        file_id_ = location.fileId();
+        source_ = FileTable::instance().source(file_id_);
+        cursor_ = 0;
+    }
+    const std::vector<uint32_t>& starts = source_->lineStarts();
+    uint32_t offset = location.offset();
+    if (offset < starts[cursor_]) {
+        cursor_ = 0;
+    }
+    // a few lines forward at most between two statements
+    for (int step = 0; step < 8 && cursor_ + 1 < starts.size() && starts[cursor_ + 1] <= offset; ++step) {
+        ++cursor_;
+    }
+    if (cursor_ + 1 < starts.size() && starts[cursor_ + 1] <= offset) {
+        cursor_ = static_cast<size_t>(std::upper_bound(starts.begin() + static_cast<std::ptrdiff_t>(cursor_),
+                                                       starts.end(), offset) - starts.begin()) - 1;
+    }
+    return static_cast<int>(cursor_) + 1;
+}
+
+} // namespace nova
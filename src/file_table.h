@@ -0,0 +1,74 @@
+#ifndef __NOVA_FILE_TABLE_H__
+#define __NOVA_FILE_TABLE_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+#include "source_buffer.h"
+#include "token.h"
+
+namespace nova {
+
+// Process wide table of the scanned sources. Source locations refer to a
+// file by its id and to a position by its byte offset, line and column are
+// computed on demand from the line index of the buffer. The table keeps the
+// buffers alive so that locations stay printable after their scanner is
+// gone. The ids of removed sources are given to later ones, so the table
+// does not grow with the number of programs a process compiles.
+class FileTable {
+public:
+    static const uint32_t kMaxFileSize = UINT32_MAX;
+
+    static FileTable& instance();
+
+    FileTable(const FileTable&) = delete;
+    FileTable& operator=(const FileTable&) = delete;
+
+    // id 0 is reserved for locations that do not belong to any file
+    uint32_t add(const std::shared_ptr<const SourceBuffer>& buffer);
+    // releases the buffer of a source whose locations will not be resolved
+    // any more, its id goes to the next source added
+    void remove(uint32_t file_id);
+
+    std::string name(uint32_t file_id) const;
+    // 1-based line and column of offset
+    void position(uint32_t file_id, uint32_t offset, int* line, int* column) const;
+    // the buffer of file_id, an empty one for no file
+    std::shared_ptr<const SourceBuffer> source(uint32_t file_id) const;
+
+private:
+    FileTable();
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<const SourceBuffer>> files_;
+    std::vector<uint32_t> free_ids_;
+};
+
+// Resolves the lines of locations without the lock of the FileTable, for
+// the walks over a program that ask for the line of every statement. The
+// table is only asked when the file changes. Offsets asked for in
+// increasing order, as a walk in source order does, move a cursor forward
+// over the line index instead of searching it.
+class LineResolver {
+public:
+    LineResolver();
+
+    LineResolver(const LineResolver&) = delete;
+    LineResolver& operator=(const LineResolver&) = delete;
+
+    int line(const TokenLocation& location);
+
+private:
+    uint32_t file_id_;
+    std::shared_ptr<const SourceBuffer> source_;
+    size_t cursor_;  // the line of the offset asked for last, from 0
+};
+    
+} // namespace nova
+
+#endif
@@ -0,0 +1,120 @@
+#include "flat_ast.h"
+
+namespace nova {
+
+FlatAst::FlatAst()
+    : root_(kNoNode) {
+}
+
+FlatAst::FlatAst(AstPtr root)
+    : root_(kNoNode) {
+    root_ = flattenSequence(root);
+}
+
+size_t FlatAst::bytesUsed() const {
+    return kinds_.size() * (sizeof(AstType) + sizeof(TokenValue) + sizeof(ExpressionType) +
+                            sizeof(TokenLocation) + 4 * sizeof(NodeId) + sizeof(uint32_t)) +
+           values_.size() * sizeof(int64_t) +
+           names_.size() * sizeof(StringPiece);
+}
+
+NodeId FlatAst::add(AstPtr node) {
+    NodeId id = static_cast<NodeId>(kinds_.size());
+    kinds_.push_back(node->getAstType());
+    ops_.push_back(TokenValue::kUnReserved);
+    types_.push_back(node->getExpressionType());
+    locations_.push_back(node->getTokenLocation());
+    for (std::vector<NodeId>& children : children_) {
+        children.push_back(kNoNode);
+    }
+    next_.push_back(kNoNode);
+    payload_.push_back(0);
+    return id;
+}
+
+NodeId FlatAst::flattenSequence(AstPtr node) {
+    NodeId head = kNoNode;
+    NodeId last = kNoNode;
+    for (; node != nullptr; node = node->next()) {
+        NodeId id = flatten(node);
+        if (last == kNoNode) {
+            head = id;
+        } else {
+            next_[last] = id;
+        }
+        last = id;
+    }
+    return head;
+}
+
+NodeId FlatAst::flatten(AstPtr node) {
+    NodeId id = add(node);
+    switch (node->getAstType()) {
+        case AstType::kIf: {
+            IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(node);
+            NodeId test_part = flattenSequence(ptr->testPart());
+            NodeId then_part = flattenSequence(ptr->thenPart());
+            NodeId else_part = flattenSequence(ptr->elsePart());
+            children_[0][id] = test_part;
+            children_[1][id] = then_part;
+            children_[2][id] = else_part;
+            break;
+        }
+
+        case AstType::kRepeat: {
+            RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(node);
+            NodeId body_part = flattenSequence(ptr->bodyPart());
+            NodeId test_part = flattenSequence(ptr->testPart());
+            children_[0][id] = body_part;
+            children_[1][id] = test_part;
+            break;
+        }
+
+        case AstType::kAssign: {
+            AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(node);
+            NodeId variable = flattenSequence(ptr->variable());
+            NodeId expression = flattenSequence(ptr->expression());
+            children_[0][id] = variable;
+            children_[1][id] = expression;
+            break;
+        }
+
+        case AstType::kRead: {
+            NodeId variable = flattenSequence(static_cast<ReadStatementAstPtr>(node)->variable());
+            children_[0][id] = variable;
+            break;
+        }
+
+        case AstType::kWrite: {
+            NodeId expression = flattenSequence(static_cast<WriteStatementAstPtr>(node)->expression());
+            children_[0][id] = expression;
+            break;
+        }
+
+        case AstType::kExpression: {
+            ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+            ops_[id] = ptr->operatorTokenValue();
+            NodeId left_part = flattenSequence(ptr->leftPart());
+            NodeId right_part = flattenSequence(ptr->rightPart());
+            children_[0][id] = left_part;
+            children_[1][id] = right_part;
+            break;
+        }
+
+        case AstType::kConstant:
+            payload_[id] = static_cast<uint32_t>(values_.size());
+            values_.push_back(static_cast<ConstantAstPtr>(node)->intValue());
+            break;
+
+        case AstType::kVariable:
+            payload_[id] = static_cast<uint32_t>(names_.size());
+            names_.push_back(static_cast<VariableAstPtr>(node)->name());
+            break;
+
+        default:
+            break;
+    }
+    return id;
+}
+
+} // namespace nova
@@ -0,0 +1,156 @@
+#ifndef __NOVA_FLAT_AST_H__
+#define __NOVA_FLAT_AST_H__
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "ast.h"
+
+namespace nova {
+
+typedef uint32_t NodeId;
+
+const NodeId kNoNode = UINT32_MAX;
+
+// The AST as a structure of arrays: node i is kind(i), op(i), its children
+// and its next statement, all stored in parallel vectors. Nodes are laid out
+// in preorder, so a walk over the tree mostly moves forward through memory.
+//
+// Children by kind:
+//   if          test, then, else
+//   repeat      body, test
+//   assign      variable, expression
+//   read        variable
+//   write       expression
+//   expression  left, right
+// Constants and variables keep their value or name in a side table indexed
+// by payload(i).
+class FlatAst {
+public:
+    FlatAst();
+    // copies the pointer AST rooted at root
+    explicit FlatAst(AstPtr root);
+
+    FlatAst(const FlatAst&) = delete;
+    FlatAst& operator=(const FlatAst&) = delete;
+    FlatAst(FlatAst&&) = default;
+    FlatAst& operator=(FlatAst&&) = default;
+
+    NodeId root() const { return root_; }
+    size_t size() const { return kinds_.size(); }
+    // bytes held by the node arrays
+    size_t bytesUsed() const;
+
+    AstType kind(NodeId node) const { return kinds_[node]; }
+    TokenValue op(NodeId node) const { return ops_[node]; }
+    ExpressionType type(NodeId node) const { return types_[node]; }
+    void setType(NodeId node, ExpressionType type) { types_[node] = type; }
+    TokenLocation location(NodeId node) const { return locations_[node]; }
+    NodeId child(NodeId node, int i) const { return children_[i][node]; }
+    NodeId next(NodeId node) const { return next_[node]; }
+
+    int64_t value(NodeId node) const { return values_[payload_[node]]; }
+    StringPiece name(NodeId node) const { return names_[payload_[node]]; }
+
+private:
+    NodeId flatten(AstPtr node);
+    NodeId flattenSequence(AstPtr node);
+    NodeId add(AstPtr node);
+
+private:
+    std::vector<AstType> kinds_;
+    std::vector<TokenValue> ops_;
+    std::vector<ExpressionType> types_;
+    std::vector<TokenLocation> locations_;
+    std::vector<NodeId> children_[3];
+    std::vector<NodeId> next_;
+    std::vector<uint32_t> payload_;
+    std::vector<int64_t> values_;
+    std::vector<StringPiece> names_;
+    NodeId root_;
+};
+
+// Post-order walk over a FlatAst statement sequence, dispatched on the kind
+// tag to the visit* member of Derived. Leaves are visited in source order.
+template<typename Derived>
+class FlatAstVisitor {
+public:
+    explicit FlatAstVisitor(const FlatAst& ast)
+        : ast_(ast) {
+    }
+
+    void traverse(NodeId node) {
+        for (; node != kNoNode; node = ast_.next(node)) {
+            switch (ast_.kind(node)) {
+                case AstType::kIf:
+                    traverse(ast_.child(node, 0));
+                    traverse(ast_.child(node, 1));
+                    traverse(ast_.child(node, 2));
+                    derived().visitIf(node);
+                    break;
+
+                case AstType::kRepeat:
+                    traverse(ast_.child(node, 0));
+                    traverse(ast_.child(node, 1));
+                    derived().visitRepeat(node);
+                    break;
+
+                case AstType::kAssign:
+                    traverse(ast_.child(node, 0));
+                    traverse(ast_.child(node, 1));
+                    derived().visitAssign(node);
+                    break;
+
+                case AstType::kRead:
+                    traverse(ast_.child(node, 0));
+                    derived().visitRead(node);
+                    break;
+
+                case AstType::kWrite:
+                    traverse(ast_.child(node, 0));
+                    derived().visitWrite(node);
+                    break;
+
+                case AstType::kExpression:
+                    traverse(ast_.child(node, 0));
+                    traverse(ast_.child(node, 1));
+                    derived().visitExpression(node);
+                    break;
+
+                case AstType::kConstant:
+                    derived().visitConstant(node);
+                    break;
+
+                case AstType::kVariable:
+                    derived().visitVariable(node);
+                    break;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    void visitIf(NodeId) {}
+    void visitRepeat(NodeId) {}
+    void visitAssign(NodeId) {}
+    void visitRead(NodeId) {}
+    void visitWrite(NodeId) {}
+    void visitExpression(NodeId) {}
+    void visitConstant(NodeId) {}
+    void visitVariable(NodeId) {}
+
+protected:
+    const FlatAst& ast() const { return ast_; }
+
+private:
+    Derived& derived() { return *static_cast<Derived*>(this); }
+
+private:
+    const FlatAst& ast_;
+};
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,603 @@
+#include "ir.h"
+
+#include "dominators.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+const Opcode kOpcodes[] = {
+    Opcode::kConstant, Opcode::kInitial, Opcode::kLoad, Opcode::kCopy,
+    Opcode::kAdd, Opcode::kSub, Opcode::kMul, Opcode::kDiv, Opcode::kLess, Opcode::kEqual,
+    Opcode::kRead, Opcode::kWrite,
+};
+
+std::string valueName(ValueId value) {
+    return "v" + std::to_string(value);
+}
+
+std::string blockName(BlockId block) {
+    return "b" + std::to_string(block);
+}
+
+void writeLine(std::ostream& os, int line) {
+    if (line != 0) {
+        os << " @" << line;
+    }
+    os << '\n';
+}
+
+// Tokens of one line of the text form. Numbers are read with strtoll, so
+// each token is checked to be whole.
+class LineReader {
+public:
+    explicit LineReader(const std::string& line) {
+        std::istringstream is(line);
+        for (std::string token; is >> token;) {
+            tokens_.push_back(token);
+        }
+    }
+
+    bool empty() const { return tokens_.empty(); }
+    size_t size() const { return tokens_.size(); }
+    const std::string& operator[](size_t i) const { return tokens_[i]; }
+
+private:
+    std::vector<std::string> tokens_;
+};
+
+bool parseNumber(const std::string& text, size_t start, int64_t* value) {
+    if (start >= text.size()) {
+        return false;
+    }
+    char* end = nullptr;
+    *value = strtoll(text.c_str() + start, &end, 10);
+    return *end == '\0';
+}
+
+bool parseId(const std::string& text, char prefix, int* id) {
+    int64_t value = 0;
+    if (text.empty() || text[0] != prefix || !parseNumber(text, 1, &value) || value < 0 || value > (1 << 30)) {
+        return false;
+    }
+    *id = static_cast<int>(value);
+    return true;
+}
+
+} // namespace
+
+const char* opcodeName(Opcode op) {
+    switch (op) {
+        case Opcode::kConstant: return "const";
+        case Opcode::kInitial: return "initial";
+        case Opcode::kLoad: return "load";
+        case Opcode::kCopy: return "copy";
+        case Opcode::kAdd: return "add";
+        case Opcode::kSub: return "sub";
+        case Opcode::kMul: return "mul";
+        case Opcode::kDiv: return "div";
+        case Opcode::kLess: return "lt";
+        case Opcode::kEqual: return "eq";
+        case Opcode::kRead: return "read";
+        case Opcode::kWrite: return "write";
+        default: return "?";
+    }
+}
+
+int operandCount(Opcode op) {
+    switch (op) {
+        case Opcode::kCopy:
+        case Opcode::kWrite:
+            return 1;
+
+        default:
+            return isBinary(op) ? 2 : 0;
+    }
+}
+
+bool isBinary(Opcode op) {
+    switch (op) {
+        case Opcode::kAdd:
+        case Opcode::kSub:
+        case Opcode::kMul:
+        case Opcode::kDiv:
+        case Opcode::kLess:
+        case Opcode::kEqual:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+int Terminator::successorCount() const {
+    switch (kind) {
+        case TerminatorKind::kJump: return 1;
+        case TerminatorKind::kBranch: return 2;
+        default: return 0;
+    }
+}
+
+Function::Function(const std::vector<std::string>& variables)
+    : variables_(variables),
+      value_count_(0),
+      ssa_(false) {
+}
+
+BlockId Function::addBlock() {
+    BlockId id = blockCount();
+    blocks_.push_back(BasicBlock());
+    layout_.push_back(id);
+    return id;
+}
+
+BlockId Function::insertBlockAfter(BlockId after) {
+    BlockId id = blockCount();
+    blocks_.push_back(BasicBlock());
+    for (auto it = layout_.begin(); it != layout_.end(); ++it) {
+        if (*it == after) {
+            layout_.insert(it + 1, id);
+            return id;
+        }
+    }
+    layout_.push_back(id);
+    return id;
+}
+
+void Function::computePredecessors() {
+    for (BasicBlock& b : blocks_) {
+        b.predecessors.clear();
+    }
+    for (BlockId id : layout_) {
+        const Terminator& terminator = block(id).terminator;
+        for (int i = 0; i < terminator.successorCount(); ++i) {
+            block(terminator.targets[i]).predecessors.push_back(id);
+        }
+    }
+}
+
+void Function::removeUnreachableBlocks() {
+    std::vector<bool> reachable(blocks_.size(), false);
+    std::vector<BlockId> stack(1, entry());
+    reachable[static_cast<size_t>(entry())] = true;
+    while (!stack.empty()) {
+        const Terminator& terminator = block(stack.back()).terminator;
+        stack.pop_back();
+        for (int i = 0; i < terminator.successorCount(); ++i) {
+            BlockId target = terminator.targets[i];
+            if (!reachable[static_cast<size_t>(target)]) {
+                reachable[static_cast<size_t>(target)] = true;
+                stack.push_back(target);
+            }
+        }
+    }
+
+    std::vector<BlockId> layout;
+    for (BlockId id : layout_) {
+        if (reachable[static_cast<size_t>(id)]) {
+            layout.push_back(id);
+        } else {
+            blocks_[static_cast<size_t>(id)] = BasicBlock();
+        }
+    }
+    layout_.swap(layout);
+    for (BlockId id : layout_) {
+        BasicBlock& b = block(id);
+        size_t kept = 0;
+        for (size_t i = 0; i < b.predecessors.size(); ++i) {
+            if (!reachable[static_cast<size_t>(b.predecessors[i])]) {
+                continue;
+            }
+            b.predecessors[kept] = b.predecessors[i];
+            for (Phi& phi : b.phis) {
+                phi.operands[kept] = phi.operands[i];
+            }
+            ++kept;
+        }
+        b.predecessors.resize(kept);
+        for (Phi& phi : b.phis) {
+            phi.operands.resize(kept);
+        }
+    }
+}
+
+void Function::dump(std::ostream& os) const {
+    auto result = [this](ValueId value, int variable) {
+        std::string name = valueName(value);
+        return variable >= 0 ? name + ":" + variableName(variable) : name;
+    };
+
+    os << "vars";
+    for (const std::string& name : variables_) {
+        os << ' ' << name;
+    }
+    os << '\n';
+    if (ssa_) {
+        os << "ssa\n";
+    }
+    for (BlockId id : layout_) {
+        const BasicBlock& b = block(id);
+        os << blockName(id) << ':';
+        if (!b.predecessors.empty()) {
+            os << " preds";
+            for (BlockId pred : b.predecessors) {
+                os << ' ' << blockName(pred);
+            }
+        }
+        os << '\n';
+        for (const Phi& phi : b.phis) {
+            os << "    " << result(phi.result, phi.variable) << " = phi";
+            for (size_t i = 0; i < phi.operands.size(); ++i) {
+                os << ' ' << blockName(b.predecessors[i]) << ':' << valueName(phi.operands[i]);
+            }
+            os << '\n';
+        }
+        for (const Instruction& ins : b.instructions) {
+            os << "    ";
+            if (ins.op == Opcode::kLoad) {
+                os << valueName(ins.result) << " = load " << variableName(ins.variable);
+            } else {
+                if (ins.result != kNoValue) {
+                    os << result(ins.result, ins.variable) << " = ";
+                }
+                os << opcodeName(ins.op);
+                if (ins.op == Opcode::kConstant) {
+                    os << ' ' << ins.constant;
+                }
+                for (int i = 0; i < operandCount(ins.op); ++i) {
+                    os << ' ' << valueName(ins.operands[i]);
+                }
+            }
+            writeLine(os, ins.line);
+        }
+        const Terminator& terminator = b.terminator;
+        switch (terminator.kind) {
+            case TerminatorKind::kJump:
+                os << "    jump " << blockName(terminator.targets[0]);
+                break;
+
+            case TerminatorKind::kBranch:
+                os << "    branch " << valueName(terminator.condition) << ' '
+                   << blockName(terminator.targets[0]) << ' ' << blockName(terminator.targets[1]);
+                break;
+
+            case TerminatorKind::kHalt:
+                os << "    halt";
+                break;
+        }
+        writeLine(os, terminator.line);
+    }
+}
+
+bool Function::parse(std::istream& is, Function* function, std::string* error) {
+    Function parsed((std::vector<std::string>()));
+    std::unordered_map<std::string, int> slots;
+    BasicBlock* current = nullptr;
+    std::vector<bool> has_terminator;
+    int line_number = 0;
+    int max_value = -1;
+
+    auto fail = [error, &line_number](const std::string& message) {
+        *error = "line " + std::to_string(line_number) + ": " + message;
+        return false;
+    };
+    auto value = [&max_value](const std::string& text, ValueId* id) {
+        if (!parseId(text, 'v', id)) {
+            return false;
+        }
+        max_value = std::max(max_value, *id);
+        return true;
+    };
+    auto block = [&parsed](const std::string& text, BlockId* id) {
+        if (!parseId(text, 'b', id)) {
+            return false;
+        }
+        while (parsed.blockCount() <= *id) {
+            parsed.blocks_.push_back(BasicBlock());
+        }
+        return true;
+    };
+
+    for (std::string text; std::getline(is, text);) {
+        ++line_number;
+        LineReader line(text);
+        if (line.empty()) {
+            continue;
+        }
+        size_t size = line.size();
+        int source_line = 0;
+        if (line[size - 1][0] == '@') {
+            int64_t number = 0;
+            if (!parseNumber(line[size - 1], 1, &number)) {
+                return fail("bad source line " + line[size - 1]);
+            }
+            source_line = static_cast<int>(number);
+            --size;
+        }
+
+        if (line[0] == "vars") {
+            for (size_t i = 1; i < size; ++i) {
+                slots[line[i]] = static_cast<int>(parsed.variables_.size());
+                parsed.variables_.push_back(line[i]);
+            }
+            continue;
+        }
+        if (line[0] == "ssa" && size == 1) {
+            parsed.ssa_ = true;
+            continue;
+        }
+        if (line[0].back() == ':') {
+            BlockId id = kNoBlock;
+            if (!block(line[0].substr(0, line[0].size() - 1), &id)) {
+                return fail("bad block " + line[0]);
+            }
+            parsed.layout_.push_back(id);
+            current = &parsed.blocks_[static_cast<size_t>(id)];
+            for (size_t i = 2; i < size; ++i) {
+                BlockId pred = kNoBlock;
+                if (line[1] != "preds" || !block(line[i], &pred)) {
+                    return fail("bad predecessor " + line[i]);
+                }
+                current = &parsed.blocks_[static_cast<size_t>(id)];
+                current->predecessors.push_back(pred);
+            }
+            continue;
+        }
+        if (current == nullptr) {
+            return fail("instruction outside of a block");
+        }
+
+        if (line[0] == "jump" || line[0] == "branch" || line[0] == "halt") {
+            Terminator terminator;
+            terminator.line = source_line;
+            if (line[0] == "jump") {
+                terminator.kind = TerminatorKind::kJump;
+                if (size != 2 || !block(line[1], &terminator.targets[0])) {
+                    return fail("bad jump");
+                }
+            } else if (line[0] == "branch") {
+                terminator.kind = TerminatorKind::kBranch;
+                if (size != 4 || !value(line[1], &terminator.condition) ||
+                    !block(line[2], &terminator.targets[0]) || !block(line[3], &terminator.targets[1])) {
+                    return fail("bad branch");
+                }
+            } else if (size != 1) {
+                return fail("bad halt");
+            }
+            // block() may have moved the blocks
+            current = &parsed.blocks_[static_cast<size_t>(parsed.layout_.back())];
+            current->terminator = terminator;
+            continue;
+        }
+
+        ValueId result = kNoValue;
+        int variable = -1;
+        size_t next = 0;
+        if (size >= 3 && line[1] == "=") {
+            std::string name = line[0];
+            size_t colon = name.find(':');
+            if (colon != std::string::npos) {
+                auto it = slots.find(name.substr(colon + 1));
+                if (it == slots.end()) {
+                    return fail("unknown variable " + name.substr(colon + 1));
+                }
+                variable = it->second;
+                name.resize(colon);
+            }
+            if (!value(name, &result)) {
+                return fail("bad value " + line[0]);
+            }
+            next = 2;
+        }
+
+        const std::string& op_name = line[next];
+        if (op_name == "phi") {
+            Phi phi(result, variable);
+            phi.operands.resize(current->predecessors.size(), kNoValue);
+            for (size_t i = next + 1; i < size; ++i) {
+                size_t colon = line[i].find(':');
+                BlockId pred = kNoBlock;
+                ValueId operand = kNoValue;
+                if (colon == std::string::npos || !parseId(line[i].substr(0, colon), 'b', &pred) ||
+                    !value(line[i].substr(colon + 1), &operand)) {
+                    return fail("bad phi operand " + line[i]);
+                }
+                size_t index = 0;
+                while (index < current->predecessors.size() &&
+                       (current->predecessors[index] != pred || phi.operands[index] != kNoValue)) {
+                    ++index;
+                }
+                if (index == current->predecessors.size()) {
+                    return fail("phi operand for no predecessor " + line[i]);
+                }
+                phi.operands[index] = operand;
+            }
+            current->phis.push_back(phi);
+            continue;
+        }
+
+        bool known = false;
+        for (Opcode op : kOpcodes) {
+            if (op_name != opcodeName(op)) {
+                continue;
+            }
+            known = true;
+            Instruction ins(op, result, source_line);
+            ins.variable = variable;
+            size_t operand_start = next + 1;
+            if (op == Opcode::kConstant) {
+                if (operand_start >= size || !parseNumber(line[operand_start], 0, &ins.constant)) {
+                    return fail("bad constant");
+                }
+                ++operand_start;
+            } else if (op == Opcode::kLoad) {
+                auto it = operand_start < size ? slots.find(line[operand_start]) : slots.end();
+                if (it == slots.end()) {
+                    return fail("bad load");
+                }
+                ins.variable = it->second;
+                ++operand_start;
+            }
+            if (size - operand_start != static_cast<size_t>(operandCount(op)) ||
+                (result == kNoValue) != (op == Opcode::kWrite)) {
+                return fail(std::string("bad ") + opcodeName(op));
+            }
+            for (int i = 0; i < operandCount(op); ++i) {
+                if (!value(line[operand_start + static_cast<size_t>(i)], &ins.operands[i])) {
+                    return fail("bad operand " + line[operand_start + static_cast<size_t>(i)]);
+                }
+            }
+            current->instructions.push_back(ins);
+        }
+        if (!known) {
+            return fail("unknown instruction " + op_name);
+        }
+    }
+
+    if (parsed.layout_.empty()) {
+        return fail("no blocks");
+    }
+    parsed.value_count_ = max_value + 1;
+    *function = std::move(parsed);
+    return true;
+}
+
+bool Function::verify(std::string* error) const {
+    auto fail = [error](const std::string& message) {
+        *error = message;
+        return false;
+    };
+
+    std::vector<bool> in_layout(blocks_.size(), false);
+    for (BlockId id : layout_) {
+        if (id < 0 || id >= blockCount() || in_layout[static_cast<size_t>(id)]) {
+            return fail("bad layout entry " + blockName(id));
+        }
+        in_layout[static_cast<size_t>(id)] = true;
+    }
+    // every edge once in the predecessors of its target
+    std::vector<std::vector<BlockId>> predecessors(blocks_.size());
+    for (BlockId id : layout_) {
+        const Terminator& terminator = block(id).terminator;
+        if (terminator.kind == TerminatorKind::kBranch &&
+            (terminator.condition < 0 || terminator.condition >= value_count_)) {
+            return fail(blockName(id) + ": bad branch condition");
+        }
+        for (int i = 0; i < terminator.successorCount(); ++i) {
+            BlockId target = terminator.targets[i];
+            if (target < 0 || target >= blockCount() || !in_layout[static_cast<size_t>(target)]) {
+                return fail(blockName(id) + ": bad successor");
+            }
+            predecessors[static_cast<size_t>(target)].push_back(id);
+        }
+    }
+    for (BlockId id : layout_) {
+        std::vector<BlockId> expected = predecessors[static_cast<size_t>(id)];
+        std::vector<BlockId> actual = block(id).predecessors;
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        if (expected != actual) {
+            return fail(blockName(id) + ": predecessors do not match the edges");
+        }
+        for (const Phi& phi : block(id).phis) {
+            if (!ssa_) {
+                return fail(blockName(id) + ": phi outside of SSA form");
+            }
+            if (phi.operands.size() != block(id).predecessors.size()) {
+                return fail(blockName(id) + ": phi " + valueName(phi.result) + " has the wrong operand count");
+            }
+        }
+        for (const Instruction& ins : block(id).instructions) {
+            if (ins.op == Opcode::kLoad && ssa_) {
+                return fail(blockName(id) + ": load in SSA form");
+            }
+            for (int i = 0; i < operandCount(ins.op); ++i) {
+                if (ins.operands[i] < 0 || ins.operands[i] >= value_count_) {
+                    return fail(blockName(id) + ": bad operand of " + opcodeName(ins.op));
+                }
+            }
+        }
+    }
+    if (!ssa_) {
+        return true;
+    }
+
+    // defined once, and before every use
+    struct Definition {
+        BlockId block;
+        int index;  // -1 for phis
+    };
+    std::vector<Definition> definitions(static_cast<size_t>(value_count_), Definition{kNoBlock, 0});
+    auto define = [&definitions](ValueId value, BlockId id, int index) {
+        Definition& definition = definitions[static_cast<size_t>(value)];
+        if (definition.block != kNoBlock) {
+            return false;
+        }
+        definition.block = id;
+        definition.index = index;
+        return true;
+    };
+    for (BlockId id : layout_) {
+        const BasicBlock& b = block(id);
+        for (const Phi& phi : b.phis) {
+            if (phi.result < 0 || phi.result >= value_count_ || !define(phi.result, id, -1)) {
+                return fail(valueName(phi.result) + " is defined more than once");
+            }
+        }
+        for (size_t i = 0; i < b.instructions.size(); ++i) {
+            ValueId result = b.instructions[i].result;
+            if (result != kNoValue && (result < 0 || result >= value_count_ || !define(result, id, static_cast<int>(i)))) {
+                return fail(valueName(result) + " is defined more than once");
+            }
+        }
+    }
+
+    DominatorTree dominators(*this);
+    // value used at position index of block id, which is past the end for
+    // the terminator and the phi operands of the successors
+    auto available = [&](ValueId value, BlockId id, int index) {
+        const Definition& definition = definitions[static_cast<size_t>(value)];
+        if (definition.block == kNoBlock) {
+            return false;
+        }
+        if (definition.block == id) {
+            return definition.index < index;
+        }
+        return dominators.dominates(definition.block, id);
+    };
+    for (BlockId id : layout_) {
+        const BasicBlock& b = block(id);
+        for (const Phi& phi : b.phis) {
+            for (size_t i = 0; i < phi.operands.size(); ++i) {
+                if (!available(phi.operands[i], b.predecessors[i], 1 << 30)) {
+                    return fail(blockName(id) + ": phi operand " + valueName(phi.operands[i]) +
+                                " does not dominate its edge");
+                }
+            }
+        }
+        for (size_t i = 0; i < b.instructions.size(); ++i) {
+            const Instruction& ins = b.instructions[i];
+            for (int j = 0; j < operandCount(ins.op); ++j) {
+                if (!available(ins.operands[j], id, static_cast<int>(i))) {
+                    return fail(blockName(id) + ": " + valueName(ins.operands[j]) + " does not dominate its use");
+                }
+            }
+        }
+        if (b.terminator.kind == TerminatorKind::kBranch && !available(b.terminator.condition, id, 1 << 30)) {
+            return fail(blockName(id) + ": " + valueName(b.terminator.condition) + " does not dominate its use");
+        }
+    }
+    return true;
+}
+
+} // namespace ir
+
+} // namespace nova
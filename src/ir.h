@@ -0,0 +1,187 @@
+#ifndef __NOVA_IR_H__
+#define __NOVA_IR_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+namespace nova {
+
+namespace ir {
+
+// The mid-end representation between the checked AST and TM code: a
+// control-flow graph of basic blocks over numbered values.
+//
+// IrBuilder lowers the AST with a kLoad for every variable read and a kCopy
+// tagged with the variable for every assignment. constructSsa() turns the
+// loads into uses of the reaching definitions and adds the phis, after
+// which every value is defined once, destructSsa() replaces the phis by
+// copies again and TmLowering generates the code.
+//
+// The copies and phis defining a variable, and its kInitial, are versions
+// of it and share the variable's memory slot in the generated code, so a
+// pass must not make two versions of one variable live at the same time;
+// values of temporaries are free to move.
+
+typedef int ValueId;
+typedef int BlockId;
+
+const ValueId kNoValue = -1;
+const BlockId kNoBlock = -1;
+
+enum class Opcode {
+    kConstant,  // result = constant
+    kInitial,   // result = the variable before the program runs, 0
+    kLoad,      // result = the variable, before SSA construction only
+    kCopy,      // result = operand 0
+    kAdd,       // result = operand 0 op operand 1, as the TM machine does it
+    kSub,
+    kMul,
+    kDiv,
+    kLess,
+    kEqual,
+    kRead,      // result = an integer read from the input
+    kWrite,     // writes operand 0
+};
+
+const char* opcodeName(Opcode op);
+// number of operands of op
+int operandCount(Opcode op);
+bool isBinary(Opcode op);
+
+struct Instruction {
+    Instruction(Opcode instruction_op, ValueId result_value, int source_line)
+        : op(instruction_op),
+          result(result_value),
+          constant(0),
+          variable(-1),
+          line(source_line) {
+        operands[0] = kNoValue;
+        operands[1] = kNoValue;
+    }
+
+    Opcode op;
+    ValueId result;  // kNoValue for kWrite
+    ValueId operands[2];
+    int64_t constant;
+    int variable;    // slot of the variable the result is a version of, or loaded, -1 for temporaries
+    int line;        // TINY source line, 0 for none
+};
+
+// whether the result of ins is a version of its variable
+inline bool definesVariable(const Instruction& ins) {
+    return ins.variable >= 0 && ins.op != Opcode::kLoad;
+}
+
+struct Phi {
+    Phi(ValueId result_value, int phi_variable)
+        : result(result_value),
+          variable(phi_variable) {
+    }
+
+    ValueId result;
+    int variable;
+    std::vector<ValueId> operands;  // by predecessor
+};
+
+enum class TerminatorKind {
+    kJump,
+    kBranch,
+    kHalt,
+};
+
+struct Terminator {
+    Terminator()
+        : kind(TerminatorKind::kHalt),
+          condition(kNoValue),
+          line(0) {
+        targets[0] = kNoBlock;
+        targets[1] = kNoBlock;
+    }
+
+    int successorCount() const;
+
+    TerminatorKind kind;
+    ValueId condition;
+    BlockId targets[2];  // jump: targets[0], branch: targets[0] if the condition is not 0, else targets[1]
+    int line;
+};
+
+struct BasicBlock {
+    std::vector<Phi> phis;
+    std::vector<Instruction> instructions;
+    Terminator terminator;
+    std::vector<BlockId> predecessors;  // one per incoming edge, in the order of the phi operands
+};
+
+class Function {
+public:
+    // variables are the names of the slots
+    explicit Function(const std::vector<std::string>& variables);
+    Function(Function&&) = default;
+    Function& operator=(Function&&) = default;
+    Function(const Function&) = delete;
+    Function& operator=(const Function&) = delete;
+
+    // a new block at the end of the layout
+    BlockId addBlock();
+    // a new block placed right after block after in the layout
+    BlockId insertBlockAfter(BlockId after);
+    BasicBlock& block(BlockId id) { return blocks_[static_cast<size_t>(id)]; }
+    const BasicBlock& block(BlockId id) const { return blocks_[static_cast<size_t>(id)]; }
+    int blockCount() const { return static_cast<int>(blocks_.size()); }
+    // the order the blocks are printed and their code emitted in, the entry first
+    const std::vector<BlockId>& layout() const { return layout_; }
+    BlockId entry() const { return layout_.front(); }
+
+    ValueId newValue() { return value_count_++; }
+    int valueCount() const { return value_count_; }
+
+    int variableCount() const { return static_cast<int>(variables_.size()); }
+    const std::string& variableName(int slot) const { return variables_[static_cast<size_t>(slot)]; }
+
+    bool isSsa() const { return ssa_; }
+    void setSsa(bool ssa) { ssa_ = ssa; }
+
+    // rebuilds the predecessor lists from the terminators of the blocks in
+    // the layout, in layout order
+    void computePredecessors();
+    // drops the blocks the entry can not reach from the layout and the
+    // predecessor lists, along with their phi operands
+    void removeUnreachableBlocks();
+
+    // Text form, one block after another in layout order:
+    //   vars x y
+    //   ssa
+    //   b0:
+    //     v0 = const 1 @3
+    //     v1:x = copy v0 @3
+    //     branch v1 b1 b2
+    //   b1: preds b0
+    //     v4:x = phi b0:v1 b3:v7
+    // A value of a variable is written v<n>:<variable>, @<n> is the source
+    // line. parse() reads it back, the blocks keep their numbers.
+    void dump(std::ostream& os) const;
+    static bool parse(std::istream& is, Function* function, std::string* error);
+
+    // Checks the structure, and in SSA form that every value is defined once
+    // and every use is dominated by its definition. false and a message for
+    // the first problem found.
+    bool verify(std::string* error) const;
+
+private:
+    std::vector<std::string> variables_;
+    std::vector<BasicBlock> blocks_;
+    std::vector<BlockId> layout_;
+    int value_count_;
+    bool ssa_;
+};
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
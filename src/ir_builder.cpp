@@ -0,0 +1,178 @@
+#include "ir_builder.h"
+
+#include "error.h"
+
+#include <string>
+#include <vector>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+Opcode binaryOpcode(TokenValue value) {
+    switch (value) {
+        case TokenValue::kPlus: return Opcode::kAdd;
+        case TokenValue::kMinus: return Opcode::kSub;
+        case TokenValue::kMultiply: return Opcode::kMul;
+        case TokenValue::kDivide: return Opcode::kDiv;
+        case TokenValue::kLess: return Opcode::kLess;
+        default: return Opcode::kEqual;
+    }
+}
+
+} // namespace
+
+Function IrBuilder::build(AstPtr sequence) {
+    std::vector<std::string> variables;
+    for (int slot = 0; slot < symbol_table_.size(); ++slot) {
+        variables.push_back(symbol_table_.record(slot).name.as_string());
+    }
+    Function function(variables);
+    function_ = &function;
+    current_ = function.addBlock();
+    buildSequence(sequence);
+    terminate(TerminatorKind::kHalt, kNoValue, kNoBlock, kNoBlock, 0);
+    function.computePredecessors();
+    function_ = nullptr;
+    return function;
+}
+
+void IrBuilder::buildSequence(AstPtr node) {
+    for (; node != nullptr; node = node->next()) {
+        int line = lines_.line(node->getTokenLocation());
+        switch (node->getAstType()) {
+            case AstType::kIf:
+                buildIfStatement(static_cast<IfStatementAstPtr>(node));
+                break;
+
+            case AstType::kRepeat:
+                buildRepeatStatement(static_cast<RepeatStatementAstPtr>(node));
+                break;
+
+            case AstType::kAssign: {
+                AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(node);
+                ValueId value = buildExpression(ptr->expression());
+                Instruction& copy = append(Opcode::kCopy, function_->newValue(), line);
+                copy.operands[0] = value;
+                copy.variable = ptr->variable()->slot();
+                break;
+            }
+
+            case AstType::kRead: {
+                ReadStatementAstPtr ptr = static_cast<ReadStatementAstPtr>(node);
+                append(Opcode::kRead, function_->newValue(), line).variable = ptr->variable()->slot();
+                break;
+            }
+
+            case AstType::kWrite: {
+                ValueId value = buildExpression(static_cast<WriteStatementAstPtr>(node)->expression());
+                append(Opcode::kWrite, kNoValue, line).operands[0] = value;
+                break;
+            }
+
+            default:
+                errorCodeGen("Invalid ast type");
+                break;
+        }
+    }
+}
+
+void IrBuilder::buildIfStatement(IfStatementAstPtr node) {
+    int line = lines_.line(node->getTokenLocation());
+    ValueId test = buildExpression(node->testPart());
+    BlockId test_block = current_;
+
+    BlockId then_block = function_->addBlock();
+    current_ = then_block;
+    buildSequence(node->thenPart());
+    BlockId then_end = current_;
+
+    BlockId else_block = kNoBlock;
+    BlockId else_end = kNoBlock;
+    if (node->elsePart() != nullptr) {
+        else_block = function_->addBlock();
+        current_ = else_block;
+        buildSequence(node->elsePart());
+        else_end = current_;
+    }
+
+    BlockId join = function_->addBlock();
+    current_ = test_block;
+    terminate(TerminatorKind::kBranch, test, then_block, else_block != kNoBlock ? else_block : join, line);
+    current_ = then_end;
+    terminate(TerminatorKind::kJump, kNoValue, join, kNoBlock, line);
+    if (else_end != kNoBlock) {
+        current_ = else_end;
+        terminate(TerminatorKind::kJump, kNoValue, join, kNoBlock, line);
+    }
+    current_ = join;
+}
+
+void IrBuilder::buildRepeatStatement(RepeatStatementAstPtr node) {
+    int line = lines_.line(node->getTokenLocation());
+    BlockId body = function_->addBlock();
+    terminate(TerminatorKind::kJump, kNoValue, body, kNoBlock, line);
+    current_ = body;
+    buildSequence(node->bodyPart());
+    ValueId test = buildExpression(node->testPart());
+    BlockId exit = function_->addBlock();
+    terminate(TerminatorKind::kBranch, test, exit, body, line);
+    current_ = exit;
+}
+
+ValueId IrBuilder::buildExpression(AstPtr node) {
+    int line = lines_.line(node->getTokenLocation());
+    switch (node->getAstType()) {
+        case AstType::kConstant: {
+            ValueId result = function_->newValue();
+            append(Opcode::kConstant, result, line).constant = static_cast<ConstantAstPtr>(node)->intValue();
+            return result;
+        }
+
+        case AstType::kVariable: {
+            ValueId result = function_->newValue();
+            append(Opcode::kLoad, result, line).variable = static_cast<VariableAstPtr>(node)->slot();
+            return result;
+        }
+
+        case AstType::kExpression: {
+            ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+            ValueId left = buildExpression(ptr->leftPart());
+            ValueId right = buildExpression(ptr->rightPart());
+            ValueId result = function_->newValue();
+            Instruction& ins = append(binaryOpcode(ptr->operatorTokenValue()), result, line);
+            ins.operands[0] = left;
+            ins.operands[1] = right;
+            return result;
+        }
+
+        default: {
+            // keeps the function well formed, nothing is emitted after an error
+            errorCodeGen("Invalid ast type");
+            ValueId result = function_->newValue();
+            append(Opcode::kConstant, result, line);
+            return result;
+        }
+    }
+}
+
+Instruction& IrBuilder::append(Opcode op, ValueId result, int line) {
+    std::vector<Instruction>& instructions = function_->block(current_).instructions;
+    instructions.push_back(Instruction(op, result, line));
+    return instructions.back();
+}
+
+void IrBuilder::terminate(TerminatorKind kind, ValueId condition, BlockId target, BlockId other_target, int line) {
+    Terminator& terminator = function_->block(current_).terminator;
+    terminator.kind = kind;
+    terminator.condition = condition;
+    terminator.targets[0] = target;
+    terminator.targets[1] = other_target;
+    terminator.line = line;
+}
+
+} // namespace ir
+
+} // namespace nova
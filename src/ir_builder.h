@@ -0,0 +1,51 @@
+#ifndef __NOVA_IR_BUILDER_H__
+#define __NOVA_IR_BUILDER_H__
+
+#include "ast.h"
+#include "file_table.h"
+#include "ir.h"
+#include "symbol_table.h"
+
+namespace nova {
+
+namespace ir {
+
+// Lowers a checked AST into a Function. Every variable read becomes a kLoad
+// and every assignment a kCopy tagged with the variable, read statements a
+// kRead tagged the same way. An if branches to its then part or to its else
+// part or the join, a repeat jumps to its body and branches back from the
+// test at the end of the body. The blocks are laid out in source order, so
+// the code of each statement comes out where the AST code generator put it.
+class IrBuilder {
+public:
+    explicit IrBuilder(const SymbolTable& symbol_table)
+        : symbol_table_(symbol_table),
+          function_(nullptr),
+          current_(kNoBlock) {
+    }
+    IrBuilder(const IrBuilder&) = delete;
+    IrBuilder& operator=(const IrBuilder&) = delete;
+
+    Function build(AstPtr sequence);
+
+private:
+    void buildSequence(AstPtr node);
+    void buildIfStatement(IfStatementAstPtr node);
+    void buildRepeatStatement(RepeatStatementAstPtr node);
+    ValueId buildExpression(AstPtr node);
+
+    Instruction& append(Opcode op, ValueId result, int line);
+    void terminate(TerminatorKind kind, ValueId condition, BlockId target, BlockId other_target, int line);
+
+private:
+    const SymbolTable& symbol_table_;
+    Function* function_;
+    BlockId current_;
+    LineResolver lines_;
+};
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,212 @@
+#include "licm.h"
+
+#include "dominators.h"
+#include "loops.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+size_t index(int id) {
+    return static_cast<size_t>(id);
+}
+
+class LoopInvariantMotion {
+public:
+    explicit LoopInvariantMotion(Function& function)
+        : function_(function),
+          blocks_(index(function.valueCount()), kNoBlock),
+          divisors_(index(function.valueCount()), false),
+          marked_(index(function.blockCount()), -1),
+          hoisted_(0) {
+    }
+
+    int run();
+
+private:
+    void hoist(const Loop& loop, BlockId preheader, int mark);
+    BlockId makePreheader(const Loop& loop, int mark);
+    bool invariant(const Instruction& ins, int mark) const;
+    bool definedOutside(ValueId value, int mark) const;
+    ValueId newValue();
+
+private:
+    Function& function_;
+    std::vector<BlockId> blocks_;  // by value, the block defining it
+    std::vector<bool> divisors_;   // by value, whether it is a constant other than 0 and -1
+    std::vector<int> marked_;      // by block, the last loop it is in
+    int hoisted_;
+};
+
+int LoopInvariantMotion::run() {
+    std::vector<Loop> loops;
+    {
+        DominatorTree dominators(function_);
+        loops = findLoops(function_, dominators);
+    }
+    for (BlockId id : function_.layout()) {
+        const BasicBlock& b = function_.block(id);
+        for (const Phi& phi : b.phis) {
+            blocks_[index(phi.result)] = id;
+        }
+        for (const Instruction& ins : b.instructions) {
+            if (ins.result != kNoValue) {
+                blocks_[index(ins.result)] = id;
+                divisors_[index(ins.result)] =
+                    ins.op == Opcode::kConstant && ins.constant != 0 && ins.constant != -1;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < loops.size(); ++i) {
+        const Loop& loop = loops[i];
+        if (loop.header == function_.entry()) {
+            continue;
+        }
+        int mark = static_cast<int>(i);
+        for (BlockId id : loop.blocks) {
+            marked_[index(id)] = mark;
+        }
+        int block_count = function_.blockCount();
+        BlockId preheader = makePreheader(loop, mark);
+        if (function_.blockCount() > block_count) {
+            // a new block, it belongs to the loops around this one
+            for (size_t j = i + 1; j < loops.size(); ++j) {
+                std::vector<BlockId>& blocks = loops[j].blocks;
+                auto header = std::find(blocks.begin(), blocks.end(), loop.header);
+                if (header != blocks.end()) {
+                    blocks.insert(header, preheader);
+                }
+            }
+        }
+        hoist(loop, preheader, mark);
+    }
+    return hoisted_;
+}
+
+// Moves the invariant instructions of the loop in reverse postorder, so an
+// instruction comes after those it uses.
+void LoopInvariantMotion::hoist(const Loop& loop, BlockId preheader, int mark) {
+    for (BlockId id : loop.blocks) {
+        std::vector<Instruction>& instructions = function_.block(id).instructions;
+        size_t kept = 0;
+        for (size_t i = 0; i < instructions.size(); ++i) {
+            const Instruction& ins = instructions[i];
+            if (invariant(ins, mark)) {
+                function_.block(preheader).instructions.push_back(ins);
+                blocks_[index(ins.result)] = preheader;
+                hoisted_ += isBinary(ins.op) ? 1 : 0;
+                continue;
+            }
+            instructions[kept++] = ins;
+        }
+        instructions.resize(kept, Instruction(Opcode::kConstant, kNoValue, 0));
+    }
+}
+
+// The predecessor outside the loop when it is the only one and jumps, else
+// a new block between the header and those predecessors, which takes the
+// operands of the phis of the header from them.
+BlockId LoopInvariantMotion::makePreheader(const Loop& loop, int mark) {
+    const std::vector<BlockId>& entering = function_.block(loop.header).predecessors;
+    std::vector<size_t> outside;  // the edges into the header from outside
+    for (size_t i = 0; i < entering.size(); ++i) {
+        if (marked_[index(entering[i])] != mark) {
+            outside.push_back(i);
+        }
+    }
+    if (outside.size() == 1 && function_.block(entering[outside[0]]).terminator.kind == TerminatorKind::kJump) {
+        return entering[outside[0]];
+    }
+
+    const std::vector<BlockId>& layout = function_.layout();
+    BlockId before = *(std::find(layout.begin(), layout.end(), loop.header) - 1);
+    BlockId id = function_.insertBlockAfter(before);
+    marked_.resize(index(function_.blockCount()), -1);
+    BasicBlock& preheader = function_.block(id);
+    BasicBlock& h = function_.block(loop.header);
+    preheader.terminator.kind = TerminatorKind::kJump;
+    preheader.terminator.targets[0] = loop.header;
+    preheader.terminator.line = h.terminator.line;
+    for (size_t i : outside) {
+        BlockId pred = h.predecessors[i];
+        preheader.predecessors.push_back(pred);
+        Terminator& terminator = function_.block(pred).terminator;
+        for (int k = 0; k < terminator.successorCount(); ++k) {
+            if (terminator.targets[k] == loop.header) {
+                terminator.targets[k] = id;
+            }
+        }
+    }
+
+    std::vector<BlockId> predecessors(1, id);
+    for (size_t i = 0; i < h.predecessors.size(); ++i) {
+        if (marked_[index(h.predecessors[i])] == mark) {
+            predecessors.push_back(h.predecessors[i]);
+        }
+    }
+    for (Phi& phi : h.phis) {
+        std::vector<ValueId> operands(1, phi.operands[outside[0]]);
+        bool same = true;
+        for (size_t i : outside) {
+            same = same && phi.operands[i] == operands[0];
+        }
+        if (!same) {
+            Phi merged(newValue(), phi.variable);
+            for (size_t i : outside) {
+                merged.operands.push_back(phi.operands[i]);
+            }
+            operands[0] = merged.result;
+            blocks_[index(merged.result)] = id;
+            preheader.phis.push_back(merged);
+        }
+        for (size_t i = 0; i < h.predecessors.size(); ++i) {
+            if (marked_[index(h.predecessors[i])] == mark) {
+                operands.push_back(phi.operands[i]);
+            }
+        }
+        phi.operands = operands;
+    }
+    h.predecessors = predecessors;
+    return id;
+}
+
+bool LoopInvariantMotion::invariant(const Instruction& ins, int mark) const {
+    if (ins.op == Opcode::kConstant) {
+        return ins.variable < 0;
+    }
+    if (!isBinary(ins.op) || definesVariable(ins)) {
+        return false;
+    }
+    if (ins.op == Opcode::kDiv && !divisors_[index(ins.operands[1])]) {
+        return false;
+    }
+    return definedOutside(ins.operands[0], mark) && definedOutside(ins.operands[1], mark);
+}
+
+bool LoopInvariantMotion::definedOutside(ValueId value, int mark) const {
+    BlockId id = blocks_[index(value)];
+    return id == kNoBlock || marked_[index(id)] != mark;
+}
+
+ValueId LoopInvariantMotion::newValue() {
+    ValueId value = function_.newValue();
+    blocks_.resize(index(function_.valueCount()), kNoBlock);
+    divisors_.resize(index(function_.valueCount()), false);
+    return value;
+}
+
+} // namespace
+
+int hoistLoopInvariants(Function& function) {
+    return LoopInvariantMotion(function).run();
+}
+
+} // namespace ir
+
+} // namespace nova
@@ -0,0 +1,27 @@
+#ifndef __NOVA_LICM_H__
+#define __NOVA_LICM_H__
+
+#include "ir.h"
+
+namespace nova {
+
+namespace ir {
+
+// Moves the computations of the loops of a function in SSA form whose
+// operands are defined outside the loop to its preheader, the one block
+// entering the header from outside, made when the header has several
+// predecessors outside or one that branches. The loops nested in another
+// go first, so what they hoist may leave the outer loop too.
+//
+// Only temporaries computed by an operator that cannot trap move, a
+// division only by a constant other than 0 and -1: TINY loops are repeat loops,
+// whose body runs at least once, but a block within the body may not, and
+// the operator then runs early or for nothing. The constants they use go
+// with them. Returns the number of operators hoisted.
+int hoistLoopInvariants(Function& function);
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
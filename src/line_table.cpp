@@ -0,0 +1,62 @@
+#include "line_table.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace nova {
+
+void LineTable::add(int pc, int line) {
+    if (!entries_.empty()) {
+        if (entries_.back().line == line) {
+            return;
+        }
+        if (entries_.back().pc == pc) {
+            entries_.back().line = line;
+            return;
+        }
+    }
+    entries_.push_back(Entry(pc, line));
+}
+
+int LineTable::lookup(int pc) const {
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), pc, [](int value, const Entry& entry) {
+        return value < entry.pc;
+    });
+    if (it == entries_.begin()) {
+        return 0;
+    }
+    return (it - 1)->line;
+}
+
+void LineTable::clear() {
+    file_name_.clear();
+    entries_.clear();
+}
+
+void LineTable::write(std::ostream& os) const {
+    os << "*.file " << file_name_ << '\n';
+    for (const Entry& entry : entries_) {
+        os << "*.loc " << entry.pc << " " << entry.line << '\n';
+    }
+}
+
+bool LineTable::parseDirective(const std::string& directive) {
+    std::istringstream input(directive);
+    std::string name;
+    input >> name;
+    if (name == "*.file") {
+        input >> std::ws;
+        std::getline(input, file_name_);
+        return true;
+    } else if (name == "*.loc") {
+        int pc = 0;
+        int line = 0;
+        if (input >> pc >> line) {
+            add(pc, line);
+            return true;
+        }
+    }
+    return false;
+}
+    
+} // namespace nova
@@ -0,0 +1,50 @@
+#ifndef __NOVA_LINE_TABLE_H__
+#define __NOVA_LINE_TABLE_H__
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace nova {
+
+// Maps TM pc to TINY source line. Only the pcs where the source line changes
+// are stored, a pc maps to the line of the closest entry at or before it.
+// Line 0 means the instruction does not belong to any source line.
+class LineTable {
+public:
+    struct Entry {
+        Entry(int entry_pc, int entry_line)
+            : pc(entry_pc),
+              line(entry_line) {
+        }
+
+        int pc;
+        int line;
+    };
+
+    LineTable() = default;
+
+    void setFileName(const std::string& file_name) { file_name_ = file_name; }
+    const std::string& fileName() const { return file_name_; }
+
+    // entries must be added in increasing pc order
+    void add(int pc, int line);
+    int lookup(int pc) const;
+    bool empty() const { return entries_.empty(); }
+    const std::vector<Entry>& entries() const { return entries_; }
+    void clear();
+
+    // Text form embedded in TM listings as comment directives:
+    //   *.file <name>
+    //   *.loc <pc> <line>
+    void write(std::ostream& os) const;
+    bool parseDirective(const std::string& directive);
+
+private:
+    std::string file_name_;
+    std::vector<Entry> entries_;
+};
+    
+} // namespace nova
+
+#endif
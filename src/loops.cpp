@@ -0,0 +1,84 @@
+#include "loops.h"
+
+#include <algorithm>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+size_t index(int id) {
+    return static_cast<size_t>(id);
+}
+
+} // namespace
+
+std::vector<Loop> findLoops(const Function& function, const DominatorTree& dominators) {
+    const std::vector<BlockId>& order = dominators.reversePostorder();
+    std::vector<int> rpo_number(index(function.blockCount()), -1);
+    for (size_t i = 0; i < order.size(); ++i) {
+        rpo_number[index(order[i])] = static_cast<int>(i);
+    }
+
+    std::vector<Loop> loops;
+    std::vector<int> loop_of(index(function.blockCount()), -1);  // by header
+    for (BlockId id : order) {
+        const Terminator& terminator = function.block(id).terminator;
+        for (int i = 0; i < terminator.successorCount(); ++i) {
+            BlockId header = terminator.targets[i];
+            if (!dominators.dominates(header, id)) {
+                continue;
+            }
+            if (loop_of[index(header)] < 0) {
+                loop_of[index(header)] = static_cast<int>(loops.size());
+                loops.push_back(Loop{header, std::vector<BlockId>(), std::vector<BlockId>()});
+            }
+            std::vector<BlockId>& latches = loops[index(loop_of[index(header)])].latches;
+            if (std::find(latches.begin(), latches.end(), id) == latches.end()) {
+                latches.push_back(id);
+            }
+        }
+    }
+
+    // the blocks reaching a latch backwards without passing the header
+    std::vector<int> marked(index(function.blockCount()), -1);  // by block, the last loop it is in
+    for (size_t i = 0; i < loops.size(); ++i) {
+        Loop& loop = loops[i];
+        int mark = static_cast<int>(i);
+        marked[index(loop.header)] = mark;
+        loop.blocks.push_back(loop.header);
+        std::vector<BlockId> worklist;
+        for (BlockId latch : loop.latches) {
+            if (marked[index(latch)] != mark) {
+                marked[index(latch)] = mark;
+                loop.blocks.push_back(latch);
+                worklist.push_back(latch);
+            }
+        }
+        while (!worklist.empty()) {
+            BlockId id = worklist.back();
+            worklist.pop_back();
+            for (BlockId pred : function.block(id).predecessors) {
+                if (dominators.reachable(pred) && marked[index(pred)] != mark) {
+                    marked[index(pred)] = mark;
+                    loop.blocks.push_back(pred);
+                    worklist.push_back(pred);
+                }
+            }
+        }
+        std::sort(loop.blocks.begin(), loop.blocks.end(), [&rpo_number](BlockId a, BlockId b) {
+            return rpo_number[index(a)] < rpo_number[index(b)];
+        });
+    }
+
+    // a loop nested in another has fewer blocks
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) {
+        return a.blocks.size() < b.blocks.size();
+    });
+    return loops;
+}
+
+} // namespace ir
+
+} // namespace nova
@@ -0,0 +1,31 @@
+#ifndef __NOVA_LOOPS_H__
+#define __NOVA_LOOPS_H__
+
+#include <vector>
+
+#include "dominators.h"
+#include "ir.h"
+
+namespace nova {
+
+namespace ir {
+
+// A natural loop: the target of a back edge, an edge to a block that
+// dominates its source, and the blocks that reach the source without
+// passing through the header. The loops of all the back edges to one header
+// are one loop.
+struct Loop {
+    BlockId header;
+    std::vector<BlockId> blocks;   // in reverse postorder, the header first
+    std::vector<BlockId> latches;  // the sources of the back edges
+};
+
+// The natural loops of the reachable blocks of a function, each after the
+// loops nested in it. The function must have its predecessors.
+std::vector<Loop> findLoops(const Function& function, const DominatorTree& dominators);
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
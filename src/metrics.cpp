@@ -0,0 +1,122 @@
+#include "metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+
+namespace nova {
+
+namespace vm {
+
+namespace {
+
+TokenValue opcodeAt(int index) {
+    return static_cast<TokenValue>(index + static_cast<int>(TokenValue::kHalt));
+}
+
+void writePrometheus(std::ostream& os, const Metrics& metrics) {
+    os << "# HELP nova_vm_instructions_retired_total Instructions executed to completion.\n"
+       << "# TYPE nova_vm_instructions_retired_total counter\n"
+       << "nova_vm_instructions_retired_total " << metrics.instructions_retired << "\n"
+       << "# HELP nova_vm_opcode_executions_total Instructions executed per opcode.\n"
+       << "# TYPE nova_vm_opcode_executions_total counter\n";
+    for (int i = 0; i < kOpcodeCount; ++i) {
+        os << "nova_vm_opcode_executions_total{opcode=\"" << opcodeName(opcodeAt(i)) << "\"} " 
+           << metrics.opcode_counts[i] << "\n";
+    }
+    os << "# HELP nova_vm_memory_high_water_words Highest stored address + 1.\n"
+       << "# TYPE nova_vm_memory_high_water_words gauge\n"
+       << "nova_vm_memory_high_water_words{region=\"global\"} " << metrics.global_memory_high_water << "\n"
+       << "nova_vm_memory_high_water_words{region=\"tmp\"} " << metrics.tmp_memory_high_water << "\n"
+       << "# HELP nova_vm_io_operations_total IN and OUT instructions.\n"
+       << "# TYPE nova_vm_io_operations_total counter\n"
+       << "nova_vm_io_operations_total{op=\"in\"} " << metrics.in_count << "\n"
+       << "nova_vm_io_operations_total{op=\"out\"} " << metrics.out_count << "\n"
+       << "# HELP nova_vm_io_bytes_total Bytes of the values read and written.\n"
+       << "# TYPE nova_vm_io_bytes_total counter\n"
+       << "nova_vm_io_bytes_total{op=\"in\"} " << metrics.in_bytes << "\n"
+       << "nova_vm_io_bytes_total{op=\"out\"} " << metrics.out_bytes << "\n"
+       << "# HELP nova_vm_traps_total Runtime traps.\n"
+       << "# TYPE nova_vm_traps_total counter\n"
+       << "nova_vm_traps_total " << metrics.traps << "\n"
+       << "# HELP nova_vm_wall_seconds Wall time spent running.\n"
+       << "# TYPE nova_vm_wall_seconds gauge\n"
+       << "nova_vm_wall_seconds " << metrics.wall_seconds << "\n"
+       << "# HELP nova_vm_cpu_seconds Process cpu time spent running.\n"
+       << "# TYPE nova_vm_cpu_seconds gauge\n"
+       << "nova_vm_cpu_seconds " << metrics.cpu_seconds << "\n";
+}
+
+void writeJson(std::ostream& os, const Metrics& metrics) {
+    os << "{\n"
+       << "  \"instructions_retired\": " << metrics.instructions_retired << ",\n"
+       << "  \"opcodes\": {";
+    for (int i = 0; i < kOpcodeCount; ++i) {
+        os << (i == 0 ? "\n" : ",\n") << "    \"" << opcodeName(opcodeAt(i)) << "\": " << metrics.opcode_counts[i];
+    }
+    os << "\n  },\n"
+       << "  \"global_memory_high_water\": " << metrics.global_memory_high_water << ",\n"
+       << "  \"tmp_memory_high_water\": " << metrics.tmp_memory_high_water << ",\n"
+       << "  \"in_count\": " << metrics.in_count << ",\n"
+       << "  \"in_bytes\": " << metrics.in_bytes << ",\n"
+       << "  \"out_count\": " << metrics.out_count << ",\n"
+       << "  \"out_bytes\": " << metrics.out_bytes << ",\n"
+       << "  \"traps\": " << metrics.traps << ",\n"
+       << "  \"wall_seconds\": " << metrics.wall_seconds << ",\n"
+       << "  \"cpu_seconds\": " << metrics.cpu_seconds << "\n"
+       << "}\n";
+}
+
+} // namespace
+
+void Metrics::clear() {
+    instructions_retired = 0;
+    memset(opcode_counts, 0, sizeof(opcode_counts));
+    global_memory_high_water = 0;
+    tmp_memory_high_water = 0;
+    in_count = 0;
+    in_bytes = 0;
+    out_count = 0;
+    out_bytes = 0;
+    traps = 0;
+    wall_seconds = 0;
+    cpu_seconds = 0;
+}
+
+MetricsFormat metricsFormatFor(const std::string& file_name) {
+    const std::string suffix = ".json";
+    if (file_name.size() >= suffix.size() &&
+        file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        return MetricsFormat::kJson;
+    }
+    return MetricsFormat::kPrometheus;
+}
+
+void writeMetrics(std::ostream& os, const Metrics& metrics, MetricsFormat format) {
+    if (format == MetricsFormat::kJson) {
+        writeJson(os, metrics);
+    } else {
+        writePrometheus(os, metrics);
+    }
+}
+
+bool writeMetrics(const std::string& file_name, const Metrics& metrics) {
+    // write aside and rename, so that a scraper never sees a partial file
+    std::string tmp_name = file_name + ".tmp";
+    {
+        std::ofstream out(tmp_name);
+        if (!out.is_open()) {
+            return false;
+        }
+        writeMetrics(out, metrics, metricsFormatFor(file_name));
+        if (!out) {
+            return false;
+        }
+    }
+    return rename(tmp_name.c_str(), file_name.c_str()) == 0;
+}
+
+} // namespace vm
+
+} // namespace nova
@@ -0,0 +1,58 @@
+#ifndef __NOVA_METRICS_H__
+#define __NOVA_METRICS_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <ostream>
+
+#include "vm.h"
+
+namespace nova {
+
+namespace vm {
+
+// number of opcodes, HALT .. JNE
+const int kOpcodeCount = static_cast<int>(TokenValue::kJne) - static_cast<int>(TokenValue::kHalt) + 1;
+
+inline int opcodeIndex(TokenValue value) {
+    return static_cast<int>(value) - static_cast<int>(TokenValue::kHalt);
+}
+
+// Aggregate counters of a VM run. Fields are only ever added at the end, so
+// consumers of the text and json dumps can rely on the existing names.
+struct Metrics {
+    Metrics() {
+        clear();
+    }
+
+    void clear();
+
+    uint64_t instructions_retired;
+    uint64_t opcode_counts[kOpcodeCount];
+    uint64_t global_memory_high_water;  // highest stored address + 1, in words
+    uint64_t tmp_memory_high_water;
+    uint64_t in_count;
+    uint64_t in_bytes;                  // decimal digits of the values read
+    uint64_t out_count;
+    uint64_t out_bytes;                 // bytes written, including newlines
+    uint64_t traps;
+    double wall_seconds;
+    double cpu_seconds;
+};
+
+enum class MetricsFormat {
+    kPrometheus,
+    kJson,
+};
+
+// .json selects json, anything else the prometheus text format
+MetricsFormat metricsFormatFor(const std::string& file_name);
+void writeMetrics(std::ostream& os, const Metrics& metrics, MetricsFormat format);
+bool writeMetrics(const std::string& file_name, const Metrics& metrics);
+
+} // namespace vm
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,207 @@
+#include "parallel_parser.h"
+
+#include "parser.h"
+#include "ast_visitor.h"
+#include "error.h"
+#include "char_class.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace nova {
+
+const size_t ParallelParser::kMinChunkSize;
+
+namespace {
+
+// chunks per thread, so that a slow chunk does not hold up the others
+const size_t kChunksPerJob = 4;
+
+// +1 for the words opening a statement sequence closed by end or until, -1
+// for those closing one
+int nestingChange(const char* word, size_t length) {
+    switch (length) {
+        case 2: return memcmp(word, "if", 2) == 0 ? 1 : 0;
+        case 3: return memcmp(word, "end", 3) == 0 ? -1 : 0;
+        case 5: return memcmp(word, "until", 5) == 0 ? -1 : 0;
+        case 6: return memcmp(word, "repeat", 6) == 0 ? 1 : 0;
+        default: return 0;
+    }
+}
+
+// Cuts text at the first top-level semicolon at least chunk_size bytes past
+// the previous cut, the semicolons themselves belong to no chunk. Only
+// comments and if/repeat nesting are tracked: on malformed input a cut the
+// parser would not make just causes a chunk to fail. After an end or until
+// that closes nothing, where the serial parser stops, the rest of the text
+// stays in one chunk.
+std::vector<StringPiece> splitInput(StringPiece text, size_t chunk_size) {
+    std::vector<StringPiece> pieces;
+    const char* p = text.begin();
+    const char* end = text.end();
+    const char* chunk_start = p;
+    int depth = 0;
+
+    while (p < end && depth >= 0) {
+        switch (charClass(*p)) {
+            case kCharSpace:
+                p = skipSpaces(p, end);
+                break;
+
+            case kCharDigit:
+                p = skipDigits(p, end);
+                break;
+
+            case kCharLetter: {
+                const char* word = p;
+                p = skipLetters(p, end);
+                depth += nestingChange(word, static_cast<size_t>(p - word));
+                break;
+            }
+
+            case kCharLeftBrace:
+                p = skipCommentBody(p + 1, end);
+                if (p < end) {
+                    ++p;  // eat '}'
+                }
+                break;
+
+            default:
+                if (*p == ';' && depth == 0 && static_cast<size_t>(p - chunk_start) >= chunk_size) {
+                    pieces.push_back(StringPiece(chunk_start, static_cast<size_t>(p - chunk_start)));
+                    chunk_start = p + 1;
+                }
+                ++p;
+                break;
+        }
+    }
+    pieces.push_back(StringPiece(chunk_start, static_cast<size_t>(end - chunk_start)));
+    return pieces;
+}
+
+// calls work(i) for every i < count on up to jobs threads, the calling
+// thread included
+template<typename Work>
+void runParallel(size_t count, size_t jobs, Work work) {
+    std::atomic<size_t> next(0);
+    auto run = [count, &next, &work]() {
+        for (size_t i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(jobs, count); ++i) {
+        threads.push_back(std::thread(run));
+    }
+    run();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// moves the variables of a chunk from its own slots to the merged ones
+class SlotRemapper : public AstVisitor<SlotRemapper> {
+public:
+    explicit SlotRemapper(const std::vector<int>& slot_map)
+        : slot_map_(slot_map) {
+    }
+
+    void visitVariable(VariableAstPtr node) {
+        node->setSlot(slot_map_[static_cast<size_t>(node->slot())]);
+    }
+
+private:
+    const std::vector<int>& slot_map_;
+};
+
+bool isIdentity(const std::vector<int>& slot_map) {
+    for (size_t i = 0; i < slot_map.size(); ++i) {
+        if (slot_map[i] != static_cast<int>(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ParallelParser::ParallelParser(Scanner& scanner, int jobs)
+    : scanner_(scanner),
+      jobs_(jobs),
+      min_chunk_size_(kMinChunkSize) {
+    if (jobs_ <= 0) {
+        jobs_ = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    }
+}
+
+void ParallelParser::setRecordLocations(bool record) {
+    context_.symbolTable().setRecordLocations(record);
+}
+
+AstPtr ParallelParser::parse() {
+    if (jobs_ > 1) {
+        StringPiece input = scanner_.remainingInput();
+        size_t chunk_size = std::max(min_chunk_size_, input.size() / (static_cast<size_t>(jobs_) * kChunksPerJob));
+        std::vector<StringPiece> pieces = splitInput(input, chunk_size);
+        if (pieces.size() > 1 && parseChunks(pieces)) {
+            linkChunks();
+            return chunks_.front()->head;
+        }
+        chunks_.clear();
+    }
+    Parser parser(scanner_, context_);
+    return parser.parse();
+}
+
+bool ParallelParser::parseChunks(const std::vector<StringPiece>& pieces) {
+    for (StringPiece piece : pieces) {
+        chunks_.push_back(std::unique_ptr<Chunk>(new Chunk(piece)));
+        chunks_.back()->context.symbolTable().setRecordLocations(context_.symbolTable().recordLocations());
+    }
+    runParallel(chunks_.size(), static_cast<size_t>(jobs_), [this](size_t i) { parseChunk(*chunks_[i]); });
+
+    for (std::unique_ptr<Chunk>& chunk : chunks_) {
+        if (!chunk->complete) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ParallelParser::parseChunk(Chunk& chunk) {
+    ErrorCapture capture;
+    Scanner scanner(scanner_, chunk.text);
+    Parser parser(scanner, chunk.context);
+    chunk.head = parser.parse();
+    chunk.complete = capture.errorCount() == 0 &&
+                     scanner.getToken().getTokenType() == TokenType::kEndOfFile;
+    if (!chunk.complete) {
+        return;
+    }
+    chunk.tail = chunk.head;
+    while (chunk.tail->next() != nullptr) {
+        chunk.tail = chunk.tail->next();
+    }
+}
+
+// The chunk tables are merged in order, the variables of the chunks whose
+// slots moved are rewritten on the pool, then the sequences are linked.
+void ParallelParser::linkChunks() {
+    for (std::unique_ptr<Chunk>& chunk : chunks_) {
+        chunk->slot_map = context_.symbolTable().merge(std::move(chunk->context.symbolTable()));
+    }
+    runParallel(chunks_.size(), static_cast<size_t>(jobs_), [this](size_t i) {
+        Chunk& chunk = *chunks_[i];
+        if (!isIdentity(chunk.slot_map)) {
+            SlotRemapper(chunk.slot_map).traverse(chunk.head);
+        }
+    });
+    for (size_t i = 0; i + 1 < chunks_.size(); ++i) {
+        chunks_[i]->tail->setNext(chunks_[i + 1]->head);
+    }
+}
+
+} // namespace nova
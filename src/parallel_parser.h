@@ -0,0 +1,75 @@
+#ifndef __NOVA_PARALLEL_PARSER_H__
+#define __NOVA_PARALLEL_PARSER_H__
+
+#include <memory>
+#include <vector>
+
+#include "scanner.h"
+#include "ast.h"
+
+namespace nova {
+
+// Parses a whole program on several threads. A pre-scan cuts the input at
+// top-level semicolons into chunks of similar size, and a pool of threads
+// lexes and parses each chunk into its own AstContext, interning its
+// variables in the chunk's table. The tables are then merged in chunk order,
+// so every variable gets the slot the serial parser gives it, and the
+// statement sequences are linked together in the same order.
+//
+// The tree is the one Parser builds. Inputs too small to split and inputs
+// where a chunk has an error or stops short of its end are parsed again
+// serially, so diagnostics are always those of the serial parser.
+class ParallelParser {
+public:
+    static const size_t kMinChunkSize = 1 << 20;
+
+    // jobs is the number of threads, 0 for one per core
+    ParallelParser(Scanner& scanner, int jobs);
+    ParallelParser(const ParallelParser&) = delete;
+    ParallelParser& operator=(const ParallelParser&) = delete;
+
+    void setMinChunkSize(size_t size) { min_chunk_size_ = size; }
+    // cross-reference mode of the symbol table, before parse()
+    void setRecordLocations(bool record);
+
+    // the AST lives as long as the parser
+    AstPtr parse();
+    // the symbols of the parsed program, for Analysis::useSymbolTable
+    SymbolTable& symbolTable() { return context_.symbolTable(); }
+    // where later passes make their nodes, it lives as long as the AST
+    AstContext& context() { return context_; }
+    // chunks parsed in parallel, 0 if the input was parsed serially
+    size_t chunkCount() const { return chunks_.size(); }
+
+private:
+    struct Chunk {
+        explicit Chunk(StringPiece chunk_text)
+            : text(chunk_text),
+              head(nullptr),
+              tail(nullptr),
+              complete(false) {
+        }
+
+        StringPiece text;
+        AstContext context;
+        std::vector<int> slot_map;  // chunk slot -> merged slot
+        AstPtr head;
+        AstPtr tail;
+        bool complete;  // parsed to its end without errors
+    };
+
+    bool parseChunks(const std::vector<StringPiece>& pieces);
+    void parseChunk(Chunk& chunk);
+    void linkChunks();
+
+private:
+    Scanner& scanner_;
+    int jobs_;
+    size_t min_chunk_size_;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    AstContext context_;
+};
+
+} // namespace nova
+
+#endif
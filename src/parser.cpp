@@ -6,8 +6,30 @@ namespace nova {
 
 bool Parser::error_flag_ = false;
 
+namespace {
+
+const int kComparisonPrecedence = 2;
+
+} // namespace
+
 Parser::Parser(Scanner& scanner)
-    : scanner_(scanner) {
+    : scanner_(scanner),
+      own_context_(new AstContext()),
+      context_(*own_context_),
+      ast_(nullptr),
+      statements_parsed_(0),
+      stream_ended_(false) {
+    scanner_.setSymbolTable(&context_.symbolTable());
+    scanner_.getNextToken();  // get first token
+}
+
+Parser::Parser(Scanner& scanner, AstContext& context)
+    : scanner_(scanner),
+      context_(context),
+      ast_(nullptr),
+      statements_parsed_(0),
+      stream_ended_(false) {
+    scanner_.setSymbolTable(&context_.symbolTable());
     scanner_.getNextToken();  // get first token
 }
 
@@ -20,6 +42,28 @@ AstPtr Parser::parse() {
     return ast_;
 }
 
+AstPtr Parser::parseNextStatement() {
+    if (stream_ended_) {
+        return nullptr;
+    }
+    if (statements_parsed_ == 0) {
+        if (scanner_.getToken().getTokenType() == TokenType::kEndOfFile) {
+            errorReport("Unexpected end of file.");
+            stream_ended_ = true;
+            return nullptr;
+        }
+    } else if (isEndOfStatementSequence()) {
+        stream_ended_ = true;
+        return nullptr;
+    } else {
+        expectToken(TokenValue::kSemicolon, ";", true);
+    }
+    ++statements_parsed_;
+    AstPtr statement = parseStatement();
+    stream_ended_ = statement == nullptr;
+    return statement;
+}
+
 AstPtr Parser::parseStatementSequence() {
     AstPtr head = parseStatement();
     AstPtr current_ptr = head;
@@ -71,7 +115,7 @@ AstPtr Parser::parseStatement() {
             if (scanner_.getToken().getTokenType() == TokenType::kIdentifier) {
                 return parseAssignStatement();   
             } else {
-                errorReport("error: unknown token '" + scanner_.getToken().getTokenName() + "'");
+                errorReport("error: unknown token '" + scanner_.getToken().getTokenName().as_string() + "'");
                 return nullptr;
             }
         }
@@ -79,7 +123,7 @@ AstPtr Parser::parseStatement() {
 }
 
 AstPtr Parser::parseIfStatement() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
+    TokenLocation loc = scanner_.getTokenLocation();
     if (!validateToken(TokenValue::kIf, true)) {
         return nullptr;   
     }
@@ -104,15 +148,15 @@ AstPtr Parser::parseIfStatement() {
         }
 
         default:
-            errorReport("error: invalid token '" + scanner_.getToken().getTokenName() + "'");
+            errorReport("error: invalid token '" + scanner_.getToken().getTokenName().as_string() + "'");
             return nullptr;
     }
     scanner_.getNextToken();  // eat "end"
-    return std::make_shared<IfStatementAst>(loc, AstType::kIf, test_part, then_part, else_part);
+    return context_.make<IfStatementAst>(loc, AstType::kIf, test_part, then_part, else_part);
 }
 
 AstPtr Parser::parseRepeatStatement() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
+    TokenLocation loc = scanner_.getTokenLocation();
     if (!validateToken(TokenValue::kRepeat, true)) {
         return nullptr;   
     }
@@ -121,129 +165,124 @@ AstPtr Parser::parseRepeatStatement() {
         return nullptr;   
     }
     AstPtr test_part = parseExpression();
-    return std::make_shared<RepeatStatementAst>(loc, AstType::kRepeat, body_part, test_part);
+    return context_.make<RepeatStatementAst>(loc, AstType::kRepeat, body_part, test_part);
 }
 
 AstPtr Parser::parseAssignStatement() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
+    TokenLocation loc = scanner_.getTokenLocation();
     if (!validateToken(TokenType::kIdentifier, false)) {
         return nullptr;   
     }
-    VariableAstPtr var = std::make_shared<VariableAst>(loc, AstType::kVariable, scanner_.getToken().getTokenName());
+    VariableAstPtr var = context_.make<VariableAst>(loc, AstType::kVariable, scanner_.getToken().getTokenName(), 
+                                                    scanner_.getTokenSymbol());
     scanner_.getNextToken();  // eat variable
     if (!expectToken(TokenValue::kAssign, ":=", true)) {
         return nullptr;   
     }
     AstPtr expr = parseExpression();
-    return std::make_shared<AssignStatementAst>(loc, AstType::kAssign, var, expr);
+    return context_.make<AssignStatementAst>(loc, AstType::kAssign, var, expr);
 }
 
 AstPtr Parser::parseReadStatement() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
+    TokenLocation loc = scanner_.getTokenLocation();
     if (!validateToken(TokenValue::kRead, true)) {
         return nullptr;   
     }
     if (!expectToken(TokenType::kIdentifier, "identifier", false)) {
         return nullptr;   
     }
-    VariableAstPtr var = std::make_shared<VariableAst>(scanner_.getToken().getTokenLocation(), 
+    VariableAstPtr var = context_.make<VariableAst>(scanner_.getTokenLocation(), 
                                                        AstType::kVariable, 
-                                                       scanner_.getToken().getTokenName());
+                                                       scanner_.getToken().getTokenName(),
+                                                       scanner_.getTokenSymbol());
     scanner_.getNextToken(); // eat variable
-    return std::make_shared<ReadStatementAst>(loc, AstType::kRead, var);
+    return context_.make<ReadStatementAst>(loc, AstType::kRead, var);
 }
 
 AstPtr Parser::parseWriteStatement() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
+    TokenLocation loc = scanner_.getTokenLocation();
     if (!validateToken(TokenValue::kWrite, true)) {
         return nullptr;   
     }
     AstPtr expr = parseExpression();
-    return std::make_shared<WriteStatementAst>(loc, AstType::kWrite, expr);
+    return context_.make<WriteStatementAst>(loc, AstType::kWrite, expr);
 }
 
+// Precedence climbing over explicit stacks instead of one recursive
+// function per grammar level. Binary operators are the tokens with a
+// positive precedence (10 for * /, 5 for + -, 2 for < =) and associate to
+// the left, except that a comparison may appear only once per parenthesis
+// level. A node is located at the first token of its left operand, which
+// for a parenthesized operand is the '('.
 AstPtr Parser::parseExpression() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
-    AstPtr left_part = parseSimpleExpression();
-
-    std::string op_name = scanner_.getToken().getTokenName();
-    TokenValue op_value = scanner_.getToken().getTokenValue();
-    if (op_value != TokenValue::kLess && op_value != TokenValue::kEqual) {  
-        // < or = 
-        return left_part;
-    }
-
-    scanner_.getNextToken();  // eat operator
-    AstPtr right_part = parseSimpleExpression();
-    return std::make_shared<ExpressionAst>(loc, AstType::kExpression, op_name, op_value, left_part, right_part);
-}
-
-AstPtr Parser::parseSimpleExpression() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
-    AstPtr left_part = parseTerm();
-
-    std::string op_name = scanner_.getToken().getTokenName();
-    TokenValue op_value = scanner_.getToken().getTokenValue();
-    while (op_value == TokenValue::kPlus || op_value == TokenValue::kMinus) { 
-        // + or - 
-        scanner_.getNextToken();  // eat operator
-        AstPtr node = parseTerm();
-        left_part = std::make_shared<ExpressionAst>(loc, AstType::kExpression, op_name, op_value, left_part, node);
-        op_name = scanner_.getToken().getTokenName();
-        op_value = scanner_.getToken().getTokenValue();
-    }
-    
-    return left_part;
-}
-
-AstPtr Parser::parseTerm() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
-    AstPtr left_part = parseFactor();
-
-    std::string op_name = scanner_.getToken().getTokenName();
-    TokenValue op_value = scanner_.getToken().getTokenValue();
-    while (op_value == TokenValue::kMultiply || op_value == TokenValue::kDivide) {  
-        // * or / 
-        scanner_.getNextToken();  // eat operator
-        AstPtr node = parseFactor();
-        left_part = std::make_shared<ExpressionAst>(loc, AstType::kExpression, op_name, op_value, left_part, node);
-        op_name = scanner_.getToken().getTokenName();
-        op_value = scanner_.getToken().getTokenValue();
-    }
-    
-    return left_part;
-}
-
-AstPtr Parser::parseFactor() {
-    TokenLocation loc = scanner_.getToken().getTokenLocation();
-    AstPtr result = nullptr;
-
-    switch (scanner_.getToken().getTokenType()) {
-        case TokenType::kIdentifier: {
-            result = std::make_shared<VariableAst>(loc, AstType::kVariable, scanner_.getToken().getTokenName());
-            scanner_.getNextToken();  // eat variable
-            break;
-        }
-            
-        case TokenType::kNumber: {
-            result = std::make_shared<ConstantAst>(loc, AstType::kConstant, scanner_.getToken().getIntValue());
-            scanner_.getNextToken();  // eat constant number
-            break;
+    frames_.push_back(Frame(false, TokenLocation(), operators_.size()));
+
+    for (;;) {
+        // operand
+        const Token& token = scanner_.getToken();
+        TokenLocation loc = token.getTokenLocation();
+        switch (token.getTokenType()) {
+            case TokenType::kIdentifier:
+                operands_.push_back(Operand(context_.make<VariableAst>(loc, AstType::kVariable, token.getTokenName(), 
+                                                                       scanner_.getTokenSymbol()), loc));
+                scanner_.getNextToken();  // eat variable
+                break;
+
+            case TokenType::kNumber:
+                operands_.push_back(Operand(context_.make<ConstantAst>(loc, AstType::kConstant, token.getIntValue()), loc));
+                scanner_.getNextToken();  // eat constant number
+                break;
+
+            default:
+                if (expectToken(TokenValue::kLeftParenthesis, "(", true)) {
+                    frames_.push_back(Frame(true, loc, operators_.size()));
+                    continue;
+                }
+                operands_.push_back(Operand(nullptr, loc));
+                break;
         }
 
-        default: {
-            if (!expectToken(TokenValue::kLeftParenthesis, "(", true)) {
-                return nullptr;   
+        // operator, or the end of as many parenthesis levels as it closes
+        for (;;) {
+            Frame& frame = frames_.back();
+            const Token& op = scanner_.getToken();
+            int precedence = op.getSymbolPrecedence();
+            bool comparison = precedence == kComparisonPrecedence;
+            if (precedence > 0 && !(comparison && frame.has_comparison)) {
+                frame.has_comparison = frame.has_comparison || comparison;
+                while (operators_.size() > frame.operator_base && operators_.back().precedence >= precedence) {
+                    reduceExpression();
+                }
+                operators_.push_back(Operator(op.getTokenValue(), precedence, op.getTokenName()));
+                scanner_.getNextToken();  // eat operator
+                break;
+            }
+
+            while (operators_.size() > frame.operator_base) {
+                reduceExpression();
+            }
+            if (!frame.parenthesized) {
+                frames_.pop_back();
+                AstPtr result = operands_.back().node;
+                operands_.pop_back();
+                return result;
             }
-            result = parseExpression();
+            operands_.back().start = frame.open_location;
+            frames_.pop_back();
             if (!expectToken(TokenValue::kRightParenthesis, ")", true)) {
-                return nullptr;   
+                operands_.back().node = nullptr;
             }
-            break;
         }
     }
+}
 
-    return result;
+void Parser::reduceExpression() {
+    Operator op = operators_.back();
+    operators_.pop_back();
+    Operand right = operands_.back();
+    operands_.pop_back();
+    Operand& left = operands_.back();
+    left.node = context_.make<ExpressionAst>(left.start, AstType::kExpression, op.name, op.value, left.node, right.node);
 }
 
 bool Parser::validateToken(TokenType type, bool advance_next_token) {
@@ -290,7 +329,7 @@ bool Parser::expectToken(TokenValue value, const std::string& token_name, bool a
 }
 
 void Parser::errorReport(const std::string& message) {
-    errorSyntax(scanner_.getToken().getTokenLocation().toString() + message);
+    errorSyntax(scanner_.getTokenLocation().toString() + message);
 }
 
 } // namespace nova
@@ -1,6 +1,9 @@
 #ifndef __NOVA_PARSER_H__
 #define __NOVA_PARSER_H__
 
+#include <memory>
+#include <vector>
+
 #include "scanner.h"
 #include "ast.h"
 
@@ -8,11 +11,21 @@ namespace nova {
 
 class Parser {
 public:
+    // the AST lives as long as the parser
     explicit Parser(Scanner& scanner);
+    // the AST is allocated in context and lives as long as it
+    Parser(Scanner& scanner, AstContext& context);
     Parser(const Parser&) = delete;
     Parser& operator=(const Parser&) = delete;
 
     AstPtr parse();
+    // Streaming alternative to parse(): returns the top-level statements one
+    // by one, unlinked, and nullptr at the end of the program or after an
+    // error. Nodes stay valid until the context is cleared.
+    AstPtr parseNextStatement();
+
+    // the variables of the program, interned by the scanner as they are read
+    SymbolTable& symbolTable() { return context_.symbolTable(); }
 
     static void setErrorFlag(bool flag) { error_flag_ = flag; }
     static bool getErrorFlag() { return error_flag_; }
@@ -33,13 +46,57 @@ private:
     AstPtr parseReadStatement();
     AstPtr parseWriteStatement();
     AstPtr parseExpression();
-    AstPtr parseSimpleExpression();
-    AstPtr parseTerm();
-    AstPtr parseFactor();
+    void reduceExpression();
 
 private:
     Scanner& scanner_;
+    std::unique_ptr<AstContext> own_context_;
+    AstContext& context_;
     AstPtr ast_;
+    int statements_parsed_;
+    bool stream_ended_;
+
+    // expression parser stacks, kept to reuse their storage
+    struct Operand {
+        Operand(AstPtr operand, const TokenLocation& location)
+            : node(operand),
+              start(location) {
+        }
+
+        AstPtr node;
+        TokenLocation start;  // first token of the operand
+    };
+
+    struct Operator {
+        Operator(TokenValue op_value, int op_precedence, StringPiece op_name)
+            : value(op_value),
+              precedence(op_precedence),
+              name(op_name) {
+        }
+
+        TokenValue value;
+        int precedence;
+        StringPiece name;
+    };
+
+    // one per open parenthesis, plus the outermost level
+    struct Frame {
+        Frame(bool is_parenthesized, const TokenLocation& location, size_t base)
+            : parenthesized(is_parenthesized),
+              has_comparison(false),
+              open_location(location),
+              operator_base(base) {
+        }
+
+        bool parenthesized;
+        bool has_comparison;
+        TokenLocation open_location;
+        size_t operator_base;
+    };
+
+    std::vector<Operand> operands_;
+    std::vector<Operator> operators_;
+    std::vector<Frame> frames_;
 
     static bool error_flag_;
 };
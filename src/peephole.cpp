@@ -0,0 +1,288 @@
+#include "peephole.h"
+
+#include <utility>
+
+namespace nova {
+
+namespace {
+
+bool writes(const TmInstruction& ins, Register reg) {
+    if (ins.isComment() || ins.op == "ST" || ins.op == "OUT" || ins.op == "HALT" || ins.op[0] == 'J') {
+        return false;
+    }
+    return ins.r == reg;
+}
+
+bool reads(const TmInstruction& ins, Register reg) {
+    if (ins.isComment() || ins.op == "HALT" || ins.op == "IN" || ins.op == "LDC") {
+        return false;
+    }
+    if (ins.register_only) {
+        return ins.s == reg || ins.t == reg || (ins.op == "OUT" && ins.r == reg);
+    }
+    return ins.s == reg || ((ins.op == "ST" || ins.op[0] == 'J') && ins.r == reg);
+}
+
+// control may not go on to the next instruction
+bool transfers(const TmInstruction& ins) {
+    return ins.op == "HALT" || ins.isJump() || writes(ins, Register::pc);
+}
+
+bool isMemory(const TmInstruction& ins, const char* op, Register base) {
+    return ins.op == op && !ins.register_only && ins.s == base;
+}
+
+// LDA r,0(s)
+void makeMove(TmInstruction& ins, Register r, Register s) {
+    ins.op = "LDA";
+    ins.register_only = false;
+    ins.r = r;
+    ins.s = s;
+    ins.d = 0;
+    ins.target = -1;
+}
+
+} // namespace
+
+PeepholeOptimizer::PeepholeOptimizer(const PeepholeOptions& options)
+    : options_(options),
+      hits_(static_cast<size_t>(kPeepholeRuleCount), 0) {
+}
+
+void PeepholeOptimizer::optimize(TmCode& code) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        removed_.assign(code.size(), false);
+        targeted_.assign(code.size() + 1, false);
+        for (const TmInstruction& ins : code) {
+            if (ins.isJump()) {
+                targeted_[nextInstruction(code, static_cast<size_t>(ins.target))] = true;
+            }
+        }
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (!removed_[i] && !code[i].isComment() && apply(code, i)) {
+                changed = true;
+            }
+        }
+        dropRemovedLines(code);
+    }
+}
+
+const char* PeepholeOptimizer::ruleName(PeepholeRule rule) {
+    switch (rule) {
+        case PeepholeRule::kStoreLoad:
+            return "store-load";
+
+        case PeepholeRule::kPushPop:
+            return "push-pop";
+
+        case PeepholeRule::kJumpToNext:
+            return "jump-to-next";
+
+        case PeepholeRule::kJumpChain:
+            return "jump-chain";
+
+        case PeepholeRule::kUnreachable:
+            return "unreachable";
+    }
+    return "";
+}
+
+void PeepholeOptimizer::writeStats(std::ostream& os) const {
+    for (int i = 0; i < kPeepholeRuleCount; ++i) {
+        PeepholeRule rule = static_cast<PeepholeRule>(i);
+        os << "peephole " << ruleName(rule) << " " << hits(rule) << '\n';
+    }
+}
+
+// the first enabled rule that rewrites the instruction at i
+bool PeepholeOptimizer::apply(TmCode& code, size_t i) {
+    return (options_.enabled(PeepholeRule::kStoreLoad) && storeLoad(code, i)) ||
+           (options_.enabled(PeepholeRule::kPushPop) && pushPop(code, i)) ||
+           (options_.enabled(PeepholeRule::kJumpToNext) && jumpToNext(code, i)) ||
+           (options_.enabled(PeepholeRule::kJumpChain) && jumpChain(code, i)) ||
+           (options_.enabled(PeepholeRule::kUnreachable) && unreachable(code, i));
+}
+
+// ST r,a(gp) ... LD q,a(gp) -> ST r,a(gp) ... LDA q,0(r), or nothing when
+// q is r
+bool PeepholeOptimizer::storeLoad(TmCode& code, size_t i) {
+    const TmInstruction& store = code[i];
+    if (!isMemory(store, "ST", Register::gp)) {
+        return false;
+    }
+    size_t j = findLoad(code, i);
+    if (j == code.size()) {
+        return false;
+    }
+    for (size_t k = next(code, i); k < j; k = next(code, k)) {
+        if (writes(code[k], store.r)) {
+            return false;
+        }
+    }
+    if (code[j].r == store.r) {
+        removeLine(code, j);
+    } else {
+        makeMove(code[j], code[j].r, store.r);
+    }
+    hit(PeepholeRule::kStoreLoad);
+    return true;
+}
+
+// ST r,a(mp) ... LD q,a(mp) -> ... LDA q,0(r) while r is kept, or
+// LDA q,0(r) ... while q is not used in between
+bool PeepholeOptimizer::pushPop(TmCode& code, size_t i) {
+    const TmInstruction& store = code[i];
+    if (!isMemory(store, "ST", Register::mp)) {
+        return false;
+    }
+    size_t j = findLoad(code, i);
+    if (j == code.size()) {
+        return false;
+    }
+    Register r = store.r;
+    Register q = code[j].r;
+    bool r_kept = true;
+    bool q_unused = true;
+    for (size_t k = next(code, i); k < j; k = next(code, k)) {
+        r_kept = r_kept && !writes(code[k], r);
+        q_unused = q_unused && !writes(code[k], q) && !reads(code[k], q);
+    }
+    if (r_kept) {
+        removeLine(code, i);
+        if (q == r) {
+            removeLine(code, j);
+        } else {
+            makeMove(code[j], q, r);
+        }
+    } else if (q_unused) {
+        makeMove(code[i], q, r);
+        removeLine(code, j);
+    } else {
+        return false;
+    }
+    hit(PeepholeRule::kPushPop);
+    return true;
+}
+
+bool PeepholeOptimizer::jumpToNext(TmCode& code, size_t i) {
+    if (!code[i].isJump() || live(code, static_cast<size_t>(code[i].target)) != next(code, i)) {
+        return false;
+    }
+    removeLine(code, i);
+    hit(PeepholeRule::kJumpToNext);
+    return true;
+}
+
+bool PeepholeOptimizer::jumpChain(TmCode& code, size_t i) {
+    if (!code[i].isJump()) {
+        return false;
+    }
+    size_t to = live(code, static_cast<size_t>(code[i].target));
+    if (to == code.size() || to == i || !code[to].isUnconditionalJump()) {
+        return false;
+    }
+    size_t final_to = live(code, static_cast<size_t>(code[to].target));
+    if (final_to == to) {
+        return false;
+    }
+    code[i].target = static_cast<int>(final_to);
+    targeted_[final_to] = true;
+    hit(PeepholeRule::kJumpChain);
+    return true;
+}
+
+bool PeepholeOptimizer::unreachable(TmCode& code, size_t i) {
+    if (code[i].op != "HALT" && !code[i].isUnconditionalJump()) {
+        return false;
+    }
+    bool removed = false;
+    for (size_t j = next(code, i); j < code.size() && !targeted_[j]; j = next(code, j)) {
+        removeLine(code, j);
+        hit(PeepholeRule::kUnreachable);
+        removed = true;
+    }
+    return removed;
+}
+
+// The load of the slot the instruction at i stores to, if nothing within
+// the window in between leaves or enters the code, changes the base
+// register or touches the slot.
+size_t PeepholeOptimizer::findLoad(const TmCode& code, size_t i) const {
+    const TmInstruction& store = code[i];
+    size_t j = next(code, i);
+    for (size_t count = 0; count < options_.window && j < code.size(); ++count, j = next(code, j)) {
+        const TmInstruction& ins = code[j];
+        if (targeted_[j]) {
+            break;
+        }
+        if (isMemory(ins, "LD", store.s) && ins.d == store.d) {
+            return j;
+        }
+        if (transfers(ins) || writes(ins, store.s) || (isMemory(ins, "ST", store.s) && ins.d == store.d)) {
+            break;
+        }
+        // the global memory may be stored to through any other register
+        if (store.s == Register::gp && ins.op == "ST" && ins.s != Register::gp && ins.s != Register::mp) {
+            break;
+        }
+    }
+    return code.size();
+}
+
+// the instruction after i that is not removed
+size_t PeepholeOptimizer::next(const TmCode& code, size_t i) const {
+    return live(code, i + 1);
+}
+
+// the instruction at or after i that is not removed
+size_t PeepholeOptimizer::live(const TmCode& code, size_t i) const {
+    i = nextInstruction(code, i);
+    while (i < code.size() && removed_[i]) {
+        i = nextInstruction(code, i + 1);
+    }
+    return i;
+}
+
+void PeepholeOptimizer::hit(PeepholeRule rule) {
+    ++hits_[static_cast<size_t>(rule)];
+}
+
+// Jumps to the line go on to the next instruction, which is jumped to from
+// now on.
+void PeepholeOptimizer::removeLine(const TmCode& code, size_t i) {
+    removed_[i] = true;
+    if (targeted_[i]) {
+        targeted_[next(code, i)] = true;
+    }
+}
+
+void PeepholeOptimizer::dropRemovedLines(TmCode& code) {
+    std::vector<size_t> moved(code.size() + 1);  // the new index of each line
+    size_t kept = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        moved[i] = kept;
+        if (!removed_[i]) {
+            ++kept;
+        }
+    }
+    moved[code.size()] = kept;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!removed_[i] && code[i].isJump()) {
+            code[i].target = static_cast<int>(moved[live(code, static_cast<size_t>(code[i].target))]);
+        }
+    }
+    kept = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!removed_[i]) {
+            if (kept != i) {
+                code[kept] = std::move(code[i]);
+            }
+            ++kept;
+        }
+    }
+    code.resize(kept);
+}
+
+} // namespace nova
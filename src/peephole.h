@@ -0,0 +1,88 @@
+#ifndef __NOVA_PEEPHOLE_H__
+#define __NOVA_PEEPHOLE_H__
+
+#include <stdint.h>
+
+#include <ostream>
+#include <vector>
+
+#include "tm_code.h"
+
+namespace nova {
+
+enum class PeepholeRule {
+    kStoreLoad,     // ST r,a(gp) ... LD q,a(gp): the load takes r instead
+    kPushPop,       // ST r,a(mp) ... LD q,a(mp): the value goes from r to q
+    kJumpToNext,    // a jump to the instruction after it is dropped
+    kJumpChain,     // a jump to an unconditional jump goes to its target
+    kUnreachable,   // what follows an unconditional jump or HALT up to a target
+};
+
+const int kPeepholeRuleCount = 5;
+
+struct PeepholeOptions {
+    PeepholeOptions()
+        : window(4),
+          rules((1u << kPeepholeRuleCount) - 1) {
+    }
+
+    bool enabled(PeepholeRule rule) const { return (rules & bit(rule)) != 0; }
+    void enable(PeepholeRule rule, bool on) { rules = on ? rules | bit(rule) : rules & ~bit(rule); }
+
+    static uint32_t bit(PeepholeRule rule) { return 1u << static_cast<int>(rule); }
+
+    // how many instructions after a store its load is looked for
+    size_t window;
+    // a bit per rule, all of them by default
+    uint32_t rules;
+};
+
+// Rewrites TM code through a window of a few instructions, until no rule
+// applies. A store and a load of the same slot may be apart by up to the
+// window, with nothing in between that jumps, is jumped to, writes the
+// register stored or touches the slot. The temporary memory at mp is taken
+// for a stack: a slot pushed and loaded back is not read again.
+//
+// Lines are only marked while the rules run and removed at the end of
+// each pass, a jump to a removed line going on to the instruction after it.
+class PeepholeOptimizer {
+public:
+    explicit PeepholeOptimizer(const PeepholeOptions& options = PeepholeOptions());
+    PeepholeOptimizer(const PeepholeOptimizer&) = delete;
+    PeepholeOptimizer& operator=(const PeepholeOptimizer&) = delete;
+
+    // the jumps in code must have their target, see resolveTargets()
+    void optimize(TmCode& code);
+
+    // times the rule applied, over all the code optimized so far
+    size_t hits(PeepholeRule rule) const { return hits_[static_cast<size_t>(rule)]; }
+    static const char* ruleName(PeepholeRule rule);
+    // one "peephole <rule> <hits>" line per rule
+    void writeStats(std::ostream& os) const;
+
+private:
+    bool apply(TmCode& code, size_t i);
+    bool storeLoad(TmCode& code, size_t i);
+    bool pushPop(TmCode& code, size_t i);
+    bool jumpToNext(TmCode& code, size_t i);
+    bool jumpChain(TmCode& code, size_t i);
+    bool unreachable(TmCode& code, size_t i);
+
+    // the load of the slot stored at i within the window, code.size() if none
+    size_t findLoad(const TmCode& code, size_t i) const;
+    size_t next(const TmCode& code, size_t i) const;
+    size_t live(const TmCode& code, size_t i) const;
+    void hit(PeepholeRule rule);
+    void removeLine(const TmCode& code, size_t i);
+    void dropRemovedLines(TmCode& code);
+
+private:
+    PeepholeOptions options_;
+    std::vector<size_t> hits_;     // by rule
+    std::vector<bool> removed_;    // by line
+    std::vector<bool> targeted_;   // by line, a jump goes there
+};
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,248 @@
+#include "profiler.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+namespace nova {
+
+namespace vm {
+
+namespace {
+
+// s as a JSON string, quoted, with quotes, backslashes and control
+// characters escaped
+std::string jsonString(const std::string& s) {
+    std::string result = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+            result += escaped;
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+} // namespace
+
+void Profiler::reset(int max_pc) {
+    counts_.assign(static_cast<size_t>(max_pc + 1), 0);
+    taken_.assign(static_cast<size_t>(max_pc + 1), 0);
+    times_.assign(static_cast<size_t>(max_pc + 1), 0);
+    backward_edges_.clear();
+    last_time_ = Clock::now();
+}
+
+std::vector<Profiler::SourceLine> Profiler::sourceLines(const LineTable& line_table) const {
+    std::vector<SourceLine> lines;
+    for (size_t pc = 0; pc < counts_.size(); ++pc) {
+        if (counts_[pc] == 0) {
+            continue;
+        }
+        size_t line = static_cast<size_t>(line_table.lookup(static_cast<int>(pc)));
+        if (lines.size() <= line) {
+            lines.resize(line + 1);
+        }
+        lines[line].count += counts_[pc];
+        lines[line].nanoseconds += times_[pc];
+    }
+    return lines;
+}
+
+void Profiler::printSourceReport(std::ostream& os, const LineTable& line_table) const {
+    if (line_table.empty()) {
+        return;
+    }
+    std::vector<SourceLine> lines = sourceLines(line_table);
+
+    std::vector<size_t> hot_lines;
+    for (size_t line = 1; line < lines.size(); ++line) {
+        if (lines[line].count != 0) {
+            hot_lines.push_back(line);
+        }
+    }
+    std::sort(hot_lines.begin(), hot_lines.end(), [&lines](size_t lhs, size_t rhs) {
+        return lines[lhs].count != lines[rhs].count ? lines[lhs].count > lines[rhs].count : lhs < rhs;
+    });
+    os << "Source line    Count    Time(us)" << std::endl;
+    for (size_t line : hot_lines) {
+        os << line_table.fileName() << ":" << line << "\t" << lines[line].count << "\t" 
+           << static_cast<double>(lines[line].nanoseconds) / 1000.0 << std::endl;
+    }
+
+    std::ifstream source(line_table.fileName());
+    if (!source.is_open()) {
+        return;
+    }
+    os << "Annotated source: " << line_table.fileName() << std::endl;
+    std::string text;
+    for (size_t line = 1; std::getline(source, text); ++line) {
+        os.width(10);
+        if (line < lines.size() && lines[line].count != 0) {
+            os << lines[line].count << "  ";
+            os.width(10);
+            os << static_cast<double>(lines[line].nanoseconds) / 1000.0;
+        } else {
+            os << "" << "  ";
+            os.width(10);
+            os << "";
+        }
+        os << "  " << line << ":  " << text << std::endl;
+    }
+}
+
+std::string Profiler::formatInstruction(const Instruction& ins) {
+    std::ostringstream o;
+    o << ins.name << " " << ins.param1 << ",";
+    if (ins.token_value <= TokenValue::kDiv) {
+        o << ins.param2 << "," << ins.param3;
+    } else {
+        o << ins.param2 << "(" << ins.param3 << ")";
+    }
+    return o.str();
+}
+
+uint64_t Profiler::totalInstructions() const {
+    uint64_t total = 0;
+    for (uint64_t n : counts_) {
+        total += n;
+    }
+    return total;
+}
+
+std::vector<Profiler::Loop> Profiler::hotLoops() const {
+    std::vector<Loop> loops;
+    for (auto& pair : backward_edges_) {
+        Loop loop;
+        loop.tail = static_cast<int>(pair.first >> 32);
+        loop.head = static_cast<int>(pair.first & 0xffffffff);
+        loop.iterations = pair.second;
+        loop.instructions = 0;
+        for (int pc = std::max(loop.head, 0); pc <= loop.tail; ++pc) {
+            loop.instructions += count(pc);
+        }
+        loops.push_back(loop);
+    }
+    std::sort(loops.begin(), loops.end(), [](const Loop& lhs, const Loop& rhs) {
+        if (lhs.instructions != rhs.instructions) {
+            return lhs.instructions > rhs.instructions;
+        }
+        return lhs.head < rhs.head;
+    });
+    return loops;
+}
+
+void Profiler::printReport(std::ostream& os, const InstructionList& instructions) const {
+    uint64_t total = totalInstructions();
+    os << "--------- Profile: " << total << " instructions executed ----------" << std::endl;
+
+    std::map<std::string, uint64_t> opcode_counts;
+    std::vector<std::pair<uint64_t, int>> hot_pcs;
+    for (auto& pair : instructions) {
+        uint64_t n = count(pair.first);
+        if (n == 0) {
+            continue;
+        }
+        opcode_counts[pair.second->name] += n;
+        hot_pcs.push_back(std::make_pair(n, pair.first));
+    }
+
+    std::vector<std::pair<uint64_t, std::string>> sorted_opcodes;
+    for (auto& pair : opcode_counts) {
+        sorted_opcodes.push_back(std::make_pair(pair.second, pair.first));
+    }
+    std::sort(sorted_opcodes.rbegin(), sorted_opcodes.rend());
+    os << "Opcode    Count    Percent" << std::endl;
+    for (auto& pair : sorted_opcodes) {
+        os << pair.second << "\t" << pair.first << "\t"
+           << (total ? 100.0 * static_cast<double>(pair.first) / static_cast<double>(total) : 0.0)
+           << "%" << std::endl;
+    }
+
+    std::sort(hot_pcs.begin(), hot_pcs.end(), [](const std::pair<uint64_t, int>& lhs,
+                                                 const std::pair<uint64_t, int>& rhs) {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    });
+    os << "Pc    Instruction    Count    Taken    NotTaken" << std::endl;
+    for (auto& pair : hot_pcs) {
+        const auto& ins = instructions.find(pair.second)->second;
+        os << pair.second << "\t" << formatInstruction(*ins) << "\t" << pair.first;
+        if (isConditionalJump(ins->token_value)) {
+            uint64_t taken = taken_[static_cast<size_t>(pair.second)];
+            os << "\t" << taken << "\t" << pair.first - taken;
+        }
+        os << std::endl;
+    }
+
+    os << "Hot loops (backward branches)" << std::endl;
+    os << "Head    Tail    Iterations    Instructions" << std::endl;
+    for (const Loop& loop : hotLoops()) {
+        os << loop.head << "\t" << loop.tail << "\t" << loop.iterations << "\t" << loop.instructions << std::endl;
+    }
+}
+
+bool Profiler::writeJson(const std::string& file_name, 
+                         const InstructionList& instructions, 
+                         const LineTable& line_table) const {
+    std::ofstream out(file_name);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    std::map<std::string, uint64_t> opcode_counts;
+    for (auto& pair : instructions) {
+        opcode_counts[pair.second->name] += count(pair.first);
+    }
+
+    out << "{\n  \"instructions\": " << totalInstructions() << ",\n  \"opcodes\": {";
+    bool first = true;
+    for (auto& pair : opcode_counts) {
+        out << (first ? "\n" : ",\n") << "    \"" << pair.first << "\": " << pair.second;
+        first = false;
+    }
+    out << "\n  },\n  \"pcs\": [";
+    first = true;
+    for (auto& pair : instructions) {
+        out << (first ? "\n" : ",\n") << "    {\"pc\": " << pair.first << ", \"opcode\": \""
+            << pair.second->name << "\", \"count\": " << count(pair.first);
+        if (isConditionalJump(pair.second->token_value)) {
+            uint64_t taken = taken_[static_cast<size_t>(pair.first)];
+            out << ", \"taken\": " << taken << ", \"not_taken\": " << count(pair.first) - taken;
+        }
+        out << ", \"line\": " << line_table.lookup(pair.first) << ", \"ns\": " << nanoseconds(pair.first) << "}";
+        first = false;
+    }
+    out << "\n  ],\n  \"loops\": [";
+    first = true;
+    for (const Loop& loop : hotLoops()) {
+        out << (first ? "\n" : ",\n") << "    {\"head\": " << loop.head << ", \"tail\": " << loop.tail
+            << ", \"iterations\": " << loop.iterations << ", \"instructions\": " << loop.instructions << "}";
+        first = false;
+    }
+    out << "\n  ],\n  \"file\": " << jsonString(line_table.fileName()) << ",\n  \"lines\": [";
+    std::vector<SourceLine> lines = sourceLines(line_table);
+    first = true;
+    for (size_t line = 1; line < lines.size(); ++line) {
+        if (lines[line].count == 0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n") << "    {\"line\": " << line << ", \"count\": " << lines[line].count
+            << ", \"ns\": " << lines[line].nanoseconds << "}";
+        first = false;
+    }
+    out << "\n  ]\n}" << std::endl;
+    return true;
+}
+
+} // namespace vm
+
+} // namespace nova
@@ -0,0 +1,101 @@
+#ifndef __NOVA_PROFILER_H__
+#define __NOVA_PROFILER_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <chrono>
+
+#include "vm.h"
+#include "line_table.h"
+
+namespace nova {
+
+namespace vm {
+
+// Per-instruction execution profile of a TM program.
+// Only touched by the profiling instantiation of the dispatch loop.
+class Profiler {
+public:
+    Profiler() = default;
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void reset(int max_pc);
+
+    // called once per executed instruction, next_pc is the pc after execution.
+    // The time since the previous call is charged to pc.
+    void record(int pc, TokenValue opcode, int next_pc) {
+        Clock::time_point now = Clock::now();
+        times_[static_cast<size_t>(pc)] += static_cast<uint64_t>((now - last_time_).count());
+        last_time_ = now;
+        ++counts_[static_cast<size_t>(pc)];
+        if (next_pc != pc + 1) {
+            if (isConditionalJump(opcode)) {
+                ++taken_[static_cast<size_t>(pc)];
+            }
+            if (next_pc <= pc) {
+                ++backward_edges_[edgeKey(pc, next_pc)];
+            }
+        }
+    }
+
+    uint64_t totalInstructions() const;
+    uint64_t count(int pc) const { return counts_[static_cast<size_t>(pc)]; }
+    uint64_t nanoseconds(int pc) const { return times_[static_cast<size_t>(pc)]; }
+
+    void printReport(std::ostream& os, const InstructionList& instructions) const;
+    // per TINY line totals and the annotated source file, if it can be read
+    void printSourceReport(std::ostream& os, const LineTable& line_table) const;
+    bool writeJson(const std::string& file_name, 
+                   const InstructionList& instructions, 
+                   const LineTable& line_table) const;
+
+    static bool isConditionalJump(TokenValue opcode) {
+        return opcode >= TokenValue::kJlt && opcode <= TokenValue::kJne;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Loop {
+        int head;
+        int tail;
+        uint64_t iterations;
+        uint64_t instructions;
+    };
+
+    static uint64_t edgeKey(int from, int to) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(from)) << 32) | static_cast<uint32_t>(to);
+    }
+
+    struct SourceLine {
+        SourceLine()
+            : count(0), 
+              nanoseconds(0) {
+        }
+
+        uint64_t count;
+        uint64_t nanoseconds;
+    };
+
+    std::vector<Loop> hotLoops() const;
+    std::vector<SourceLine> sourceLines(const LineTable& line_table) const;
+    static std::string formatInstruction(const Instruction& ins);
+
+private:
+    std::vector<uint64_t> counts_;
+    std::vector<uint64_t> taken_;
+    std::vector<uint64_t> times_;
+    Clock::time_point last_time_;
+    std::unordered_map<uint64_t, uint64_t> backward_edges_;
+};
+
+} // namespace vm
+
+} // namespace nova
+
+#endif
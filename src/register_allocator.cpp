@@ -0,0 +1,58 @@
+#include "register_allocator.h"
+
+#include <algorithm>
+
+namespace nova {
+
+std::vector<Register> RegisterAllocator::allocate(const std::vector<LiveInterval>& intervals) const {
+    std::vector<Register> result(intervals.size(), Register::invalid);
+    std::vector<size_t> order(intervals.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&intervals](size_t a, size_t b) {
+        if (intervals[a].start != intervals[b].start) {
+            return intervals[a].start < intervals[b].start;
+        }
+        return intervals[a].end < intervals[b].end;
+    });
+
+    std::vector<Register> free_registers(registers_.rbegin(), registers_.rend());  // the first one on top
+    std::vector<size_t> active;  // the intervals holding a register
+    for (size_t i : order) {
+        const LiveInterval& interval = intervals[i];
+        for (size_t j = 0; j < active.size();) {
+            if (intervals[active[j]].end < interval.start) {
+                free_registers.push_back(result[active[j]]);
+                active[j] = active.back();
+                active.pop_back();
+            } else {
+                ++j;
+            }
+        }
+        if (!free_registers.empty()) {
+            std::sort(free_registers.begin(), free_registers.end(), [](Register a, Register b) {
+                return static_cast<int>(a) > static_cast<int>(b);
+            });
+            result[i] = free_registers.back();
+            free_registers.pop_back();
+            active.push_back(i);
+            continue;
+        }
+        size_t cheapest = active.size();
+        for (size_t j = 0; j < active.size(); ++j) {
+            if (intervals[active[j]].weight < interval.weight &&
+                (cheapest == active.size() || intervals[active[j]].weight < intervals[active[cheapest]].weight)) {
+                cheapest = j;
+            }
+        }
+        if (cheapest < active.size()) {
+            result[i] = result[active[cheapest]];
+            result[active[cheapest]] = Register::invalid;
+            active[cheapest] = i;
+        }
+    }
+    return result;
+}
+
+} // namespace nova
@@ -0,0 +1,44 @@
+#ifndef __NOVA_REGISTER_ALLOCATOR_H__
+#define __NOVA_REGISTER_ALLOCATOR_H__
+
+#include <vector>
+
+#include "codegen.h"
+
+namespace nova {
+
+// Where a value is live, as one interval over the positions of the code
+// from its first to its last live position.
+struct LiveInterval {
+    LiveInterval(int interval_start, int interval_end, double interval_weight)
+        : start(interval_start),
+          end(interval_end),
+          weight(interval_weight) {
+    }
+
+    int start;
+    int end;        // inclusive
+    double weight;  // what keeping it in memory costs
+};
+
+// Linear scan register allocation (Poletto and Sarkar) over whole
+// intervals: an interval gets one register for all of it or stays in
+// memory. When no register is free at the start of an interval, the one
+// with the least weight among it and the intervals holding a register is
+// the one left in memory.
+class RegisterAllocator {
+public:
+    explicit RegisterAllocator(const std::vector<Register>& registers)
+        : registers_(registers) {
+    }
+
+    // the register of each interval, Register::invalid for memory
+    std::vector<Register> allocate(const std::vector<LiveInterval>& intervals) const;
+
+private:
+    std::vector<Register> registers_;
+};
+
+} // namespace nova
+
+#endif
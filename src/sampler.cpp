@@ -0,0 +1,204 @@
+#include "sampler.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace nova {
+
+namespace vm {
+
+const size_t Sampler::kRingSize;
+std::atomic<Sampler*> Sampler::current_(nullptr);
+
+namespace {
+
+struct sigaction g_old_action;
+timer_t g_timer;
+
+} // namespace
+
+Sampler::Sampler(int frequency)
+    : frequency_(frequency > 0 ? frequency : 1000),
+      running_(false),
+      stop_drain_(false),
+      samples_(0),
+      head_(0),
+      tail_(0),
+      dropped_(0),
+      pc_(nullptr) {
+}
+
+Sampler::~Sampler() {
+    stop();
+}
+
+bool Sampler::start(const std::atomic<int>* pc) {
+    Sampler* expected = nullptr;
+    if (running_ || !current_.compare_exchange_strong(expected, this)) {
+        std::cerr << "sampler is already running" << std::endl;
+        return false;
+    }
+    pc_ = pc;
+    histogram_.clear();
+    samples_ = 0;
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+    stop_drain_.store(false, std::memory_order_relaxed);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &Sampler::handleSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &g_old_action) != 0) {
+        std::cerr << "sampler: sigaction failed: " << strerror(errno) << std::endl;
+        current_.store(nullptr);
+        return false;
+    }
+
+    // the drain thread inherits a mask with SIGPROF blocked, so the handler
+    // only ever runs on the thread executing the program
+    sigset_t prof_set;
+    sigset_t old_set;
+    sigemptyset(&prof_set);
+    sigaddset(&prof_set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &prof_set, &old_set);
+    drain_thread_ = std::thread(&Sampler::drainLoop, this);
+    pthread_sigmask(SIG_SETMASK, &old_set, nullptr);
+
+    // cpu time timers (ITIMER_PROF, CLOCK_PROCESS_CPUTIME_ID) are only checked
+    // on the scheduler tick, which caps them at HZ. A monotonic high resolution
+    // timer really fires at 1 kHz; the VM is cpu bound, so wall and cpu time
+    // agree except while IN waits for input.
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGPROF;
+    struct itimerspec timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_nsec = std::max(1000000000L / frequency_, 1000L);
+    timer.it_value = timer.it_interval;
+    if (timer_create(CLOCK_MONOTONIC, &event, &g_timer) != 0) {
+        std::cerr << "sampler: timer_create failed: " << strerror(errno) << std::endl;
+        stopDrainThread();
+        return false;
+    }
+    if (timer_settime(g_timer, 0, &timer, nullptr) != 0) {
+        std::cerr << "sampler: timer_settime failed: " << strerror(errno) << std::endl;
+        timer_delete(g_timer);
+        stopDrainThread();
+        return false;
+    }
+    running_ = true;
+    return true;
+}
+
+void Sampler::stop() {
+    if (!running_) {
+        return;
+    }
+    timer_delete(g_timer);
+    stopDrainThread();
+    running_ = false;
+}
+
+void Sampler::stopDrainThread() {
+    sigaction(SIGPROF, &g_old_action, nullptr);
+    current_.store(nullptr, std::memory_order_release);
+    stop_drain_.store(true, std::memory_order_release);
+    drain_thread_.join();
+    drain();
+}
+
+void Sampler::handleSignal(int signo) {
+    Sampler* sampler = current_.load(std::memory_order_acquire);
+    if (sampler == nullptr) {
+        return;
+    }
+    size_t head = sampler->head_.load(std::memory_order_relaxed);
+    if (head - sampler->tail_.load(std::memory_order_acquire) >= kRingSize) {
+        sampler->dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    sampler->ring_[head & (kRingSize - 1)] = sampler->pc_->load(std::memory_order_relaxed);
+    sampler->head_.store(head + 1, std::memory_order_release);
+}
+
+void Sampler::drainLoop() {
+    while (!stop_drain_.load(std::memory_order_acquire)) {
+        drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void Sampler::drain() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+        int pc = ring_[tail & (kRingSize - 1)];
+        if (pc < 0) {
+            continue;
+        }
+        if (histogram_.size() <= static_cast<size_t>(pc)) {
+            histogram_.resize(static_cast<size_t>(pc) + 1, 0);
+        }
+        ++histogram_[static_cast<size_t>(pc)];
+        ++samples_;
+    }
+    tail_.store(tail, std::memory_order_release);
+}
+
+void Sampler::printReport(std::ostream& os, 
+                          const InstructionList& instructions, 
+                          const LineTable& line_table) const {
+    os << "--------- Samples: " << samples_ << " at " << frequency_ << " Hz, " 
+       << dropped() << " dropped ----------" << std::endl;
+    std::vector<std::pair<uint64_t, int>> hot_pcs;
+    for (size_t pc = 0; pc < histogram_.size(); ++pc) {
+        if (histogram_[pc] != 0) {
+            hot_pcs.push_back(std::make_pair(histogram_[pc], static_cast<int>(pc)));
+        }
+    }
+    std::sort(hot_pcs.begin(), hot_pcs.end(), [](const std::pair<uint64_t, int>& lhs,
+                                                 const std::pair<uint64_t, int>& rhs) {
+        return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+    });
+    os << "Pc    Instruction    Line    Samples    Percent" << std::endl;
+    for (auto& pair : hot_pcs) {
+        auto it = instructions.find(pair.second);
+        os << pair.second << "\t" << (it != instructions.end() ? it->second->name : "?") << "\t" 
+           << line_table.lookup(pair.second) << "\t" << pair.first << "\t"
+           << 100.0 * static_cast<double>(pair.first) / static_cast<double>(samples_) << "%" << std::endl;
+    }
+}
+
+bool Sampler::writeFolded(const std::string& file_name, 
+                          const InstructionList& instructions, 
+                          const LineTable& line_table) const {
+    std::ofstream out(file_name);
+    if (!out.is_open()) {
+        return false;
+    }
+    const std::string& source = line_table.fileName().empty() ? "tm" : line_table.fileName();
+    for (size_t pc = 0; pc < histogram_.size(); ++pc) {
+        if (histogram_[pc] == 0) {
+            continue;
+        }
+        int line = line_table.lookup(static_cast<int>(pc));
+        auto it = instructions.find(static_cast<int>(pc));
+        out << source << ";" << source << ":" << line << ";" << pc << " "
+            << (it != instructions.end() ? it->second->name : "?") << " " << histogram_[pc] << "\n";
+    }
+    return true;
+}
+
+} // namespace vm
+
+} // namespace nova
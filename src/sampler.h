@@ -0,0 +1,72 @@
+#ifndef __NOVA_SAMPLER_H__
+#define __NOVA_SAMPLER_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <iostream>
+
+#include "vm.h"
+#include "line_table.h"
+
+namespace nova {
+
+namespace vm {
+
+// Statistical profiler for long running programs. A SIGPROF timer
+// samples the pc published by the dispatch loop into a lock-free ring buffer,
+// a background thread drains the ring into a per-pc histogram.
+// Only one sampler can be running in a process at a time.
+class Sampler {
+public:
+    static const size_t kRingSize = 1 << 14;  // power of 2
+
+    explicit Sampler(int frequency);
+    ~Sampler();
+    Sampler(const Sampler&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
+
+    bool start(const std::atomic<int>* pc);
+    void stop();
+
+    uint64_t samples() const { return samples_; }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    void printReport(std::ostream& os, const InstructionList& instructions, const LineTable& line_table) const;
+    // one "file;file:line;pc opcode count" line per sampled pc, the input
+    // format of flamegraph.pl
+    bool writeFolded(const std::string& file_name, 
+                     const InstructionList& instructions, 
+                     const LineTable& line_table) const;
+
+private:
+    static void handleSignal(int signo);
+    void drainLoop();
+    void stopDrainThread();
+    void drain();
+
+private:
+    int frequency_;
+    bool running_;
+    std::thread drain_thread_;
+    std::atomic<bool> stop_drain_;
+    std::vector<uint64_t> histogram_;
+    uint64_t samples_;
+
+    int ring_[kRingSize];
+    std::atomic<size_t> head_;  // written by the signal handler only
+    std::atomic<size_t> tail_;  // written by the drain thread only
+    std::atomic<uint64_t> dropped_;
+    const std::atomic<int>* pc_;
+
+    static std::atomic<Sampler*> current_;
+};
+
+} // namespace vm
+
+} // namespace nova
+
+#endif
@@ -1,235 +1,271 @@
 #include "scanner.h"
 #include "error.h"
+#include "char_class.h"
+#include "file_table.h"
+
+#include <string.h>
 
 namespace nova {
 
 bool Scanner::error_flag_ = false;
 
 Scanner::Scanner(const std::string& file_name)
-    : file_name_(file_name),
-      input_(file_name),
-      line_(1),
-      column_(0),
-      current_char_(0),
-      state_(State::kNone),
-      token_(TokenType::kUnknownType, 
-             TokenValue::kUnReserved, 
-             TokenLocation(),
-             -1,
-             "",
-             "") {
-    addToken("if", makeTokenRecord(TokenType::kKeyword, TokenValue::kIf, -1));
-    addToken("then", makeTokenRecord(TokenType::kKeyword, TokenValue::kThen, -1));
-    addToken("else", makeTokenRecord(TokenType::kKeyword, TokenValue::kElse, -1));
-    addToken("end", makeTokenRecord(TokenType::kKeyword, TokenValue::kEnd, -1));
-    addToken("repeat", makeTokenRecord(TokenType::kKeyword, TokenValue::kRepeat, -1));
-    addToken("until", makeTokenRecord(TokenType::kKeyword, TokenValue::kUntil, -1));
-    addToken("read", makeTokenRecord(TokenType::kKeyword, TokenValue::kRead, -1));
-    addToken("write", makeTokenRecord(TokenType::kKeyword, TokenValue::kWrite, -1));
-    addToken("+", makeTokenRecord(TokenType::kOperator, TokenValue::kPlus, 5));
-    addToken("-", makeTokenRecord(TokenType::kOperator, TokenValue::kMinus, 5));
-    addToken("*", makeTokenRecord(TokenType::kOperator, TokenValue::kMultiply, 10));
-    addToken("/", makeTokenRecord(TokenType::kOperator, TokenValue::kDivide, 10));
-    addToken("=", makeTokenRecord(TokenType::kOperator, TokenValue::kEqual, 2));
-    addToken("<", makeTokenRecord(TokenType::kOperator, TokenValue::kLess, 2));
-    addToken("(", makeTokenRecord(TokenType::kDelimiter, TokenValue::kLeftParenthesis, -1));
-    addToken(")", makeTokenRecord(TokenType::kDelimiter, TokenValue::kRightParenthesis, -1));
-    addToken(";", makeTokenRecord(TokenType::kDelimiter, TokenValue::kSemicolon, -1));
-    addToken(":=", makeTokenRecord(TokenType::kOperator, TokenValue::kAssign, 0));
-
-    getNextChar();
+    : source_(std::make_shared<SourceBuffer>(file_name)) {
+    init();
 }
 
-void Scanner::addToken(const std::string& name, TokenRecordPtr&& record) {
-    if (map_.find(name) == map_.end()) {
-        map_[name] = std::move(record);
-    }
+Scanner::Scanner(const std::string& file_name, const char* data, size_t size)
+    : source_(std::make_shared<SourceBuffer>(file_name, data, size)) {
+    init();
 }
 
-void Scanner::getNextChar() {
-   current_char_ = static_cast<char>(input_.get());
-   if (current_char_ == '\n') {
-        ++line_;
-        column_ = 0;
-   } else {
-       ++column_;
-   }
+Scanner::Scanner(const std::string& file_name, std::string&& text)
+    : source_(std::make_shared<SourceBuffer>(file_name, std::move(text))) {
+    init();
 }
-void Scanner::makeToken(TokenType token_type, 
-                        TokenValue token_value, 
-                        TokenLocation token_location,
-                        int symbol_precedence, 
-                        const std::string& name) {
-    token_ = Token(token_type, token_value, token_location, symbol_precedence, name);
-    buffer_.clear();
-    state_ = State::kNone;
+
+Scanner::Scanner(const std::string& file_name, std::istream& is)
+    : source_(std::make_shared<SourceBuffer>(file_name, is)) {
+    init();
 }
 
-void Scanner::makeToken(TokenType token_type, 
-                        TokenValue token_value, 
-                        TokenLocation token_location,
-                        int symbol_precedence, 
-                        const std::string& name, 
-                        const std::string& string_value) {
-    token_ = Token(token_type, token_value, token_location, symbol_precedence, name, string_value);
-    buffer_.clear();
-    state_ = State::kNone;
+Scanner::Scanner(const Scanner& scanner, StringPiece piece)
+    : source_(scanner.source_),
+      file_id_(scanner.file_id_),
+      current_(piece.begin()),
+      end_(piece.end()),
+      token_start_(current_),
+      symbol_table_(nullptr),
+      token_symbol_(-1) {
 }
 
-void Scanner::makeToken(TokenType token_type, 
-                        TokenValue token_value, 
-                        TokenLocation token_location,
-                        int symbol_precedence, 
-                        const std::string& name, 
-                        int64_t int_value) {
-    token_ = Token(token_type, token_value, token_location, symbol_precedence, name, int_value);
-    buffer_.clear();
-    state_ = State::kNone;
+void Scanner::init() {
+    file_id_ = FileTable::instance().add(source_);
+    current_ = source_->data();
+    end_ = current_ + source_->size();
+    beginToken();
+    symbol_table_ = nullptr;
+    token_symbol_ = -1;
+    if (source_->size() > FileTable::kMaxFileSize) {
+        errorReport("error: source files are limited to 4 GiB");
+        end_ = current_;
+    }
 }
 
-char Scanner::peekChar() {
-    char c = static_cast<char>(input_.peek());
-    return c;
+void Scanner::makeToken(TokenType token_type, TokenValue token_value, int symbol_precedence) {
+    token_ = Token(token_type, 
+                   token_value, 
+                   symbol_precedence, 
+                   StringPiece(token_start_, static_cast<size_t>(current_ - token_start_)), 
+                   tokenLocation());
 }
 
-void Scanner::addToBuffer(char c) {
-    buffer_.push_back(c);
+void Scanner::errorReport(const std::string& message) {
+    errorToken(tokenLocation().toString() + message);
 }
 
-void Scanner::popBuffer() {
-    buffer_.pop_back();
+namespace {
+
+typedef Scanner::State State;
+
+struct Transition {
+    State next;
+    bool consume;  // false for the lookahead character ending a token
+};
+
+constexpr Transition go(State next) { return Transition{next, true}; }
+constexpr Transition stop(State next) { return Transition{next, false}; }
+
+// Rows are states, columns are character classes in CharClass order:
+// other, space, digit, letter, {, }, :, =, operator, end.
+// The space, digit, letter and comment self loops are consumed in bulk by
+// the run scanners of char_class.h before the table is consulted.
+constexpr Transition kTransitions[static_cast<int>(State::kStateCount)][kCharClassCount] = {
+    // kStart
+    { go(State::kErrorCharacter), go(State::kStart), go(State::kNumber), go(State::kIdentifier), 
+      go(State::kComment), go(State::kErrorCharacter), go(State::kColon), go(State::kAcceptOperator), 
+      go(State::kAcceptOperator), stop(State::kAcceptEndOfFile) },
+    // kNumber
+    { stop(State::kAcceptNumber), stop(State::kAcceptNumber), go(State::kNumber), stop(State::kAcceptNumber), 
+      stop(State::kAcceptNumber), stop(State::kAcceptNumber), stop(State::kAcceptNumber), stop(State::kAcceptNumber), 
+      stop(State::kAcceptNumber), stop(State::kAcceptNumber) },
+    // kIdentifier
+    { stop(State::kAcceptIdentifier), stop(State::kAcceptIdentifier), stop(State::kAcceptIdentifier), 
+      go(State::kIdentifier), stop(State::kAcceptIdentifier), stop(State::kAcceptIdentifier), 
+      stop(State::kAcceptIdentifier), stop(State::kAcceptIdentifier), stop(State::kAcceptIdentifier), 
+      stop(State::kAcceptIdentifier) },
+    // kComment
+    { go(State::kComment), go(State::kComment), go(State::kComment), go(State::kComment), 
+      go(State::kComment), go(State::kStart), go(State::kComment), go(State::kComment), 
+      go(State::kComment), stop(State::kErrorComment) },
+    // kColon, only ":=" is a token
+    { stop(State::kErrorCharacter), stop(State::kErrorCharacter), stop(State::kErrorCharacter), 
+      stop(State::kErrorCharacter), stop(State::kErrorCharacter), stop(State::kErrorCharacter), 
+      stop(State::kErrorCharacter), go(State::kAcceptAssign), stop(State::kErrorCharacter), 
+      stop(State::kErrorCharacter) },
+};
+
+struct Keyword {
+    const char* name;
+    size_t length;
+    TokenRecord record;
+};
+
+constexpr Keyword kKeywords[] = {
+    { "if", 2, TokenRecord(TokenType::kKeyword, TokenValue::kIf, -1) },
+    { "then", 4, TokenRecord(TokenType::kKeyword, TokenValue::kThen, -1) },
+    { "else", 4, TokenRecord(TokenType::kKeyword, TokenValue::kElse, -1) },
+    { "end", 3, TokenRecord(TokenType::kKeyword, TokenValue::kEnd, -1) },
+    { "repeat", 6, TokenRecord(TokenType::kKeyword, TokenValue::kRepeat, -1) },
+    { "until", 5, TokenRecord(TokenType::kKeyword, TokenValue::kUntil, -1) },
+    { "read", 4, TokenRecord(TokenType::kKeyword, TokenValue::kRead, -1) },
+    { "write", 5, TokenRecord(TokenType::kKeyword, TokenValue::kWrite, -1) },
+};
+
+const size_t kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+const size_t kMinKeywordLength = 2;
+const size_t kMaxKeywordLength = 6;
+const size_t kKeywordSlots = 16;
+
+// second character plus length is collision free on the keywords
+constexpr size_t keywordHash(const char* text, size_t length) {
+    return (static_cast<unsigned char>(text[1]) + length) & (kKeywordSlots - 1);
 }
 
-void Scanner::errorReport(const std::string& message) {
-    errorToken(getTokenLocation().toString() + message);
+// slot -> index in kKeywords plus one, zero for empty slots
+struct KeywordTable {
+    constexpr KeywordTable()
+        : slots(), 
+          perfect(true) {
+        for (size_t i = 0; i < kKeywordCount; ++i) {
+            size_t slot = keywordHash(kKeywords[i].name, kKeywords[i].length);
+            perfect = perfect && slots[slot] == 0;
+            slots[slot] = static_cast<uint8_t>(i + 1);
+        }
+    }
+
+    uint8_t slots[kKeywordSlots];
+    bool perfect;
+};
+
+constexpr KeywordTable kKeywordTable;
+static_assert(kKeywordTable.perfect, "keywordHash has collisions");
+
+const TokenRecord* findKeyword(const char* text, size_t length) {
+    if (length < kMinKeywordLength || length > kMaxKeywordLength) {
+        return nullptr;
+    }
+    uint8_t slot = kKeywordTable.slots[keywordHash(text, length)];
+    if (slot == 0) {
+        return nullptr;
+    }
+    const Keyword& keyword = kKeywords[slot - 1];
+    if (keyword.length != length || memcmp(keyword.name, text, length) != 0) {
+        return nullptr;
+    }
+    return &keyword.record;
 }
 
-void Scanner::skipWhitespace() {
-    while (std::isspace(current_char_)) {
-        getNextChar(); 
+constexpr TokenRecord kAssign(TokenType::kOperator, TokenValue::kAssign, 0);
+
+// c is one of the kCharOperator or kCharEqual characters
+TokenRecord operatorRecord(char c) {
+    switch (c) {
+        case '+': return TokenRecord(TokenType::kOperator, TokenValue::kPlus, 5);
+        case '-': return TokenRecord(TokenType::kOperator, TokenValue::kMinus, 5);
+        case '*': return TokenRecord(TokenType::kOperator, TokenValue::kMultiply, 10);
+        case '/': return TokenRecord(TokenType::kOperator, TokenValue::kDivide, 10);
+        case '=': return TokenRecord(TokenType::kOperator, TokenValue::kEqual, 2);
+        case '<': return TokenRecord(TokenType::kOperator, TokenValue::kLess, 2);
+        case '(': return TokenRecord(TokenType::kDelimiter, TokenValue::kLeftParenthesis, -1);
+        case ')': return TokenRecord(TokenType::kDelimiter, TokenValue::kRightParenthesis, -1);
+        default:  return TokenRecord(TokenType::kDelimiter, TokenValue::kSemicolon, -1);
     }
 }
 
-Token Scanner::getNextToken() {
-    state_ = State::kStart;
+} // namespace
 
-    do {
-        switch (state_) {
+const Token& Scanner::getNextToken() {
+    State state = State::kStart;
+
+    for (;;) {
+        switch (state) {
             case State::kStart:
-                handleStartState();
+                current_ = skipSpaces(current_, end_);
+                beginToken();
                 break;
 
             case State::kNumber:
-                handleNumberState(); 
+                current_ = skipDigits(current_, end_);
                 break;
 
             case State::kIdentifier:
-                handleIdentifierState(); 
+                current_ = skipLetters(current_, end_);
                 break;
 
             case State::kComment:
-                handleCommentState();               
-                break;
-
-            case State::kOperator:
-                handleOperatorState();
-                break;
-
-            case State::kEndOfFile:
-                handEndOfFileState();
+                current_ = skipCommentBody(current_, end_);
                 break;
 
             default:
-                errorReport("Match error state.");
-                state_ = State::kNone;
-                buffer_.clear();
                 break;
         }
-    } while (state_ != State::kNone);
-
-    return token_;
-}
 
-void Scanner::handleStartState() {
-    skipWhitespace();
-    if (input_.eof()) {
-        state_ = State::kEndOfFile;
-    } else if (std::isdigit(current_char_)) {
-        state_ = State::kNumber;
-    } else if (std::isalpha(current_char_)) {
-        state_ = State::kIdentifier;
-    } else if (current_char_ == '{') {
-        state_ = State::kComment;   
-    } else {
-        state_ = State::kOperator;
+        CharClass char_class = current_ == end_ ? kCharEnd : charClass(*current_);
+        const Transition& transition = kTransitions[static_cast<int>(state)][char_class];
+        if (transition.consume) {
+            ++current_;
+        }
+        state = transition.next;
+        if (state >= State::kAcceptNumber) {
+            acceptToken(state);
+            return token_;
+        }
     }
 }
 
-void Scanner::handleCommentState() {
-    updateTokenLocation();
-    while (current_char_ != '}') {
-        getNextChar();
-        if (input_.eof()) {
-            std::string message = "End of file happened in comment, } is expected, buf find ";
-            errorReport(message + current_char_);
-            buffer_.clear();
+void Scanner::acceptToken(State state) {
+    switch (state) {
+        case State::kAcceptNumber:
+            makeToken(TokenType::kNumber, TokenValue::kUnReserved, -1);
+            break;
+
+        case State::kAcceptIdentifier: {
+            const TokenRecord* keyword = findKeyword(token_start_, static_cast<size_t>(current_ - token_start_));
+            if (keyword != nullptr) {
+                makeToken(*keyword);
+            } else {
+                makeToken(TokenType::kIdentifier, TokenValue::kUnReserved, -1);
+                if (symbol_table_ != nullptr) {
+                    token_symbol_ = symbol_table_->intern(token_.getTokenName(), tokenLocation());
+                }
+            }
             break;
         }
-    }
-    state_ = State::kStart;
-    getNextChar();
-}
 
-void Scanner::handleNumberState() {
-    updateTokenLocation();
-    while (std::isdigit(current_char_)) {
-        addToBuffer(current_char_);
-        getNextChar();   
-    }
-    makeToken(TokenType::kNumber, TokenValue::kUnReserved, getTokenLocation(), -1, buffer_, std::stoll(buffer_));
-}
+        case State::kAcceptOperator:
+            makeToken(operatorRecord(*token_start_));
+            break;
 
-void Scanner::handleIdentifierState() {
-    updateTokenLocation();
-    while (std::isalpha(current_char_)) {
-        addToBuffer(current_char_);
-        getNextChar();
-    }
-    Map::iterator it = map_.find(buffer_);
-    if (it != map_.end()) {
-        makeToken(it->second->token_type, it->second->token_value, getTokenLocation(), it->second->symbol_precedence, buffer_);
-    } else {
-        makeToken(TokenType::kIdentifier, TokenValue::kUnReserved, getTokenLocation(), -1, buffer_);
-    }
-}
+        case State::kAcceptAssign:
+            makeToken(kAssign);
+            break;
 
-void Scanner::handleOperatorState() {
-    updateTokenLocation();
-    addToBuffer(current_char_);
-    addToBuffer(peekChar());
-    Map::iterator it = map_.find(buffer_);
-    if (it != map_.end()) {
-        getNextChar();
-        makeToken(it->second->token_type, it->second->token_value, getTokenLocation(), it->second->symbol_precedence, buffer_);
-        getNextChar();
-    } else {
-        popBuffer();
-        it = map_.find(buffer_);
-        if (it != map_.end()) {
-            makeToken(it->second->token_type, it->second->token_value, getTokenLocation(), it->second->symbol_precedence, buffer_);
-            getNextChar();
-        } else {
-            errorReport("error: invalid character '" + buffer_ + "'");
-            state_ = State::kNone;
-            buffer_.clear();
-        }
-    }
-}
+        case State::kErrorCharacter:
+            errorReport("error: invalid character '" + std::string(token_start_, current_) + "'");
+            makeToken(TokenType::kUnknownType, TokenValue::kUnReserved, -1);
+            break;
+
+        case State::kErrorComment:
+            errorReport("End of file happened in comment, } is expected");
+            beginToken();
+            makeToken(TokenType::kEndOfFile, TokenValue::kUnReserved, -1);
+            break;
 
-void Scanner::handEndOfFileState() {
-    updateTokenLocation();
-    makeToken(TokenType::kEndOfFile, TokenValue::kUnReserved, getTokenLocation(), -1, buffer_);
-    input_.close();
+        default:
+            makeToken(TokenType::kEndOfFile, TokenValue::kUnReserved, -1);
+            break;
+    }
 }
 
 } // namespace nova
@@ -1,93 +1,91 @@
 #ifndef __NOVA_SCANNER_H__
 #define __NOVA_SCANNER_H__
 
-#include <fstream>
-#include <unordered_map>
+#include <stdint.h>
+
+#include <string>
 #include <memory>
 
 #include "token.h"
+#include "source_buffer.h"
+#include "symbol_table.h"
 
 namespace nova {
 
 class Scanner {
 public:
-    enum class State { 
-        kNone,
+    // states of the lexer DFA, see kTransitions in scanner.cpp
+    enum class State : uint8_t { 
         kStart,
         kNumber,
         kIdentifier,
         kComment,
-        kOperator,
-        kEndOfFile,
+        kColon,
+        // accepting states, anything from here on ends the token
+        kAcceptNumber,
+        kAcceptIdentifier,
+        kAcceptOperator,
+        kAcceptAssign,
+        kAcceptEndOfFile,
+        kErrorCharacter,
+        kErrorComment,
+        kStateCount,
     };
 
+    // maps the file, "-" reads standard input
     explicit Scanner(const std::string& file_name);
+    // scans size bytes at data, which must outlive the scanner and its tokens
+    Scanner(const std::string& file_name, const char* data, size_t size);
+    // scans text, kept alive with the locations
+    Scanner(const std::string& file_name, std::string&& text);
+    Scanner(const std::string& file_name, std::istream& is);
+    // scans piece, a part of the remaining input of scanner, giving its
+    // tokens the locations they have in scanner
+    Scanner(const Scanner& scanner, StringPiece piece);
 
     Scanner(const Scanner&) = delete;
     Scanner& operator=(const Scanner&) = delete;
 
-    Token getNextToken();
-    Token getToken() const { return token_; }
-    TokenLocation getTokenLocation() { return location_; }
-    bool isFileOpened() const { return input_.is_open(); }
+    const Token& getNextToken();
+    const Token& getToken() const { return token_; }
+    // interns every identifier into symbol_table as it is scanned
+    void setSymbolTable(SymbolTable* symbol_table) { symbol_table_ = symbol_table; }
+    // slot of the current token if it is an identifier, -1 without a table
+    int getTokenSymbol() const { return token_symbol_; }
+    TokenLocation getTokenLocation() const { return token_.getTokenLocation(); }
+    bool isFileOpened() const { return source_->isOpened(); }
+    const std::string& fileName() const { return source_->name(); }
+    uint32_t fileId() const { return file_id_; }
+    // the input after the current token
+    StringPiece remainingInput() const { return StringPiece(current_, static_cast<size_t>(end_ - current_)); }
 
     static void setErrorFlag(bool flag) { error_flag_ = flag; }
     static bool getErrorFlag() { return error_flag_; }
 
 private:
-    void addToken(const std::string& name, TokenRecordPtr&& record);
-    void getNextChar();
-    char peekChar();
-    void addToBuffer(char c);
-    void popBuffer();
-    void skipWhitespace();
+    void init();
     void errorReport(const std::string& message);
+    void makeToken(TokenType token_type, TokenValue token_value, int symbol_precedence);
+    void makeToken(const TokenRecord& record) {
+        makeToken(record.token_type, record.token_value, record.symbol_precedence);
+    }
+    void acceptToken(State state);
 
-    void makeToken(TokenType token_type, 
-                   TokenValue token_value, 
-                   TokenLocation token_location,
-                   int symbol_precedence, 
-                   const std::string& name);
-
-    void makeToken(TokenType token_type, 
-                   TokenValue token_value, 
-                   TokenLocation token_location,
-                   int symbol_precedence, 
-                   const std::string& name, 
-                   const std::string& string_value);
-
-    void makeToken(TokenType token_type, 
-                   TokenValue token_value, 
-                   TokenLocation token_location,
-                   int symbol_precedence, 
-                   const std::string& name, 
-                   int64_t int_value);
-
-    void handleStartState();
-    void handleCommentState();
-    void handleNumberState();
-    void handleIdentifierState();
-    void handleAssignState();
-    void handleOperatorState();
-    void handEndOfFileState();
+    void beginToken() { token_start_ = current_; }
 
-    void updateTokenLocation() { 
-        location_ = TokenLocation(file_name_, line_, column_); 
+    TokenLocation tokenLocation() const {
+        return TokenLocation(file_id_, static_cast<uint32_t>(token_start_ - source_->data()));
     }
 
 private:
-    typedef std::unordered_map<std::string, TokenRecordPtr> Map;
-
-    std::string file_name_;
-    std::ifstream input_;
-    int line_;
-    int column_;
-    TokenLocation location_;
-    char current_char_;
-    State state_;
+    std::shared_ptr<const SourceBuffer> source_;
+    uint32_t file_id_;
+    const char* current_;
+    const char* end_;
+    const char* token_start_;
     Token token_;
-    Map map_;
-    std::string buffer_;
+    SymbolTable* symbol_table_;
+    int token_symbol_;
 
     static bool error_flag_;
 };
@@ -0,0 +1,255 @@
+#include "simplifier.h"
+
+#include <stdint.h>
+
+#include <limits>
+
+namespace nova {
+
+namespace {
+
+const int64_t kIntMin = std::numeric_limits<int32_t>::min();
+const int64_t kIntMax = std::numeric_limits<int32_t>::max();
+
+// The value of a constant the TM machine holds as it is, larger ones are
+// left to the VM's loader.
+bool constantValue(AstPtr node, int64_t* value) {
+    if (node->getAstType() != AstType::kConstant) {
+        return false;
+    }
+    int64_t constant = static_cast<ConstantAstPtr>(node)->intValue();
+    if (constant < kIntMin || constant > kIntMax) {
+        return false;
+    }
+    *value = constant;
+    return true;
+}
+
+// value modulo 2^32, as a TM register holds it
+int64_t wrap(int64_t value) {
+    return static_cast<int32_t>(static_cast<uint32_t>(value));
+}
+
+// left op right as the code generated for it computes it, false for the
+// divisions that trap and for -2^31, which LDC can not load
+bool evaluate(TokenValue op, int64_t left, int64_t right, int64_t* value) {
+    switch (op) {
+        case TokenValue::kPlus:
+            *value = wrap(left + right);
+            break;
+
+        case TokenValue::kMinus:
+            *value = wrap(left - right);
+            break;
+
+        case TokenValue::kMultiply:
+            *value = wrap(left * right);
+            break;
+
+        case TokenValue::kDivide:
+            if (right == 0 || (left == kIntMin && right == -1)) {
+                return false;
+            }
+            *value = left / right;
+            break;
+
+        case TokenValue::kLess:
+            *value = wrap(left - right) < 0 ? 1 : 0;
+            break;
+
+        case TokenValue::kEqual:
+            *value = left == right ? 1 : 0;
+            break;
+
+        default:
+            return false;
+    }
+    return *value != kIntMin;
+}
+
+// Same variables, constants and operators. Expressions have no side
+// effects, so within one expression they have the same value.
+bool sameValue(AstPtr a, AstPtr b) {
+    if (a == nullptr || b == nullptr || a->getAstType() != b->getAstType()) {
+        return false;
+    }
+    switch (a->getAstType()) {
+        case AstType::kVariable:
+            return static_cast<VariableAstPtr>(a)->slot() == static_cast<VariableAstPtr>(b)->slot();
+
+        case AstType::kConstant:
+            return static_cast<ConstantAstPtr>(a)->intValue() == static_cast<ConstantAstPtr>(b)->intValue();
+
+        case AstType::kExpression: {
+            ExpressionAstPtr left = static_cast<ExpressionAstPtr>(a);
+            ExpressionAstPtr right = static_cast<ExpressionAstPtr>(b);
+            return left->operatorTokenValue() == right->operatorTokenValue() &&
+                   sameValue(left->leftPart(), right->leftPart()) &&
+                   sameValue(left->rightPart(), right->rightPart());
+        }
+
+        default:
+            return false;
+    }
+}
+
+bool isInteger(AstPtr node) {
+    return node->getExpressionType() == ExpressionType::kInteger;
+}
+
+// the constant right operand of an inner + or - (or * if op is *) the
+// chain of node can be folded into
+ExpressionAstPtr chainLink(AstPtr node, TokenValue op, int64_t* value) {
+    if (node->getAstType() != AstType::kExpression) {
+        return nullptr;
+    }
+    ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+    TokenValue inner_op = ptr->operatorTokenValue();
+    bool linked = op == TokenValue::kMultiply
+                  ? inner_op == TokenValue::kMultiply
+                  : inner_op == TokenValue::kPlus || inner_op == TokenValue::kMinus;
+    return linked && constantValue(ptr->rightPart(), value) ? ptr : nullptr;
+}
+
+StringPiece operatorName(TokenValue op) {
+    switch (op) {
+        case TokenValue::kPlus:
+            return "+";
+
+        case TokenValue::kMinus:
+            return "-";
+
+        default:
+            return "*";
+    }
+}
+
+} // namespace
+
+bool canTrap(AstPtr node) {
+    if (node == nullptr || node->getAstType() != AstType::kExpression) {
+        return false;
+    }
+    ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+    int64_t divisor = 0;
+    if (ptr->operatorTokenValue() == TokenValue::kDivide &&
+        (!constantValue(ptr->rightPart(), &divisor) || divisor == 0 || divisor == -1)) {
+        return true;
+    }
+    return canTrap(ptr->leftPart()) || canTrap(ptr->rightPart());
+}
+
+AstPtr Simplifier::simplify(AstPtr node) {
+    if (node == nullptr || node->getAstType() != AstType::kExpression) {
+        return node;
+    }
+    ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+    if (ptr->leftPart() == nullptr || ptr->rightPart() == nullptr) {
+        return node;
+    }
+    ptr->setLeftPart(simplify(ptr->leftPart()));
+    ptr->setRightPart(simplify(ptr->rightPart()));
+    if (!isInteger(ptr->leftPart()) || !isInteger(ptr->rightPart())) {
+        return node;
+    }
+    AstPtr simplified = simplifyBinary(ptr);
+    if (simplified != node) {
+        ++rewrites_;
+    }
+    return simplified;
+}
+
+// node's operands are simplified already
+AstPtr Simplifier::simplifyBinary(ExpressionAstPtr node) {
+    TokenValue op = node->operatorTokenValue();
+    AstPtr left = node->leftPart();
+    AstPtr right = node->rightPart();
+    int64_t left_value = 0;
+    int64_t right_value = 0;
+    bool left_constant = constantValue(left, &left_value);
+    bool right_constant = constantValue(right, &right_value);
+
+    if (left_constant && right_constant) {
+        int64_t value = 0;
+        return evaluate(op, left_value, right_value, &value) ? makeConstant(node, value) : node;
+    }
+    // x - x, x < x and x = x are constants unless x traps
+    if ((op == TokenValue::kMinus || op == TokenValue::kLess || op == TokenValue::kEqual) &&
+        sameValue(left, right) && !canTrap(left)) {
+        int64_t value = 0;
+        evaluate(op, 0, 0, &value);
+        return makeConstant(node, value);
+    }
+    // the constant goes to the right of + and *, where the rules below look for it
+    if (left_constant && (op == TokenValue::kPlus || op == TokenValue::kMultiply)) {
+        node->setLeftPart(right);
+        node->setRightPart(left);
+        left = right;
+        right_value = left_value;
+        right_constant = true;
+    }
+    if (!right_constant) {
+        return node;
+    }
+
+    int64_t inner_value = 0;
+    ExpressionAstPtr inner = chainLink(left, op, &inner_value);
+    switch (op) {
+        case TokenValue::kPlus:
+        case TokenValue::kMinus: {
+            if (right_value == 0) {
+                return left;
+            }
+            if (inner == nullptr) {
+                return node;
+            }
+            // (x + c1) - c2 is x + (c1 - c2), in 32 bits as well
+            int64_t offset = 0;
+            if (!evaluate(op, inner->operatorTokenValue() == TokenValue::kPlus ? inner_value : -inner_value,
+                          right_value, &offset)) {
+                return node;
+            }
+            if (offset < 0) {
+                return reassociate(node, inner->leftPart(), TokenValue::kMinus, -offset);
+            }
+            return reassociate(node, inner->leftPart(), TokenValue::kPlus, offset);
+        }
+
+        case TokenValue::kMultiply:
+            if (right_value == 1) {
+                return left;
+            }
+            if (right_value == 0 && !canTrap(left)) {
+                return makeConstant(node, 0);
+            }
+            if (inner == nullptr) {
+                return node;
+            }
+            if (!evaluate(TokenValue::kMultiply, inner_value, right_value, &inner_value)) {
+                return node;
+            }
+            return reassociate(node, inner->leftPart(), TokenValue::kMultiply, inner_value);
+
+        case TokenValue::kDivide:
+            return right_value == 1 ? left : node;
+
+        default:
+            return node;
+    }
+}
+
+// left op value in place of node, simplified again since value may be 0 or 1
+AstPtr Simplifier::reassociate(ExpressionAstPtr node, AstPtr left, TokenValue op, int64_t value) {
+    ExpressionAstPtr ptr = context_.make<ExpressionAst>(node->getTokenLocation(), AstType::kExpression,
+                                                        operatorName(op), op, left, makeConstant(node, value));
+    ptr->setExpressionType(node->getExpressionType());
+    return simplifyBinary(ptr);
+}
+
+AstPtr Simplifier::makeConstant(AstPtr node, int64_t value) {
+    ConstantAstPtr ptr = context_.make<ConstantAst>(node->getTokenLocation(), AstType::kConstant, value);
+    ptr->setExpressionType(node->getExpressionType());
+    return ptr;
+}
+
+} // namespace nova
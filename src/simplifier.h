@@ -0,0 +1,55 @@
+#ifndef __NOVA_SIMPLIFIER_H__
+#define __NOVA_SIMPLIFIER_H__
+
+#include "ast.h"
+#include "ast_visitor.h"
+
+namespace nova {
+
+// Simplifies the expressions of a typed AST before code generation: folds
+// constant subexpressions, drops the identities x+0, x-0, x*1 and x/1,
+// turns x*0 and x-x into 0, x<x and x=x into false and true, and
+// reassociates constant chains such as (x + 1) + 2 into x + 3.
+//
+// Values are those the TM machine computes, 32-bit integers wrapping around
+// on overflow, and a < b is the sign of a - b. A division that would trap
+// is never folded, and x*0 and x-x are kept when x contains one, so a
+// program traps exactly when it did before.
+//
+// An analysis pass: it rides along in Analysis::analyze() after the type
+// checker and rewrites the expressions of each statement, making the new
+// nodes in context.
+class Simplifier : public AstVisitor<Simplifier> {
+public:
+    explicit Simplifier(AstContext& context)
+        : context_(context),
+          rewrites_(0) {
+    }
+
+    void visitIf(IfStatementAstPtr node) { node->setTestPart(simplify(node->testPart())); }
+    void visitRepeat(RepeatStatementAstPtr node) { node->setTestPart(simplify(node->testPart())); }
+    void visitAssign(AssignStatementAstPtr node) { node->setExpression(simplify(node->expression())); }
+    void visitWrite(WriteStatementAstPtr node) { node->setExpression(simplify(node->expression())); }
+
+    // the simplified expression, node itself when nothing applies
+    AstPtr simplify(AstPtr node);
+    // expressions folded or rewritten so far
+    size_t rewrites() const { return rewrites_; }
+
+private:
+    AstPtr simplifyBinary(ExpressionAstPtr node);
+    AstPtr reassociate(ExpressionAstPtr node, AstPtr left, TokenValue op, int64_t value);
+    AstPtr makeConstant(AstPtr node, int64_t value);
+
+private:
+    AstContext& context_;
+    size_t rewrites_;
+};
+
+// true if evaluating the expression may trap, that is it divides by
+// anything but a constant other than 0 and -1
+bool canTrap(AstPtr node);
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,131 @@
+#include "source_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace nova {
+
+namespace {
+
+const size_t kReadBlockSize = 1 << 16;
+
+} // namespace
+
+SourceBuffer::SourceBuffer(const std::string& file_name)
+    : name_(file_name == "-" ? "<stdin>" : file_name),
+      data_(""),
+      size_(0),
+      mapping_(nullptr),
+      opened_(false) {
+    bool standard_input = file_name == "-";
+    int fd = standard_input ? STDIN_FILENO : ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (!standard_input || ::lseek(fd, 0, SEEK_CUR) == 0)) {
+        if (st.st_size == 0) {
+            opened_ = true;  // mmap refuses empty files
+        } else {
+            void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                ::madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+                mapping_ = p;
+                data_ = static_cast<const char*>(p);
+                size_ = static_cast<size_t>(st.st_size);
+                opened_ = true;
+            }
+        }
+    } else if (standard_input) {
+        opened_ = readAll(fd);  // a pipe or terminal
+    }
+    if (!standard_input) {
+        ::close(fd);
+    }
+}
+
+SourceBuffer::SourceBuffer(const std::string& name, const char* data, size_t size)
+    : name_(name),
+      data_(data),
+      size_(size),
+      mapping_(nullptr),
+      opened_(true) {
+}
+
+SourceBuffer::SourceBuffer(const std::string& name, std::string&& text)
+    : name_(name),
+      text_(std::move(text)),
+      mapping_(nullptr),
+      opened_(true) {
+    useText();
+}
+
+SourceBuffer::SourceBuffer(const std::string& name, std::istream& is)
+    : name_(name),
+      mapping_(nullptr),
+      opened_(false) {
+    char block[kReadBlockSize];
+    while (is.read(block, sizeof(block)) || is.gcount() > 0) {
+        text_.append(block, static_cast<size_t>(is.gcount()));
+    }
+    opened_ = !is.bad();
+    useText();
+}
+
+SourceBuffer::~SourceBuffer() {
+    if (mapping_ != nullptr) {
+        ::munmap(mapping_, size_);
+    }
+}
+    
+bool SourceBuffer::readAll(int fd) {
+    char block[kReadBlockSize];
+    for (;;) {
+        ssize_t count = ::read(fd, block, sizeof(block));
+        if (count == 0) {
+            break;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        text_.append(block, static_cast<size_t>(count));
+    }
+    useText();
+    return true;
+}
+
+const std::vector<uint32_t>& SourceBuffer::lineStarts() const {
+    std::call_once(indexed_, [this] {
+        const char* end = data_ + size_;
+        line_starts_.push_back(0);
+        for (const char* p = data_;
+             (p = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)))) != nullptr;
+             ++p) {
+            line_starts_.push_back(static_cast<uint32_t>(p + 1 - data_));
+        }
+    });
+    return line_starts_;
+}
+
+void SourceBuffer::position(uint32_t offset, int* line, int* column) const {
+    const std::vector<uint32_t>& starts = lineStarts();
+    std::vector<uint32_t>::const_iterator it = std::upper_bound(starts.begin(), starts.end(), offset);
+    *line = static_cast<int>(it - starts.begin());
+    *column = static_cast<int>(offset - *(it - 1)) + 1;
+}
+
+void SourceBuffer::useText() {
+    data_ = text_.data();
+    size_ = text_.size();
+}
+
+} // namespace nova
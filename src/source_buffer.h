@@ -0,0 +1,61 @@
+#ifndef __NOVA_SOURCE_BUFFER_H__
+#define __NOVA_SOURCE_BUFFER_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <istream>
+#include <mutex>
+#include <vector>
+
+#include "string_piece.h"
+
+namespace nova {
+
+// Contiguous source text: a read-only mapping of a file, a view of memory
+// owned by the caller, or text owned by the buffer.
+class SourceBuffer {
+public:
+    // maps file_name, "-" for standard input which is read when it is not a
+    // regular file; check isOpened()
+    explicit SourceBuffer(const std::string& file_name);
+    // borrows data, which must outlive the buffer and everything scanned from it
+    SourceBuffer(const std::string& name, const char* data, size_t size);
+    // takes over text, without a copy when it is moved in
+    SourceBuffer(const std::string& name, std::string&& text);
+    // reads is to the end
+    SourceBuffer(const std::string& name, std::istream& is);
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    bool isOpened() const { return opened_; }
+    const std::string& name() const { return name_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    StringPiece text() const { return StringPiece(data_, size_); }
+    // the offsets at which the lines start, indexed the first time they are
+    // asked for and not changed after, so they are read without a lock
+    const std::vector<uint32_t>& lineStarts() const;
+    // 1-based line and column of offset
+    void position(uint32_t offset, int* line, int* column) const;
+
+private:
+    bool readAll(int fd);
+    void useText();
+
+private:
+    std::string name_;
+    std::string text_;
+    const char* data_;
+    size_t size_;
+    void* mapping_;
+    bool opened_;
+    mutable std::once_flag indexed_;
+    mutable std::vector<uint32_t> line_starts_;
+};
+    
+} // namespace nova
+
+#endif
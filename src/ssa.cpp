@@ -0,0 +1,451 @@
+#include "ssa.h"
+
+#include "dominators.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+size_t index(int id) {
+    return static_cast<size_t>(id);
+}
+
+// value -> the value it was replaced by, kNoValue for none
+class Replacements {
+public:
+    explicit Replacements(int value_count)
+        : map_(index(value_count), kNoValue) {
+    }
+
+    void replace(ValueId value, ValueId by) {
+        if (index(value) >= map_.size()) {
+            map_.resize(index(value) + 1, kNoValue);
+        }
+        map_[index(value)] = by;
+    }
+
+    ValueId resolve(ValueId value) const {
+        while (index(value) < map_.size() && map_[index(value)] != kNoValue) {
+            value = map_[index(value)];
+        }
+        return value;
+    }
+
+    void apply(Function& function) const {
+        for (BlockId id : function.layout()) {
+            BasicBlock& b = function.block(id);
+            for (Phi& phi : b.phis) {
+                for (ValueId& operand : phi.operands) {
+                    operand = resolve(operand);
+                }
+            }
+            for (Instruction& ins : b.instructions) {
+                for (int i = 0; i < operandCount(ins.op); ++i) {
+                    ins.operands[i] = resolve(ins.operands[i]);
+                }
+            }
+            if (b.terminator.kind == TerminatorKind::kBranch) {
+                b.terminator.condition = resolve(b.terminator.condition);
+            }
+        }
+    }
+
+private:
+    std::vector<ValueId> map_;
+};
+
+void placePhis(Function& function, const DominatorTree& dominators) {
+    size_t variable_count = index(function.variableCount());
+    std::vector<std::vector<BlockId>> definitions(variable_count);
+    std::vector<bool> exposed(variable_count, false);
+    std::vector<BlockId> defined_in(variable_count, kNoBlock);
+    for (BlockId id : function.layout()) {
+        for (const Instruction& ins : function.block(id).instructions) {
+            size_t variable = index(ins.variable);
+            if (ins.op == Opcode::kLoad) {
+                exposed[variable] = exposed[variable] || defined_in[variable] != id;
+            } else if (definesVariable(ins) && defined_in[variable] != id) {
+                defined_in[variable] = id;
+                definitions[variable].push_back(id);
+            }
+        }
+    }
+
+    std::vector<std::vector<BlockId>> frontiers = dominators.frontiers();
+    std::vector<int> has_phi(index(function.blockCount()), -1);  // by block, the last variable given one
+    std::vector<int> queued(index(function.blockCount()), -1);
+    for (int variable = 0; variable < function.variableCount(); ++variable) {
+        if (!exposed[index(variable)]) {
+            continue;
+        }
+        std::vector<BlockId> worklist = definitions[index(variable)];
+        for (BlockId id : worklist) {
+            queued[index(id)] = variable;
+        }
+        while (!worklist.empty()) {
+            BlockId id = worklist.back();
+            worklist.pop_back();
+            for (BlockId frontier : frontiers[index(id)]) {
+                if (has_phi[index(frontier)] == variable) {
+                    continue;
+                }
+                has_phi[index(frontier)] = variable;
+                BasicBlock& b = function.block(frontier);
+                b.phis.push_back(Phi(function.newValue(), variable));
+                b.phis.back().operands.resize(b.predecessors.size(), kNoValue);
+                if (queued[index(frontier)] != variable) {
+                    queued[index(frontier)] = variable;
+                    worklist.push_back(frontier);
+                }
+            }
+        }
+    }
+}
+
+void rename(Function& function, const DominatorTree& dominators, Replacements& replacements) {
+    std::vector<std::vector<ValueId>> versions(index(function.variableCount()));
+    std::vector<ValueId> initials(index(function.variableCount()), kNoValue);
+    std::vector<Instruction> initial_instructions;
+    auto current = [&](int variable) {
+        const std::vector<ValueId>& stack = versions[index(variable)];
+        if (!stack.empty()) {
+            return stack.back();
+        }
+        ValueId& initial = initials[index(variable)];
+        if (initial == kNoValue) {
+            initial = function.newValue();
+            initial_instructions.push_back(Instruction(Opcode::kInitial, initial, 0));
+            initial_instructions.back().variable = variable;
+        }
+        return initial;
+    };
+
+    // the variables pushed by the blocks on the walk, popped when leaving them
+    std::vector<int> pushed;
+    struct Frame {
+        BlockId block;
+        size_t child;
+        size_t pushed;
+    };
+    std::vector<Frame> walk;
+    walk.push_back(Frame{function.entry(), 0, 0});
+    bool entering = true;
+    while (!walk.empty()) {
+        Frame& frame = walk.back();
+        if (entering) {
+            frame.pushed = pushed.size();
+            BasicBlock& b = function.block(frame.block);
+            for (const Phi& phi : b.phis) {
+                versions[index(phi.variable)].push_back(phi.result);
+                pushed.push_back(phi.variable);
+            }
+            size_t kept = 0;
+            for (size_t i = 0; i < b.instructions.size(); ++i) {
+                Instruction& ins = b.instructions[i];
+                if (ins.op == Opcode::kLoad) {
+                    replacements.replace(ins.result, current(ins.variable));
+                    continue;
+                }
+                for (int j = 0; j < operandCount(ins.op); ++j) {
+                    ins.operands[j] = replacements.resolve(ins.operands[j]);
+                }
+                if (definesVariable(ins)) {
+                    versions[index(ins.variable)].push_back(ins.result);
+                    pushed.push_back(ins.variable);
+                }
+                b.instructions[kept++] = ins;
+            }
+            b.instructions.resize(kept, Instruction(Opcode::kConstant, kNoValue, 0));
+            Terminator& terminator = b.terminator;
+            if (terminator.kind == TerminatorKind::kBranch) {
+                terminator.condition = replacements.resolve(terminator.condition);
+            }
+            for (int i = 0; i < terminator.successorCount(); ++i) {
+                if (i > 0 && terminator.targets[i] == terminator.targets[0]) {
+                    continue;
+                }
+                BasicBlock& successor = function.block(terminator.targets[i]);
+                for (size_t j = 0; j < successor.predecessors.size(); ++j) {
+                    if (successor.predecessors[j] != frame.block) {
+                        continue;
+                    }
+                    for (Phi& phi : successor.phis) {
+                        phi.operands[j] = current(phi.variable);
+                    }
+                }
+            }
+        }
+
+        const std::vector<BlockId>& children = dominators.children(frame.block);
+        if (frame.child < children.size()) {
+            BlockId child = children[frame.child++];
+            walk.push_back(Frame{child, 0, 0});
+            entering = true;
+            continue;
+        }
+        while (pushed.size() > frame.pushed) {
+            versions[index(pushed.back())].pop_back();
+            pushed.pop_back();
+        }
+        walk.pop_back();
+        entering = false;
+    }
+
+    std::vector<Instruction>& entry = function.block(function.entry()).instructions;
+    entry.insert(entry.begin(), initial_instructions.begin(), initial_instructions.end());
+}
+
+// Removes the phis whose operands are all one value or the phi itself,
+// repeatedly as removing one may make another trivial, then the phis no
+// instruction or terminator needs.
+void removeUselessPhis(Function& function, Replacements& replacements) {
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (BlockId id : function.layout()) {
+            std::vector<Phi>& phis = function.block(id).phis;
+            size_t kept = 0;
+            for (size_t i = 0; i < phis.size(); ++i) {
+                ValueId same = kNoValue;
+                bool trivial = true;
+                for (ValueId operand : phis[i].operands) {
+                    operand = replacements.resolve(operand);
+                    if (operand == phis[i].result || operand == same) {
+                        continue;
+                    }
+                    if (same != kNoValue) {
+                        trivial = false;
+                        break;
+                    }
+                    same = operand;
+                }
+                if (trivial && same != kNoValue) {
+                    replacements.replace(phis[i].result, same);
+                    changed = true;
+                    continue;
+                }
+                phis[kept++] = phis[i];
+            }
+            phis.resize(kept, Phi(kNoValue, -1));
+        }
+    }
+    replacements.apply(function);
+
+    // phis by result, the live ones found from the other uses
+    std::vector<const Phi*> phi_of(index(function.valueCount()), nullptr);
+    for (BlockId id : function.layout()) {
+        for (const Phi& phi : function.block(id).phis) {
+            phi_of[index(phi.result)] = &phi;
+        }
+    }
+    std::vector<bool> live(index(function.valueCount()), false);
+    std::vector<ValueId> worklist;
+    auto use = [&](ValueId value) {
+        if (phi_of[index(value)] != nullptr && !live[index(value)]) {
+            live[index(value)] = true;
+            worklist.push_back(value);
+        }
+    };
+    for (BlockId id : function.layout()) {
+        const BasicBlock& b = function.block(id);
+        for (const Instruction& ins : b.instructions) {
+            for (int i = 0; i < operandCount(ins.op); ++i) {
+                use(ins.operands[i]);
+            }
+        }
+        if (b.terminator.kind == TerminatorKind::kBranch) {
+            use(b.terminator.condition);
+        }
+    }
+    while (!worklist.empty()) {
+        const Phi* phi = phi_of[index(worklist.back())];
+        worklist.pop_back();
+        for (ValueId operand : phi->operands) {
+            use(operand);
+        }
+    }
+    for (BlockId id : function.layout()) {
+        std::vector<Phi>& phis = function.block(id).phis;
+        size_t kept = 0;
+        for (size_t i = 0; i < phis.size(); ++i) {
+            if (live[index(phis[i].result)]) {
+                phis[kept++] = phis[i];
+            }
+        }
+        phis.resize(kept, Phi(kNoValue, -1));
+    }
+}
+
+// Drops the kInitial of the variables whose only reads went to dead phis.
+void removeUnusedInitials(Function& function) {
+    std::vector<bool> used(index(function.valueCount()), false);
+    for (BlockId id : function.layout()) {
+        const BasicBlock& b = function.block(id);
+        for (const Phi& phi : b.phis) {
+            for (ValueId operand : phi.operands) {
+                used[index(operand)] = true;
+            }
+        }
+        for (const Instruction& ins : b.instructions) {
+            for (int i = 0; i < operandCount(ins.op); ++i) {
+                used[index(ins.operands[i])] = true;
+            }
+        }
+        if (b.terminator.kind == TerminatorKind::kBranch) {
+            used[index(b.terminator.condition)] = true;
+        }
+    }
+    std::vector<Instruction>& entry = function.block(function.entry()).instructions;
+    entry.erase(std::remove_if(entry.begin(), entry.end(), [&used](const Instruction& ins) {
+        return ins.op == Opcode::kInitial && !used[index(ins.result)];
+    }), entry.end());
+}
+
+// The variable whose memory slot each value lives in, -1 for temporaries.
+std::vector<int> valueVariables(const Function& function) {
+    std::vector<int> variables(index(function.valueCount()), -1);
+    for (BlockId id : function.layout()) {
+        const BasicBlock& b = function.block(id);
+        for (const Phi& phi : b.phis) {
+            variables[index(phi.result)] = phi.variable;
+        }
+        for (const Instruction& ins : b.instructions) {
+            if (definesVariable(ins)) {
+                variables[index(ins.result)] = ins.variable;
+            }
+        }
+    }
+    return variables;
+}
+
+struct Copy {
+    ValueId destination;
+    ValueId source;
+    int variable;
+};
+
+// Orders the parallel copies, which have distinct destinations, into
+// instructions appended to b. Locations are the variable slots and the
+// temporaries, a copy is ready once no other pending copy reads its
+// destination.
+void sequentialize(Function& function, std::vector<Copy> copies, const std::vector<int>& variables,
+                   BasicBlock& b) {
+    auto location = [&](ValueId value) {
+        int variable = index(value) < variables.size() ? variables[index(value)] : -1;
+        return variable >= 0 ? variable : function.variableCount() + value;
+    };
+    auto emit = [&b](ValueId destination, ValueId source, int variable) {
+        b.instructions.push_back(Instruction(Opcode::kCopy, destination, 0));
+        b.instructions.back().operands[0] = source;
+        b.instructions.back().variable = variable;
+    };
+
+    while (!copies.empty()) {
+        bool progress = false;
+        for (size_t i = 0; i < copies.size(); ++i) {
+            int destination = location(copies[i].destination);
+            bool read = false;
+            for (size_t j = 0; j < copies.size() && !read; ++j) {
+                read = j != i && location(copies[j].source) == destination;
+            }
+            if (!read) {
+                emit(copies[i].destination, copies[i].source, copies[i].variable);
+                copies.erase(copies.begin() + static_cast<std::ptrdiff_t>(i));
+                progress = true;
+                break;
+            }
+        }
+        if (progress) {
+            continue;
+        }
+        // every destination is still read, save one source aside
+        ValueId source = copies.front().source;
+        ValueId saved = function.newValue();
+        emit(saved, source, -1);
+        for (Copy& copy : copies) {
+            if (location(copy.source) == location(source)) {
+                copy.source = saved;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void constructSsa(Function& function) {
+    function.removeUnreachableBlocks();
+    DominatorTree dominators(function);
+    placePhis(function, dominators);
+    Replacements replacements(function.valueCount());
+    rename(function, dominators, replacements);
+    removeUselessPhis(function, replacements);
+    removeUnusedInitials(function);
+    function.setSsa(true);
+}
+
+void destructSsa(Function& function) {
+    std::vector<int> variables = valueVariables(function);
+    std::vector<BlockId> layout = function.layout();
+    for (BlockId id : layout) {
+        if (function.block(id).phis.empty()) {
+            continue;
+        }
+        size_t predecessor_count = function.block(id).predecessors.size();
+        for (size_t i = 0; i < predecessor_count; ++i) {
+            std::vector<Copy> copies;
+            std::vector<Copy> moves_nothing;
+            for (const Phi& phi : function.block(id).phis) {
+                ValueId source = phi.operands[i];
+                int source_variable = index(source) < variables.size() ? variables[index(source)] : -1;
+                Copy copy{phi.result, source, phi.variable};
+                if (source == phi.result || (phi.variable >= 0 && source_variable == phi.variable)) {
+                    moves_nothing.push_back(copy);
+                } else {
+                    copies.push_back(copy);
+                }
+            }
+
+            BlockId pred = function.block(id).predecessors[i];
+            BlockId target = pred;
+            if (!copies.empty() && function.block(pred).terminator.successorCount() > 1) {
+                // the edge is critical, id having a phi has several predecessors
+                int occurrence = 0;
+                for (size_t j = 0; j < i; ++j) {
+                    occurrence += function.block(id).predecessors[j] == pred ? 1 : 0;
+                }
+                target = function.insertBlockAfter(pred);
+                Terminator& terminator = function.block(pred).terminator;
+                for (int k = 0; k < terminator.successorCount(); ++k) {
+                    if (terminator.targets[k] == id && occurrence-- == 0) {
+                        terminator.targets[k] = target;
+                        break;
+                    }
+                }
+                BasicBlock& split = function.block(target);
+                split.terminator.kind = TerminatorKind::kJump;
+                split.terminator.targets[0] = id;
+                split.terminator.line = terminator.line;
+                split.predecessors.push_back(pred);
+                function.block(id).predecessors[i] = target;
+            }
+            sequentialize(function, copies, variables, function.block(target));
+            for (const Copy& copy : moves_nothing) {
+                BasicBlock& b = function.block(target);
+                b.instructions.push_back(Instruction(Opcode::kCopy, copy.destination, 0));
+                b.instructions.back().operands[0] = copy.source;
+                b.instructions.back().variable = copy.variable;
+            }
+        }
+        function.block(id).phis.clear();
+    }
+    function.setSsa(false);
+}
+
+} // namespace ir
+
+} // namespace nova
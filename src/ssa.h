@@ -0,0 +1,32 @@
+#ifndef __NOVA_SSA_H__
+#define __NOVA_SSA_H__
+
+#include "ir.h"
+
+namespace nova {
+
+namespace ir {
+
+// Puts a function built by IrBuilder into SSA form, after Cytron et al.
+// Unreachable blocks are dropped first. A variable gets phis at the
+// iterated dominance frontier of its definitions only when some block
+// reads it before defining it, the loads are then replaced by the reaching
+// versions in a walk over the dominator tree. A variable read before any
+// assignment gets a kInitial at the start of the entry. Phis left unused
+// or with a single distinct operand are removed at the end. The entry must
+// have no predecessors.
+void constructSsa(Function& function);
+
+// Replaces the phis by copies at the end of their predecessors, splitting
+// the critical edges that need any. A copy between two versions of one
+// variable needs no code and is left out, so a function fresh from
+// constructSsa() gets no copies and no new blocks at all. The copies on an
+// edge are a parallel assignment, they are ordered so that no source is
+// overwritten before it is read, going through a new temporary on a cycle.
+void destructSsa(Function& function);
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef __NOVA_STRING_PIECE_H__
+#define __NOVA_STRING_PIECE_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <ostream>
+
+namespace nova {
+
+// A non-owning view of a contiguous character range. The referenced memory
+// must outlive the piece.
+class StringPiece {
+public:
+    StringPiece()
+        : data_(nullptr), 
+          size_(0) {
+    }
+
+    StringPiece(const char* str)
+        : data_(str), 
+          size_(strlen(str)) {
+    }
+
+    StringPiece(const char* str, size_t len)
+        : data_(str), 
+          size_(len) {
+    }
+
+    StringPiece(const std::string& str)
+        : data_(str.data()), 
+          size_(str.size()) {
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    char operator[](size_t i) const { return data_[i]; }
+
+    std::string as_string() const { return std::string(data_, size_); }
+
+    bool operator==(const StringPiece& rhs) const {
+        return size_ == rhs.size_ && (size_ == 0 || memcmp(data_, rhs.data_, size_) == 0);
+    }
+
+    bool operator!=(const StringPiece& rhs) const {
+        return !(*this == rhs);
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const StringPiece& piece) {
+    return os.write(piece.data(), static_cast<std::streamsize>(piece.size()));
+}
+
+inline std::string operator+(const std::string& lhs, const StringPiece& rhs) {
+    std::string result(lhs);
+    result.append(rhs.data(), rhs.size());
+    return result;
+}
+
+// FNV-1a over the bytes, for hash containers keyed on short names
+struct StringPieceHash {
+    size_t operator()(const StringPiece& piece) const {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : piece) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+    
+} // namespace nova
+
+#endif
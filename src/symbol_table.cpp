@@ -4,28 +4,42 @@
 
 namespace nova {
 
-bool SymbolTable::insert(const std::string& name, const TokenLocation& location) {
-    bool result = innerInsert(name, location);
-    if (result) {
-        ++current_index_;   
+int SymbolTable::intern(StringPiece name, const TokenLocation& location) {
+    std::pair<HashMap::iterator, bool> result = slots_.insert(std::make_pair(name, size()));
+    int slot = result.first->second;
+    if (result.second) {
+        records_.push_back(SymbolRecord(name, slot));
     }
-    return result;
+    if (record_locations_) {
+        records_[static_cast<size_t>(slot)].location.push_back(location);
+    }
+    return slot;
 }
 
-bool SymbolTable::innerInsert(const std::string& name, const TokenLocation& location) {
-    if (hash_map_.find(name) != hash_map_.end()) {
-        hash_map_[name]->location.push_back(std::make_pair(location.line(), location.column()));
-        return false;
-    } else {
-        hash_map_[name] = makeSymbolRecord(name, current_index_, location.line(), location.column());
-        return true;
+std::vector<int> SymbolTable::merge(SymbolTable&& other) {
+    std::vector<int> slot_map;
+    slot_map.reserve(other.records_.size());
+    for (SymbolRecord& other_record : other.records_) {
+        std::pair<HashMap::iterator, bool> result = slots_.insert(std::make_pair(other_record.name, size()));
+        int slot = result.first->second;
+        if (result.second) {
+            records_.push_back(SymbolRecord(other_record.name, slot));
+        }
+        if (record_locations_) {
+            std::vector<TokenLocation>& location = records_[static_cast<size_t>(slot)].location;
+            location.insert(location.end(), other_record.location.begin(), other_record.location.end());
+        }
+        slot_map.push_back(slot);
     }
+    other.slots_.clear();
+    other.records_.clear();
+    return slot_map;
 }
 
-int SymbolTable::lookup(const std::string& name) const {
-    HashMap::const_iterator it = hash_map_.find(name);
-    if (it != hash_map_.end()) {
-        return it->second->index;   
+int SymbolTable::lookup(StringPiece name) const {
+    HashMap::const_iterator it = slots_.find(name);
+    if (it != slots_.end()) {
+        return it->second;   
     }
     return -1;
 }
@@ -33,10 +47,10 @@ int SymbolTable::lookup(const std::string& name) const {
 void SymbolTable::printSymbolTable() const {
     std::cout << "Symbol Table:" << std::endl;
     std::cout << "Variable Name    index    Line    Number" << std::endl;
-    for (auto& record_pair : hash_map_) {
-        std::cout << record_pair.second->name << "\t" << record_pair.second->index << "\t";
-        for (auto location_pair : record_pair.second->location) {
-            std::cout << location_pair.first << "  " << location_pair.second << "\t";   
+    for (const SymbolRecord& record : records_) {
+        std::cout << record.name << "\t" << record.index << "\t";
+        for (const TokenLocation& location : record.location) {
+            std::cout << location.line() << "  " << location.column() << "\t";   
         }
         std::cout << std::endl;   
     }   
@@ -1,8 +1,6 @@
 #ifndef __NOVA_SYMBOL_TABLE_H__
 #define __NOVA_SYMBOL_TABLE_H__
 
-#include <string>
-#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -11,41 +9,48 @@
 namespace nova {
 
 struct SymbolRecord {
-    SymbolRecord(const std::string& symbol_name, int symbol_index, int symbol_line, int symbol_number)
+    SymbolRecord(StringPiece symbol_name, int symbol_index)
         : name(symbol_name),
           index(symbol_index) {
-        location.push_back(std::make_pair(symbol_line, symbol_number));
     }
 
-    std::string name;
+    StringPiece name;  // a view of the source, kept alive by the FileTable
     int index;
-    std::vector<std::pair<int, int>> location; 
+    std::vector<TokenLocation> location;  // cross-reference mode only
 };
 
-typedef std::unique_ptr<SymbolRecord> SymbolRecordPtr;
-
-inline SymbolRecordPtr makeSymbolRecord(const std::string& name, int index, int line, int column) {
-    return std::make_unique<SymbolRecord>(name, index, line, column);
-}
-
+// Interns variable names into dense slots numbered in order of first
+// occurrence, which are also their memory locations in the TM code. The
+// scanner interns every identifier as it is lexed, so later passes find a
+// variable's slot in its VariableAst and never hash the name again.
 class SymbolTable {
 public:
     SymbolTable()
-        : current_index_(0) {
+        : record_locations_(false) {
     }
 
-    bool insert(const std::string& name, const TokenLocation& location);
-    int lookup(const std::string& name) const;
+    // cross-reference mode: keep the location of every reference for
+    // printSymbolTable, off by default
+    void setRecordLocations(bool record) { record_locations_ = record; }
+    bool recordLocations() const { return record_locations_; }
+
+    // the slot of name, a new one the first time it is seen
+    int intern(StringPiece name, const TokenLocation& location);
+    // Appends the symbols of other as if their references followed the ones
+    // interned so far. Returns the new slot of each slot of other.
+    std::vector<int> merge(SymbolTable&& other);
+    // -1 for unknown names
+    int lookup(StringPiece name) const;
+    int size() const { return static_cast<int>(records_.size()); }
+    const SymbolRecord& record(int slot) const { return records_[static_cast<size_t>(slot)]; }
     void printSymbolTable() const;
 
 private:
-    bool innerInsert(const std::string& name, const TokenLocation& location);
-
-private:
-    typedef std::unordered_map<std::string, SymbolRecordPtr> HashMap;
+    typedef std::unordered_map<StringPiece, int, StringPieceHash> HashMap;
 
-    HashMap hash_map_;
-    int current_index_;
+    HashMap slots_;
+    std::vector<SymbolRecord> records_;  // by slot
+    bool record_locations_;
 };
     
 } // namespace nova
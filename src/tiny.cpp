@@ -1,44 +1,150 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "scanner.h"
-#include "parser.h"
-#include "analysis.h"
-#include "codegen.h"
+#include "compiler.h"
 #include "vm.h"
+#include "metrics.h"
+
+struct Options {
+    Options()
+        : file_name(nullptr),
+          profile(false),
+          sample_frequency(0),
+          trace_entries(0),
+          metrics(false) {
+    }
+
+    const char* file_name;
+    bool profile;
+    std::string profile_file;
+    int sample_frequency;
+    std::string sample_file;
+    size_t trace_entries;
+    bool metrics;
+    std::string metrics_file;
+    std::string emit_file;
+    nova::CompileOptions compile_options;
+};
+
+bool parseOptions(int argc, char* argv[], Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            options->profile = true;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            options->profile = true;
+            options->profile_file = argv[i] + 10;
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            options->sample_frequency = 1000;
+        } else if (strncmp(argv[i], "--sample=", 9) == 0) {
+            options->sample_frequency = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--sample-file=", 14) == 0) {
+            options->sample_file = argv[i] + 14;
+            if (options->sample_frequency == 0) {
+                options->sample_frequency = 1000;
+            }
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            options->trace_entries = 64;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            options->trace_entries = static_cast<size_t>(atoi(argv[i] + 8));
+        } else if (strcmp(argv[i], "--metrics") == 0) {
+            options->metrics = true;
+        } else if (strncmp(argv[i], "--metrics=", 10) == 0) {
+            options->metrics = true;
+            options->metrics_file = argv[i] + 10;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            options->compile_options.stream = true;
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            options->compile_options.jobs = atoi(argv[i] + 7);
+        } else if (strcmp(argv[i], "--no-optimize") == 0) {
+            options->compile_options.optimize = false;
+        } else if (strcmp(argv[i], "--dump-ir") == 0) {
+            options->compile_options.dump_ir = &std::cerr;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options->compile_options.stats = &std::cerr;
+        } else if (strncmp(argv[i], "--emit=", 7) == 0) {
+            options->emit_file = argv[i] + 7;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return false;
+        } else {
+            options->file_name = argv[i];
+        }
+    }
+    return options->file_name != nullptr;
+}
+
+// writes the TM code to file_name instead of running it
+bool emitCode(nova::Scanner& scanner, const Options& options) {
+    std::string tmp_file = options.emit_file + ".tmp";
+    std::ofstream os(tmp_file);
+    if (!os) {
+        std::cerr << "Can not write " << options.emit_file << std::endl;
+        return false;
+    }
+    bool compiled = nova::compile(scanner, options.compile_options, os);
+    os.close();
+    if (!compiled) {
+        unlink(tmp_file.c_str());
+        return false;
+    }
+    if (!os || rename(tmp_file.c_str(), options.emit_file.c_str()) != 0) {
+        std::cerr << "Can not write " << options.emit_file << std::endl;
+        unlink(tmp_file.c_str());
+        return false;
+    }
+    return true;
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Useage: " << argv[0] << " [filename]" << std::endl;
+    Options options;
+    if (!parseOptions(argc, argv, &options)) {
+        std::cerr << "Useage: " << argv[0] << " [--profile[=profile.json]] [--sample[=hz]] [--sample-file=out.folded] [--trace[=n]] [--metrics[=file.prom|file.json]] [--stream] [--jobs=n] [--no-optimize] [--dump-ir] [--stats] [--emit=file.tm] [filename|-]" << std::endl;
         return 0;
     }
-    nova::Scanner scanner(argv[1]);
+    nova::Scanner scanner(options.file_name);
     if (!scanner.isFileOpened()) {
-        std::cerr << "Can not touch the file " << argv[1] << std::endl;
+        std::cerr << "Can not touch the file " << options.file_name << std::endl;
         return 0;
     }
 
-    nova::Parser parser(scanner);
-    nova::AstPtr root = parser.parse();
-    nova::Analysis analysis(root);
-    analysis.buildSymbolTable();
-    analysis.typeCheck();
-    if (nova::Scanner::getErrorFlag() ||
-        nova::Parser::getErrorFlag()) {
-        return 0;      
+    if (!options.emit_file.empty()) {
+        emitCode(scanner, options);
+        return 0;
     }
-    nova::CodeGenerator generator(analysis, root, argv[1], true);
-    nova::CodeBuffer code = generator.generateCode();
-    if (nova::CodeGenerator::getErrorFlag()) {
+    std::ostringstream code;
+    if (!nova::compile(scanner, options.compile_options, code)) {
         return 0;   
     }
 
-    nova::vm::VirtualMachine vm(code);
+    nova::vm::VirtualMachine vm(code.str());
     vm.buildInstructions();
     if (nova::vm::Scanner::getErrorFlag() ||
         nova::vm::VirtualMachine::getErrorFlag()) {
         return 0;   
     }
+    if (options.profile) {
+        vm.enableProfiling(options.profile_file);
+    }
+    if (options.trace_entries > 0) {
+        vm.enableTracing(options.trace_entries);
+    }
+    if (options.metrics) {
+        vm.enableMetrics(options.metrics_file);
+    }
+    if (options.sample_frequency > 0) {
+        vm.enableSampling(options.sample_frequency, options.sample_file);
+    }
     vm.run();
+    if (options.metrics && options.metrics_file.empty()) {
+        nova::vm::writeMetrics(std::cerr, vm.metrics(), nova::vm::MetricsFormat::kPrometheus);
+    }
     return 0;
 }
 
@@ -0,0 +1,64 @@
+#include "tm_code.h"
+
+namespace nova {
+
+size_t nextInstruction(const TmCode& code, size_t index) {
+    while (index < code.size() && code[index].isComment()) {
+        ++index;
+    }
+    return index;
+}
+
+void resolveTargets(TmCode& code) {
+    std::vector<size_t> instructions;  // the index of each pc
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].isComment()) {
+            instructions.push_back(i);
+        }
+    }
+    for (size_t pc = 0; pc < instructions.size(); ++pc) {
+        TmInstruction& ins = code[instructions[pc]];
+        bool jump = ins.op[0] == 'J' || (ins.op == "LDA" && ins.r == Register::pc);
+        if (ins.register_only || ins.s != Register::pc || !jump || ins.isJump()) {
+            continue;
+        }
+        int64_t to = static_cast<int64_t>(pc) + 1 + ins.d;
+        if (to >= 0 && to < static_cast<int64_t>(instructions.size())) {
+            ins.target = static_cast<int>(instructions[static_cast<size_t>(to)]);
+        }
+    }
+}
+
+void writeTmCode(std::ostream& os, const TmCode& code, bool trace, LineTable& line_table) {
+    std::vector<int> pcs(code.size() + 1, 0);  // by index, of the instructions
+    int pc = 0;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (!code[i].isComment()) {
+            pcs[i] = ++pc;
+        }
+    }
+    pcs[code.size()] = pc + 1;
+
+    pc = 0;
+    for (const TmInstruction& ins : code) {
+        if (ins.isComment()) {
+            os << ins.comment << '\n';
+            continue;
+        }
+        ++pc;
+        line_table.add(pc, ins.line);
+        os << pc << ":   " << ins.op << " " << static_cast<int>(ins.r) << ",";
+        if (ins.register_only) {
+            os << static_cast<int>(ins.s) << "," << static_cast<int>(ins.t);
+        } else {
+            int64_t d = ins.isJump() ? pcs[nextInstruction(code, static_cast<size_t>(ins.target))] - (pc + 1) : ins.d;
+            os << d << "(" << static_cast<int>(ins.s) << ")";
+        }
+        if (trace) {
+            os << "\t\t* " << ins.comment;
+        }
+        os << '\n';
+    }
+}
+
+} // namespace nova
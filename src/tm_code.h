@@ -0,0 +1,61 @@
+#ifndef __NOVA_TM_CODE_H__
+#define __NOVA_TM_CODE_H__
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "codegen.h"
+#include "line_table.h"
+
+namespace nova {
+
+// One line of a TM listing being generated, an instruction or a comment
+// line. A pc-relative instruction names the line it goes to rather than
+// its offset, so that lines can be removed and inserted before the code is
+// written.
+struct TmInstruction {
+    TmInstruction()
+        : register_only(false),
+          r(Register::ac),
+          s(Register::ac),
+          t(Register::ac),
+          d(0),
+          target(-1),
+          line(0) {
+    }
+
+    bool isComment() const { return op.empty(); }
+    bool isJump() const { return target >= 0; }
+    // a jump that always goes to its target
+    bool isUnconditionalJump() const { return isJump() && op == "LDA"; }
+
+    std::string op;       // empty for a comment line
+    bool register_only;   // op r,s,t rather than op r,d(s)
+    Register r;
+    Register s;
+    Register t;
+    int64_t d;            // unused by a jump
+    int target;           // the index of the line a jump goes to, -1 for any other instruction
+    int line;             // in the TINY source
+    std::string comment;
+};
+
+typedef std::vector<TmInstruction> TmCode;
+
+// The first instruction at or after index, code.size() if there is none.
+size_t nextInstruction(const TmCode& code, size_t index);
+
+// Gives each jump, a Jxx r,d(pc) or LDA pc,d(pc), that has no target yet
+// the one its offset goes to.
+void resolveTargets(TmCode& code);
+
+// Writes the listing in the format of CodeGenerator::generateCode(), the
+// comments only when trace is set, and the line of each pc to line_table.
+void writeTmCode(std::ostream& os, const TmCode& code, bool trace, LineTable& line_table);
+
+} // namespace nova
+
+#endif
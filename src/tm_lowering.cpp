@@ -0,0 +1,801 @@
+#include "tm_lowering.h"
+
+#include "register_allocator.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+size_t index(int id) {
+    return static_cast<size_t>(id);
+}
+
+} // namespace
+
+TmLowering::TmLowering(const Function& function, const std::string& file_name, bool trace_code,
+                       PeepholeOptimizer* peephole)
+    : function_(function),
+      file_name_(file_name),
+      trace_code_(trace_code),
+      peephole_(peephole),
+      location_count_(function.variableCount()),
+      taken_(0),
+      position_(0),
+      tmp_offset_(0),
+      source_line_(0) {
+}
+
+CodeBuffer TmLowering::generateCode() {
+    analyze();
+    assignLocations();
+    allocateRegisters();
+    findForwardedBlocks();
+    generatePrelude();
+    for (size_t i = 0; i < function_.layout().size(); ++i) {
+        generateBlock(i);
+    }
+    resolveJumps();
+    if (peephole_ != nullptr) {
+        peephole_->optimize(code_);
+    }
+    std::ostringstream os;
+    line_table_.clear();
+    line_table_.setFileName(file_name_);
+    writeTmCode(os, code_, trace_code_, line_table_);
+    line_table_.write(os);
+    return os.str();
+}
+
+void TmLowering::analyze() {
+    size_t value_count = index(function_.valueCount());
+    definitions_.assign(value_count, Definition{kNoBlock, 0, 0});
+    uses_.assign(value_count, 0);
+    use_blocks_.assign(value_count, kNoBlock);
+    inlined_.assign(value_count, false);
+    auto use = [this](ValueId value, BlockId id) {
+        ++uses_[index(value)];
+        use_blocks_[index(value)] = id;
+    };
+    for (BlockId id : function_.layout()) {
+        const BasicBlock& b = function_.block(id);
+        for (size_t i = 0; i < b.instructions.size(); ++i) {
+            const Instruction& ins = b.instructions[i];
+            for (int j = 0; j < operandCount(ins.op); ++j) {
+                use(ins.operands[j], id);
+            }
+            if (ins.result == kNoValue) {
+                continue;
+            }
+            Definition& definition = definitions_[index(ins.result)];
+            if (definition.count++ == 0) {
+                definition.block = id;
+                definition.index = static_cast<int>(i);
+            }
+        }
+        if (b.terminator.kind == TerminatorKind::kBranch) {
+            use(b.terminator.condition, id);
+        }
+    }
+    for (BlockId id : function_.layout()) {
+        chooseInlinedValues(id);
+    }
+}
+
+// Simulates the evaluation stack of the block: a temporary waits on it
+// until an instruction takes it as an operand, which must take the ones on
+// top in order. Whatever else is waiting when an instruction emits code of
+// its own is stored instead, unless the instruction only computes another
+// temporary without a trap, which the waiting ones cannot observe.
+void TmLowering::chooseInlinedValues(BlockId id) {
+    const BasicBlock& b = function_.block(id);
+    auto candidate = [this, id](ValueId value) {
+        const Definition& definition = definitions_[index(value)];
+        return definition.count == 1 && definition.block == id && uses_[index(value)] == 1 &&
+               use_blocks_[index(value)] == id && !isConstant(value) && !definesVariable(*this->definition(value));
+    };
+    std::vector<ValueId> pending;
+    auto consume = [&](const ValueId* operands, int count) {
+        std::vector<ValueId> wanted;
+        for (int i = 0; i < count; ++i) {
+            if (candidate(operands[i])) {
+                wanted.push_back(operands[i]);
+            }
+        }
+        if (pending.size() < wanted.size() ||
+            !std::equal(wanted.begin(), wanted.end(), pending.end() - static_cast<std::ptrdiff_t>(wanted.size()))) {
+            pending.clear();
+            return;
+        }
+        for (ValueId value : wanted) {
+            inlined_[index(value)] = true;
+        }
+        pending.resize(pending.size() - wanted.size());
+    };
+
+    for (const Instruction& ins : b.instructions) {
+        consume(ins.operands, operandCount(ins.op));
+        if (ins.result != kNoValue && candidate(ins.result)) {
+            pending.push_back(ins.result);
+        } else if (emitsCode(ins) && !(isBinary(ins.op) && ins.op != Opcode::kDiv && !definesVariable(ins))) {
+            pending.clear();
+        }
+    }
+    if (b.terminator.kind == TerminatorKind::kBranch) {
+        consume(&b.terminator.condition, 1);
+    }
+}
+
+void TmLowering::assignLocations() {
+    locations_.assign(index(function_.valueCount()), -1);
+    for (ValueId value = 0; value < function_.valueCount(); ++value) {
+        const Instruction* ins = definition(value);
+        if (ins != nullptr && definesVariable(*ins)) {
+            locations_[index(value)] = ins->variable;
+        } else if (ins == nullptr ? uses_[index(value)] > 0 : !inlined_[index(value)] && !isConstant(value)) {
+            locations_[index(value)] = location_count_++;
+        }
+    }
+}
+
+// Numbers the positions of the code: the start of each block, each
+// instruction that is not part of a tree and the terminator. The interval
+// of a location runs from the first to the last position it is live at,
+// found from its uses, definitions and the blocks it is live into.
+void TmLowering::allocateRegisters() {
+    const std::vector<BlockId>& layout = function_.layout();
+    size_t location_count = index(location_count_);
+    size_t block_count = index(function_.blockCount());
+
+    // loop depth of the blocks, a repeat is the blocks from the target of
+    // a branch back to the branch
+    std::vector<int> order(block_count, 0);
+    for (size_t i = 0; i < layout.size(); ++i) {
+        order[index(layout[i])] = static_cast<int>(i);
+    }
+    std::vector<int> depths(layout.size() + 1, 0);
+    for (BlockId id : layout) {
+        const Terminator& terminator = function_.block(id).terminator;
+        for (int i = 0; i < terminator.successorCount(); ++i) {
+            int target = order[index(terminator.targets[i])];
+            if (target <= order[index(id)]) {
+                ++depths[index(target)];
+                --depths[index(order[index(id)] + 1)];
+            }
+        }
+    }
+    for (size_t i = 1; i < depths.size(); ++i) {
+        depths[i] += depths[i - 1];
+    }
+
+    std::vector<int> starts(location_count, -1);
+    std::vector<int> ends(location_count, -1);
+    std::vector<double> weights(location_count, 0);
+    std::vector<std::vector<BlockId>> defined(location_count);
+    std::vector<std::vector<BlockId>> exposed(location_count);
+    std::vector<BlockId> defined_in(location_count, kNoBlock);
+    std::vector<BlockId> exposed_in(location_count, kNoBlock);
+    auto extend = [&](int location, int position) {
+        int& start = starts[index(location)];
+        int& end = ends[index(location)];
+        start = start < 0 ? position : std::min(start, position);
+        end = std::max(end, position);
+    };
+
+    block_starts_.assign(block_count, 0);
+    std::vector<int> block_ends(block_count, 0);
+    std::vector<int> uses;
+    int position = 0;
+    for (size_t i = 0; i < layout.size(); ++i) {
+        BlockId id = layout[i];
+        const BasicBlock& b = function_.block(id);
+        double weight = 1;
+        for (int depth = std::min(depths[i], 6); depth > 0; --depth) {
+            weight *= 10;
+        }
+        // a copy within the slot of a variable costs nothing wherever it is
+        double cost = weight;
+        auto event = [&](int location, bool definition) {
+            extend(location, position);
+            weights[index(location)] += cost;
+            if (definition) {
+                if (defined_in[index(location)] != id) {
+                    defined_in[index(location)] = id;
+                    defined[index(location)].push_back(id);
+                }
+            } else if (defined_in[index(location)] != id && exposed_in[index(location)] != id) {
+                exposed_in[index(location)] = id;
+                exposed[index(location)].push_back(id);
+            }
+        };
+
+        block_starts_[index(id)] = ++position;
+        for (const Instruction& ins : b.instructions) {
+            if (isInlined(ins)) {
+                continue;
+            }
+            ++position;
+            cost = emitsCode(ins) ? weight : 0;
+            uses.clear();
+            if (ins.op == Opcode::kLoad) {
+                uses.push_back(ins.variable);
+            }
+            for (int j = 0; j < operandCount(ins.op); ++j) {
+                collectUses(ins.operands[j], uses);
+            }
+            for (int location : uses) {
+                event(location, false);
+            }
+            if (ins.result != kNoValue && locations_[index(ins.result)] >= 0) {
+                int location = locations_[index(ins.result)];
+                event(location, true);
+                // registers start out 0 like the memory
+                if (ins.op == Opcode::kInitial) {
+                    extend(location, 0);
+                }
+            }
+        }
+        ++position;
+        cost = weight;
+        if (b.terminator.kind == TerminatorKind::kBranch) {
+            uses.clear();
+            collectUses(b.terminator.condition, uses);
+            for (int location : uses) {
+                event(location, false);
+            }
+        }
+        block_ends[index(id)] = position;
+    }
+
+    // a location is live from the start of the blocks it is live into and
+    // to the end of their predecessors
+    std::vector<int> defines(block_count, -1);
+    std::vector<int> live_in(block_count, -1);
+    for (int location = 0; location < location_count_; ++location) {
+        for (BlockId id : defined[index(location)]) {
+            defines[index(id)] = location;
+        }
+        std::vector<BlockId> worklist = exposed[index(location)];
+        for (BlockId id : worklist) {
+            live_in[index(id)] = location;
+        }
+        while (!worklist.empty()) {
+            BlockId id = worklist.back();
+            worklist.pop_back();
+            extend(location, block_starts_[index(id)]);
+            if (id == function_.entry()) {
+                extend(location, 0);
+            }
+            for (BlockId pred : function_.block(id).predecessors) {
+                extend(location, block_ends[index(pred)]);
+                if (defines[index(pred)] != location && live_in[index(pred)] != location) {
+                    live_in[index(pred)] = location;
+                    worklist.push_back(pred);
+                }
+            }
+        }
+    }
+
+    std::vector<LiveInterval> intervals;
+    std::vector<int> interval_locations;
+    for (int location = 0; location < location_count_; ++location) {
+        if (starts[index(location)] >= 0) {
+            intervals.push_back(LiveInterval(starts[index(location)], ends[index(location)], weights[index(location)]));
+            interval_locations.push_back(location);
+        }
+    }
+    std::vector<Register> allocated = RegisterAllocator({Register::r2, Register::r3, Register::r4}).allocate(intervals);
+    registers_.assign(location_count, Register::invalid);
+    held_.assign(index(position + 1), 0);
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        registers_[index(interval_locations[i])] = allocated[i];
+        if (allocated[i] == Register::invalid) {
+            continue;
+        }
+        for (int p = intervals[i].start; p <= intervals[i].end; ++p) {
+            held_[index(p)] = static_cast<uint8_t>(held_[index(p)] | 1 << static_cast<int>(allocated[i]));
+        }
+    }
+}
+
+void TmLowering::findForwardedBlocks() {
+    forward_.assign(index(function_.blockCount()), kNoBlock);
+    block_lines_.assign(index(function_.blockCount()), 0);
+    for (BlockId id : function_.layout()) {
+        const BasicBlock& b = function_.block(id);
+        // execution starts with the code of the entry
+        if (id == function_.entry() || b.terminator.kind != TerminatorKind::kJump) {
+            continue;
+        }
+        bool empty = true;
+        for (const Instruction& ins : b.instructions) {
+            empty = empty && (isInlined(ins) || !emitsCode(ins));
+        }
+        if (empty) {
+            forward_[index(id)] = b.terminator.targets[0];
+        }
+    }
+    // an empty loop keeps a jump
+    std::vector<BlockId> walked(index(function_.blockCount()), kNoBlock);
+    for (BlockId id : function_.layout()) {
+        for (BlockId b = id; forward_[index(b)] != kNoBlock; b = forward_[index(b)]) {
+            if (walked[index(b)] == id) {
+                forward_[index(b)] = kNoBlock;
+                break;
+            }
+            if (walked[index(b)] != kNoBlock) {
+                break;
+            }
+            walked[index(b)] = id;
+        }
+    }
+}
+
+BlockId TmLowering::resolveTarget(BlockId id) const {
+    while (forward_[index(id)] != kNoBlock) {
+        id = forward_[index(id)];
+    }
+    return id;
+}
+
+const Instruction* TmLowering::definition(ValueId value) const {
+    const Definition& definition = definitions_[index(value)];
+    if (definition.count == 0) {
+        return nullptr;
+    }
+    return &function_.block(definition.block).instructions[index(definition.index)];
+}
+
+bool TmLowering::isConstant(ValueId value) const {
+    const Instruction* ins = definition(value);
+    return definitions_[index(value)].count == 1 && ins->op == Opcode::kConstant;
+}
+
+bool TmLowering::isInlined(const Instruction& ins) const {
+    return ins.result != kNoValue && inlined_[index(ins.result)];
+}
+
+// a constant or a location, which can be read at any time
+bool TmLowering::isLeaf(ValueId value) const {
+    return isConstant(value) || !inlined_[index(value)] || definition(value)->op == Opcode::kLoad;
+}
+
+int TmLowering::location(ValueId value) const {
+    const Instruction* ins = definition(value);
+    if (ins != nullptr && ins->op == Opcode::kLoad && inlined_[index(value)]) {
+        return ins->variable;
+    }
+    return locations_[index(value)];
+}
+
+// the locations the code of value reads
+void TmLowering::collectUses(ValueId value, std::vector<int>& uses) const {
+    if (isConstant(value)) {
+        return;
+    }
+    if (isLeaf(value)) {
+        uses.push_back(location(value));
+        return;
+    }
+    const Instruction* ins = definition(value);
+    for (int i = 0; i < operandCount(ins->op); ++i) {
+        collectUses(ins->operands[i], uses);
+    }
+}
+
+bool TmLowering::emitsCode(const Instruction& ins) const {
+    switch (ins.op) {
+        case Opcode::kConstant:
+        case Opcode::kInitial:
+            return false;
+
+        case Opcode::kCopy: {
+            ValueId source = ins.operands[0];
+            if (source == ins.result) {
+                return false;
+            }
+            const Instruction* source_definition = definition(source);
+            return ins.variable < 0 || source_definition == nullptr || !definesVariable(*source_definition) ||
+                   source_definition->variable != ins.variable;
+        }
+
+        default:
+            return true;
+    }
+}
+
+void TmLowering::generatePrelude() {
+    emitCommentLine("* TINY Compilation to TM Code");
+    emitCommentLine("* File: " + file_name_);
+    emitCommentLine("* Standard prelude:");
+    emitRm("LD", Register::mp, 0, Register::ac, "load maxaddress from location 0");
+    emitRm("ST", Register::ac, 0, Register::ac, "clear location 0");
+    emitCommentLine("* End of standard prelude.");
+}
+
+void TmLowering::generateBlock(size_t layout_index) {
+    const std::vector<BlockId>& layout = function_.layout();
+    BlockId id = layout[layout_index];
+    block_lines_[index(id)] = code_.size();
+    if (forward_[index(id)] != kNoBlock) {
+        return;
+    }
+    BlockId next = kNoBlock;
+    for (size_t i = layout_index + 1; i < layout.size() && next == kNoBlock; ++i) {
+        if (forward_[index(layout[i])] == kNoBlock) {
+            next = layout[i];
+        }
+    }
+    const BasicBlock& b = function_.block(id);
+    position_ = block_starts_[index(id)];
+    for (const Instruction& ins : b.instructions) {
+        if (!isInlined(ins)) {
+            ++position_;
+            generateInstruction(ins);
+        }
+    }
+    ++position_;
+    generateTerminator(b.terminator, next);
+}
+
+void TmLowering::generateInstruction(const Instruction& ins) {
+    if (!emitsCode(ins)) {
+        return;
+    }
+    int saved_line = source_line_;
+    if (ins.line != 0) {
+        source_line_ = ins.line;
+    }
+    int result = ins.result != kNoValue ? locations_[index(ins.result)] : -1;
+    Register target = result >= 0 && registers_[index(result)] != Register::invalid ? registers_[index(result)]
+                                                                                     : Register::ac;
+    switch (ins.op) {
+        case Opcode::kWrite: {
+            Register value = fetchValue(ins.operands[0], Register::ac);
+            emitRo("OUT", value, Register::ac, Register::ac, "write ac");
+            break;
+        }
+
+        case Opcode::kRead:
+            emitRo("IN", target, Register::ac, Register::ac, "read integer value");
+            storeLocation(result, target, "read: store value");
+            break;
+
+        case Opcode::kCopy:
+            if (ins.variable >= 0) {
+                emitCommentLine("* -> assign");
+            }
+            storeLocation(result, fetchValue(ins.operands[0], target),
+                          ins.variable >= 0 ? "assign: store value" : "copy: store temp");
+            if (ins.variable >= 0) {
+                emitCommentLine("* <- assign");
+            }
+            break;
+
+        default:
+            generateOperation(ins, target);
+            storeLocation(result, target, "store temp");
+            break;
+    }
+    source_line_ = saved_line;
+}
+
+void TmLowering::generateTerminator(const Terminator& terminator, BlockId next) {
+    int saved_line = source_line_;
+    if (terminator.line != 0) {
+        source_line_ = terminator.line;
+    }
+    switch (terminator.kind) {
+        case TerminatorKind::kHalt:
+            emitCommentLine("* End of execution");
+            emitRo("HALT", Register::ac, Register::ac, Register::ac, std::string());
+            break;
+
+        case TerminatorKind::kJump: {
+            BlockId target = resolveTarget(terminator.targets[0]);
+            if (target != next) {
+                emitJump("LDA", Register::pc, target, "jmp");
+            }
+            break;
+        }
+
+        case TerminatorKind::kBranch: {
+            // evaluated even when both ways lead to the same place, it may trap
+            Register condition = Register::ac;
+            std::string jump_if_true = "JNE";
+            std::string jump_if_false = "JEQ";
+            const Instruction* test = isLeaf(terminator.condition) ? nullptr : definition(terminator.condition);
+            if (test != nullptr && (test->op == Opcode::kLess || test->op == Opcode::kEqual)) {
+                // the jumps look at the difference of the operands
+                generateBinary(*test, Register::ac, true);
+                jump_if_true = test->op == Opcode::kLess ? "JLT" : "JEQ";
+                jump_if_false = test->op == Opcode::kLess ? "JGE" : "JNE";
+            } else {
+                condition = fetchValue(terminator.condition, Register::ac);
+            }
+            BlockId if_true = resolveTarget(terminator.targets[0]);
+            BlockId if_false = resolveTarget(terminator.targets[1]);
+            if (if_true == if_false) {
+                if (if_true != next) {
+                    emitJump("LDA", Register::pc, if_true, "jmp");
+                }
+            } else if (if_false == next) {
+                emitJump(jump_if_true, condition, if_true, "br if true");
+            } else {
+                emitJump(jump_if_false, condition, if_false, "br if false");
+                if (if_true != next) {
+                    emitJump("LDA", Register::pc, if_true, "jmp");
+                }
+            }
+            break;
+        }
+    }
+    source_line_ = saved_line;
+}
+
+// puts value into target
+void TmLowering::generateValue(ValueId value, Register target) {
+    const Instruction* ins = definition(value);
+    if (ins != nullptr && isConstant(value)) {
+        int saved_line = source_line_;
+        if (ins->line != 0) {
+            source_line_ = ins->line;
+        }
+        emitRm("LDC", target, ins->constant, Register::ac, "load const");
+        source_line_ = saved_line;
+        return;
+    }
+    if (!isLeaf(value)) {
+        generateOperation(*ins, target);
+        return;
+    }
+    int from = location(value);
+    bool variable = from < function_.variableCount();
+    Register source = registers_[index(from)];
+    if (source == Register::invalid) {
+        emitRm("LD", target, from, Register::gp, variable ? "load id value" : "load temp");
+    } else if (source != target) {
+        emitRm("LDA", target, 0, source, variable ? "move id value" : "move temp");
+    }
+}
+
+// the register value is in, target if it has to be put somewhere
+Register TmLowering::fetchValue(ValueId value, Register target) {
+    if (isLeaf(value) && !isConstant(value)) {
+        Register source = registers_[index(location(value))];
+        if (source != Register::invalid) {
+            return source;
+        }
+    }
+    generateValue(value, target);
+    return target;
+}
+
+void TmLowering::generateOperation(const Instruction& ins, Register target) {
+    int saved_line = source_line_;
+    if (ins.line != 0) {
+        source_line_ = ins.line;
+    }
+    switch (ins.op) {
+        case Opcode::kLoad: {
+            Register source = registers_[index(ins.variable)];
+            if (source == Register::invalid) {
+                emitRm("LD", target, ins.variable, Register::gp, "load id value");
+            } else if (source != target) {
+                emitRm("LDA", target, 0, source, "move id value");
+            }
+            break;
+        }
+
+        case Opcode::kCopy:
+            generateValue(ins.operands[0], target);
+            break;
+
+        case Opcode::kRead:
+            emitRo("IN", target, Register::ac, Register::ac, "read integer value");
+            break;
+
+        case Opcode::kConstant:
+            emitRm("LDC", target, ins.constant, Register::ac, "load const");
+            break;
+
+        case Opcode::kInitial:
+            emitRm("LDC", target, 0, Register::ac, "initial value");
+            break;
+
+        case Opcode::kWrite:
+            break;
+
+        default:
+            generateBinary(ins, target);
+            break;
+    }
+    source_line_ = saved_line;
+}
+
+// Recurses as deep as the expression, so it calls itself directly and
+// leaves the strings of the code it emits to the functions it calls.
+void TmLowering::generateBinary(const Instruction& ins, Register target, bool branch) {
+    ValueId left_value = ins.operands[0];
+    ValueId right_value = ins.operands[1];
+    Register left = Register::ac;
+    Register right = Register::ac;
+    int saved_line = source_line_;
+    if (ins.line != 0) {
+        source_line_ = ins.line;
+    }
+    emitOperatorStart();
+    if (isLeaf(right_value)) {
+        if (isLeaf(left_value)) {
+            left = fetchValue(left_value, Register::ac);
+        } else {
+            generateTree(left_value, Register::ac);
+        }
+        right = fetchValue(right_value, Register::ac1);
+    } else if (isLeaf(left_value)) {
+        generateTree(right_value, Register::ac);
+        left = fetchValue(left_value, Register::ac1);
+    } else {
+        // the left value waits in a free register, or on the temporary memory
+        Register saved = takeRegister();
+        generateTree(left_value, saved != Register::invalid ? saved : Register::ac);
+        if (saved == Register::invalid) {
+            pushLeft();
+        }
+        generateTree(right_value, Register::ac);
+        left = saved != Register::invalid ? releaseRegister(saved) : popLeft();
+    }
+    emitOperator(ins.op, target, left, right, branch);
+    source_line_ = saved_line;
+}
+
+void TmLowering::generateTree(ValueId value, Register target) {
+    const Instruction& ins = *definition(value);
+    if (operandCount(ins.op) == 2) {
+        generateBinary(ins, target);
+    } else {
+        generateOperation(ins, target);
+    }
+}
+
+void TmLowering::emitOperatorStart() {
+    emitCommentLine("* -> op");
+}
+
+void TmLowering::pushLeft() {
+    emitRm("ST", Register::ac, tmp_offset_, Register::mp, "op: push left");
+    ++tmp_offset_;
+}
+
+Register TmLowering::popLeft() {
+    --tmp_offset_;
+    emitRm("LD", Register::ac1, tmp_offset_, Register::mp, "op: load left");
+    return Register::ac1;
+}
+
+// the code of a binary operator on the values in left and right, a
+// comparison for a branch only leaves their difference
+void TmLowering::emitOperator(Opcode op, Register target, Register left, Register right, bool branch) {
+    if (branch) {
+        emitRo("SUB", target, left, right, op == Opcode::kLess ? "op <" : "op =");
+        emitCommentLine("* <- op");
+        return;
+    }
+    switch (op) {
+        case Opcode::kAdd:
+            emitRo("ADD", target, left, right, "op +");
+            break;
+
+        case Opcode::kSub:
+            emitRo("SUB", target, left, right, "op -");
+            break;
+
+        case Opcode::kMul:
+            emitRo("MUL", target, left, right, "op *");
+            break;
+
+        case Opcode::kDiv:
+            emitRo("DIV", target, left, right, "op /");
+            break;
+
+        case Opcode::kLess:
+            emitRo("SUB", target, left, right, "op <");
+            emitRm("JLT", target, 2, Register::pc, "br if true");
+            emitRm("LDC", target, 0, Register::ac, "false case");
+            emitRm("LDA", Register::pc, 1, Register::pc, "unconditional jmp");
+            emitRm("LDC", target, 1, Register::ac, "true case");
+            break;
+
+        default:
+            emitRo("SUB", target, left, right, "op =");
+            emitRm("JEQ", target, 2, Register::pc, "br if true");
+            emitRm("LDC", target, 0, Register::ac, "false case");
+            emitRm("LDA", Register::pc, 1, Register::pc, "unconditional jmp");
+            emitRm("LDC", target, 1, Register::ac, "true case");
+            break;
+    }
+    emitCommentLine("* <- op");
+}
+
+// stores source, where the value of the instruction was put, to its
+// location if that is in memory
+void TmLowering::storeLocation(int location, Register source, const std::string& comment) {
+    Register home = registers_[index(location)];
+    if (home == Register::invalid) {
+        emitRm("ST", source, location, Register::gp, comment);
+    } else if (home != source) {
+        emitRm("LDA", home, 0, source, comment);
+    }
+}
+
+// a register neither a location nor an enclosing operator holds here,
+// Register::invalid if there is none
+Register TmLowering::takeRegister() {
+    uint8_t busy = static_cast<uint8_t>(held_[index(position_)] | taken_);
+    for (Register r : {Register::r2, Register::r3, Register::r4}) {
+        uint8_t bit = static_cast<uint8_t>(1 << static_cast<int>(r));
+        if ((busy & bit) == 0) {
+            taken_ = static_cast<uint8_t>(taken_ | bit);
+            return r;
+        }
+    }
+    return Register::invalid;
+}
+
+Register TmLowering::releaseRegister(Register r) {
+    taken_ = static_cast<uint8_t>(taken_ & ~(1 << static_cast<int>(r)));
+    return r;
+}
+
+void TmLowering::emitCommentLine(const std::string& comment) {
+    if (trace_code_) {
+        code_.push_back(TmInstruction());
+        code_.back().comment = comment;
+    }
+}
+
+// op r,s,t
+void TmLowering::emitRo(const std::string& op, Register r, Register s, Register t, const std::string& comment) {
+    TmInstruction ins;
+    ins.op = op;
+    ins.register_only = true;
+    ins.r = r;
+    ins.s = s;
+    ins.t = t;
+    ins.line = source_line_;
+    ins.comment = comment;
+    code_.push_back(ins);
+}
+
+// op r,d(s)
+void TmLowering::emitRm(const std::string& op, Register r, int64_t d, Register s, const std::string& comment) {
+    TmInstruction ins;
+    ins.op = op;
+    ins.r = r;
+    ins.s = s;
+    ins.d = d;
+    ins.line = source_line_;
+    ins.comment = comment;
+    code_.push_back(ins);
+}
+
+// op r,d(pc) to the first instruction of target, found by resolveJumps()
+void TmLowering::emitJump(const std::string& op, Register r, BlockId target, const std::string& comment) {
+    block_jumps_.push_back(std::make_pair(code_.size(), target));
+    emitRm(op, r, 0, Register::pc, comment);
+}
+
+void TmLowering::resolveJumps() {
+    for (const std::pair<size_t, BlockId>& jump : block_jumps_) {
+        code_[jump.first].target = static_cast<int>(block_lines_[index(jump.second)]);
+    }
+    resolveTargets(code_);
+}
+
+} // namespace ir
+
+} // namespace nova
@@ -0,0 +1,134 @@
+#ifndef __NOVA_TM_LOWERING_H__
+#define __NOVA_TM_LOWERING_H__
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "codegen.h"
+#include "ir.h"
+#include "line_table.h"
+#include "peephole.h"
+#include "tm_code.h"
+
+namespace nova {
+
+namespace ir {
+
+// Generates TM code from a function without phis, in the format of
+// CodeGenerator::generateCode().
+//
+// A temporary used once, later in its own block, with nothing but other
+// such temporaries computed in between, is evaluated where it is used as
+// part of an expression tree. Constants are loaded again at every use.
+// Everything else has a location: all versions of a variable share the
+// variable's, so a copy between two of them is free, and every other
+// temporary gets one of its own.
+//
+// Locations live in registers 2 to 4 or in memory, the variables in their
+// slots and the temporaries in slots past them. Register allocation is a
+// linear scan over the live interval of each location, weighted by its
+// uses, ten times more for each repeat around them. A register no location
+// holds at a point is free for the expression trees evaluated there: an
+// operator whose operands are both trees keeps the left value in one while
+// it evaluates the right one, and pushes it to the temporary memory only
+// when none is left. An operand that is a constant or a location is read
+// after the other operand whatever their order, straight from its
+// register, or loaded into ac1.
+//
+// A branch on a comparison evaluated in place jumps on the difference of
+// its operands, with no 0 or 1 in between.
+//
+// Blocks are emitted in layout order. A jump to the next block is left out
+// and a block with no code that only jumps is skipped, jumps to it going
+// to its target instead.
+class TmLowering {
+public:
+    // the code goes through peephole unless it is nullptr
+    TmLowering(const Function& function, const std::string& file_name, bool trace_code = false,
+               PeepholeOptimizer* peephole = nullptr);
+    TmLowering(const TmLowering&) = delete;
+    TmLowering& operator=(const TmLowering&) = delete;
+
+    CodeBuffer generateCode();
+
+    // TM pc -> TINY source line, also appended to the listing as *.loc lines
+    const LineTable& lineTable() const { return line_table_; }
+
+private:
+    struct Definition {
+        BlockId block;
+        int index;  // in the instructions of the block
+        int count;  // of definitions, copies out of SSA can add several
+    };
+
+    void analyze();
+    void chooseInlinedValues(BlockId id);
+    void assignLocations();
+    void allocateRegisters();
+    void findForwardedBlocks();
+    BlockId resolveTarget(BlockId id) const;
+
+    const Instruction* definition(ValueId value) const;
+    bool isConstant(ValueId value) const;
+    bool isInlined(const Instruction& ins) const;
+    bool isLeaf(ValueId value) const;
+    int location(ValueId value) const;
+    void collectUses(ValueId value, std::vector<int>& uses) const;
+    bool emitsCode(const Instruction& ins) const;
+
+    void generatePrelude();
+    void generateBlock(size_t layout_index);
+    void generateInstruction(const Instruction& ins);
+    void generateTerminator(const Terminator& terminator, BlockId next);
+    void generateValue(ValueId value, Register target);
+    Register fetchValue(ValueId value, Register target);
+    void generateOperation(const Instruction& ins, Register target);
+    void generateBinary(const Instruction& ins, Register target, bool branch = false);
+    void generateTree(ValueId value, Register target);
+    void emitOperatorStart();
+    void pushLeft();
+    Register popLeft();
+    void emitOperator(Opcode op, Register target, Register left, Register right, bool branch);
+    void storeLocation(int location, Register source, const std::string& comment);
+    Register takeRegister();
+    Register releaseRegister(Register r);
+
+    void emitCommentLine(const std::string& comment);
+    void emitRo(const std::string& op, Register r, Register s, Register t, const std::string& comment);
+    void emitRm(const std::string& op, Register r, int64_t d, Register s, const std::string& comment);
+    void emitJump(const std::string& op, Register r, BlockId target, const std::string& comment);
+    void resolveJumps();
+
+private:
+    const Function& function_;
+    std::string file_name_;
+    bool trace_code_;
+    PeepholeOptimizer* peephole_;
+    std::vector<Definition> definitions_;   // by value
+    std::vector<int> uses_;                 // by value
+    std::vector<BlockId> use_blocks_;       // by value, of the last use
+    std::vector<bool> inlined_;             // by value
+    std::vector<int> locations_;            // by value, -1 for none
+    int location_count_;                    // the variables first, their location is their slot
+    std::vector<Register> registers_;       // by location, Register::invalid for memory
+    std::vector<int> block_starts_;         // by block, the position before its first instruction
+    std::vector<uint8_t> held_;             // by position, the registers locations hold there
+    uint8_t taken_;                         // registers holding left operands
+    int position_;                          // of the instruction being generated
+    std::vector<BlockId> forward_;          // by block, kNoBlock unless it is skipped
+    std::vector<size_t> block_lines_;       // by block, the index of its first line
+    std::vector<std::pair<size_t, BlockId>> block_jumps_;  // line, target
+    TmCode code_;
+    int tmp_offset_;
+    int source_line_;
+    LineTable line_table_;
+};
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
@@ -1,45 +1,45 @@
 #include "token.h"
+#include "file_table.h"
+
+#include <type_traits>
 
 namespace nova {
 
-Token::Token(TokenType token_type, 
-             TokenValue token_value, 
-             TokenLocation token_location,
-             int symbol_precedence,
-             const std::string& name)
-    : token_type_(token_type),
-      token_value_(token_value),
-      token_location_(token_location),
-      symbol_precedence_(symbol_precedence),
-      name_(name) {
+static_assert(std::is_trivially_copyable<Token>::value, "Token must stay a plain view");
+static_assert(sizeof(TokenLocation) == 8, "TokenLocation must stay compact");
+static_assert(sizeof(Token) <= 24, "Token must stay compact");
+
+std::string TokenLocation::toString() const {
+    int token_line = 0;
+    int token_column = 0;
+    FileTable::instance().position(file_id_, offset_, &token_line, &token_column);
+    return filename() + ":" + std::to_string(token_line) + ":" + std::to_string(token_column) + ":";   
+}
+
+int TokenLocation::line() const {
+    int token_line = 0;
+    int token_column = 0;
+    FileTable::instance().position(file_id_, offset_, &token_line, &token_column);
+    return token_line;
 }
 
-Token::Token(TokenType token_type, 
-             TokenValue token_value, 
-             TokenLocation token_location,
-             int symbol_precedence,
-             const std::string& name,
-             const std::string& string_value)
-    : token_type_(token_type),
-      token_value_(token_value),
-      token_location_(token_location),
-      symbol_precedence_(symbol_precedence),
-      name_(name),
-      string_value_(string_value) {
+int TokenLocation::column() const {
+    int token_line = 0;
+    int token_column = 0;
+    FileTable::instance().position(file_id_, offset_, &token_line, &token_column);
+    return token_column;
 }
 
-Token::Token(TokenType token_type, 
-             TokenValue token_value, 
-             TokenLocation token_location,
-             int symbol_precedence,
-             const std::string& name,
-             int64_t int_value)
-    : token_type_(token_type),
-      token_value_(token_value),
-      token_location_(token_location),
-      symbol_precedence_(symbol_precedence),
-      name_(name),
-      int_value_(int_value) {
+std::string TokenLocation::filename() const {
+    return FileTable::instance().name(file_id_);
+}
+
+int64_t Token::getIntValue() const {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < length_; ++i) {
+        value = value * 10 + static_cast<uint64_t>(text_[i] - '0');
+    }
+    return static_cast<int64_t>(value);
 }
 
 std::string Token::getTokenTypeDescription() const {
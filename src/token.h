@@ -1,14 +1,15 @@
 #ifndef __NOVA_TOKEN_H__
 #define __NOVA_TOKEN_H__
 
+#include <stdint.h>
+
 #include <string>
-#include <fstream>
-#include <unordered_map>
-#include <memory>
+
+#include "string_piece.h"
 
 namespace nova {
 
-enum class TokenType { 
+enum class TokenType : uint8_t { 
     kIdentifier,
     kKeyword,
     kOperator,
@@ -18,7 +19,7 @@ enum class TokenType {
     kUnknownType,
 };
 
-enum class TokenValue { 
+enum class TokenValue : uint8_t { 
     kIf,
     kThen,
     kElse,
@@ -44,7 +45,7 @@ enum class TokenValue {
 };
 
 struct TokenRecord {
-    TokenRecord(TokenType type, TokenValue value, int precedence)
+    constexpr TokenRecord(TokenType type, TokenValue value, int precedence)
         : token_type(type), 
           token_value(value), 
           symbol_precedence(precedence) {
@@ -55,86 +56,77 @@ struct TokenRecord {
     int symbol_precedence;
 };
 
+// A position in a source registered with the FileTable, 8 bytes. Line and
+// column are resolved through the file's line index when asked for.
 class TokenLocation {
 public:
     TokenLocation()
-        : file_name_(""), 
-          line_(1), 
-          column_(0) { 
+        : file_id_(0), 
+          offset_(0) { 
     }
 
-    TokenLocation(const std::string& file_name, int token_line, int token_column)
-        : file_name_(file_name), 
-          line_(token_line), 
-          column_(token_column) {
+    TokenLocation(uint32_t file_id, uint32_t offset)
+        : file_id_(file_id), 
+          offset_(offset) {
     }
 
-    std::string toString() const {
-        return file_name_ + ":" + std::to_string(line_) + ":" + std::to_string(column_) + ":";   
-    }
+    std::string toString() const;
 
-    int line() const { return line_; }
-    int column() const { return column_; }
-    const std::string& filename() const { return file_name_; }
+    int line() const;
+    int column() const;
+    std::string filename() const;
+    uint32_t fileId() const { return file_id_; }
+    uint32_t offset() const { return offset_; }
 
 private:
-    std::string file_name_;
-    int line_;
-    int column_;
+    uint32_t file_id_;
+    uint32_t offset_;
 };
 
+// A token is a view into the source buffer the scanner reads from, it is
+// trivially copyable, 24 bytes, and only valid as long as that buffer.
 class Token {
 public:
-    Token(TokenType token_type, 
-          TokenValue token_value, 
-          TokenLocation token_location,
-          int symbol_precedence,
-          const std::string& name);
-
-    Token(TokenType token_type, 
-          TokenValue token_value, 
-          TokenLocation token_location,
-          int symbol_precedence,
-          const std::string& name,
-          const std::string& string_value);
+    Token()
+        : text_(""),
+          location_(),
+          length_(0),
+          token_type_(TokenType::kUnknownType),
+          token_value_(TokenValue::kUnReserved),
+          symbol_precedence_(-1) {
+    }
 
     Token(TokenType token_type, 
           TokenValue token_value, 
-          TokenLocation token_location,
           int symbol_precedence,
-          const std::string& name,
-          int64_t int_value);
+          StringPiece text,
+          TokenLocation location)
+        : text_(text.data()),
+          location_(location),
+          length_(static_cast<uint32_t>(text.size())),
+          token_type_(token_type),
+          token_value_(token_value),
+          symbol_precedence_(static_cast<int8_t>(symbol_precedence)) {
+    }
 
     std::string getTokenTypeDescription() const;
 
     TokenType getTokenType() const { return token_type_; }
     TokenValue getTokenValue() const { return token_value_; }
-    const TokenLocation& getTokenLocation() const { return token_location_; }
     int getSymbolPrecedence() const { return symbol_precedence_; }
-    const std::string& getTokenName() const { return name_; } 
-    const std::string& getStringValue() const { return string_value_; }
-    int64_t getIntValue() const { return int_value_; }
+    StringPiece getTokenName() const { return StringPiece(text_, length_); } 
+    int64_t getIntValue() const;
+    TokenLocation getTokenLocation() const { return location_; }
 
 private:
+    const char* text_;
+    TokenLocation location_;
+    uint32_t length_;
     TokenType token_type_;
     TokenValue token_value_;
-    TokenLocation token_location_;
-    int symbol_precedence_;
-    std::string name_;
-
-    std::string string_value_;
-    int64_t int_value_;
+    int8_t symbol_precedence_;
 };
 
-typedef std::unique_ptr<TokenRecord> TokenRecordPtr;
-
-inline TokenRecordPtr makeTokenRecord(
-        TokenType token_type, 
-        TokenValue token_value, 
-        int symbol_precedence) {
-    return std::make_unique<TokenRecord>(token_type, token_value, symbol_precedence);
-}
-    
 } // namespace nova
 
 #endif
@@ -0,0 +1,173 @@
+#include "tracer.h"
+
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace nova {
+
+namespace vm {
+
+namespace {
+
+const int kSignals[] = { SIGINT, SIGTERM, SIGQUIT, SIGSEGV, SIGBUS, SIGFPE, SIGABRT };
+const size_t kSignalCount = sizeof(kSignals) / sizeof(kSignals[0]);
+
+std::atomic<const Tracer*> g_signal_tracer(nullptr);
+struct sigaction g_old_actions[kSignalCount];
+
+// formats into a stack buffer, nothing here may allocate
+class LineWriter {
+public:
+    explicit LineWriter(int fd)
+        : fd_(fd), 
+          length_(0) {
+    }
+
+    ~LineWriter() {
+        flush();
+    }
+
+    LineWriter& append(const char* s) {
+        while (*s != '\0') {
+            if (length_ == sizeof(buffer_)) {
+                flush();
+            }
+            buffer_[length_++] = *s++;
+        }
+        return *this;
+    }
+
+    LineWriter& append(int64_t n) {
+        char digits[24];
+        size_t count = 0;
+        uint64_t value = n < 0 ? static_cast<uint64_t>(-(n + 1)) + 1 : static_cast<uint64_t>(n);
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        if (n < 0) {
+            append("-");
+        }
+        char text[24];
+        for (size_t i = 0; i < count; ++i) {
+            text[i] = digits[count - 1 - i];
+        }
+        text[count] = '\0';
+        return append(text);
+    }
+
+    void flush() {
+        size_t written = 0;
+        while (written < length_) {
+            ssize_t n = ::write(fd_, buffer_ + written, length_ - written);
+            if (n <= 0) {
+                break;
+            }
+            written += static_cast<size_t>(n);
+        }
+        length_ = 0;
+    }
+
+private:
+    int fd_;
+    size_t length_;
+    char buffer_[256];
+};
+
+const char* signalName(int signo) {
+    switch (signo) {
+        case SIGINT: return "signal SIGINT";
+        case SIGTERM: return "signal SIGTERM";
+        case SIGQUIT: return "signal SIGQUIT";
+        case SIGSEGV: return "signal SIGSEGV";
+        case SIGBUS: return "signal SIGBUS";
+        case SIGFPE: return "signal SIGFPE";
+        case SIGABRT: return "signal SIGABRT";
+        default: return "signal";
+    }
+}
+
+} // namespace
+
+Tracer::Tracer(size_t capacity)
+    : mask_(0),
+      count_(0),
+      handlers_installed_(false) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    entries_.resize(size);
+    mask_ = size - 1;
+}
+
+Tracer::~Tracer() {
+    removeSignalHandlers();
+}
+
+void Tracer::dump(int fd, const char* reason) const {
+    uint64_t size = mask_ + 1;
+    uint64_t first = count_ > size ? count_ - size : 0;
+
+    LineWriter writer(fd);
+    writer.append("--------- Trace: last ").append(static_cast<int64_t>(count_ - first)).append(" of ")
+          .append(static_cast<int64_t>(count_)).append(" instructions, stopped by ").append(reason)
+          .append(" ----------\n");
+    for (uint64_t i = first; i < count_; ++i) {
+        const TraceEntry& entry = entries_[static_cast<size_t>(i & mask_)];
+        TokenValue opcode = static_cast<TokenValue>(entry.opcode);
+        writer.append("pc ").append(static_cast<int64_t>(entry.pc)).append("\t").append(opcodeName(opcode));
+        if (opcode == TokenValue::kLd || opcode == TokenValue::kSt) {
+            writer.append(entry.base == VirtualMachine::kMp ? "\ttmp[" : "\tglobal[")
+                  .append(static_cast<int64_t>(entry.address)).append("]");
+        }
+        if (entry.reg >= 0) {
+            writer.append("\tr").append(static_cast<int64_t>(entry.reg)).append(" = ")
+                  .append(static_cast<int64_t>(entry.value));
+        }
+        writer.append("\n");
+    }
+}
+
+void Tracer::installSignalHandlers() {
+    if (handlers_installed_) {
+        return;
+    }
+    g_signal_tracer.store(this);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &Tracer::handleSignal;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < kSignalCount; ++i) {
+        sigaction(kSignals[i], &action, &g_old_actions[i]);
+    }
+    handlers_installed_ = true;
+}
+
+void Tracer::removeSignalHandlers() {
+    if (!handlers_installed_) {
+        return;
+    }
+    for (size_t i = 0; i < kSignalCount; ++i) {
+        sigaction(kSignals[i], &g_old_actions[i], nullptr);
+    }
+    g_signal_tracer.store(nullptr);
+    handlers_installed_ = false;
+}
+
+void Tracer::handleSignal(int signo) {
+    const Tracer* tracer = g_signal_tracer.load();
+    if (tracer != nullptr) {
+        tracer->dump(STDERR_FILENO, signalName(signo));
+    }
+    // SA_RESETHAND restored the default action
+    raise(signo);
+}
+
+} // namespace vm
+
+} // namespace nova
@@ -0,0 +1,97 @@
+#ifndef __NOVA_TRACER_H__
+#define __NOVA_TRACER_H__
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "vm.h"
+
+namespace nova {
+
+namespace vm {
+
+struct TraceEntry {
+    int pc;
+    int value;     // value of the written register after execution
+    int address;   // memory address of LD/ST
+    uint8_t opcode;
+    int8_t reg;    // written register, -1 if none
+    int8_t base;   // base register of LD/ST, selects the memory region
+};
+
+// Remembers the last executed instructions in a fixed-size ring, so that it
+// can be dumped after a halt, a trap or a fatal signal. Recording is a few
+// stores into preallocated memory, cheap enough to be left on.
+class Tracer {
+public:
+    // capacity is rounded up to a power of 2
+    explicit Tracer(size_t capacity);
+    ~Tracer();
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // address is the effective address param2 + reg[param3] computed before
+    // execution, registers are the registers after execution
+    void record(int pc, const Instruction& ins, int address, const int* registers) {
+        TraceEntry& entry = entries_[static_cast<size_t>(count_ & mask_)];
+        ++count_;
+        int reg = writtenRegister(ins);
+        entry.pc = pc;
+        entry.value = reg >= 0 ? registers[reg] : 0;
+        entry.address = address;
+        entry.opcode = static_cast<uint8_t>(ins.token_value);
+        entry.reg = static_cast<int8_t>(reg);
+        entry.base = static_cast<int8_t>(ins.param3);
+    }
+
+    uint64_t count() const { return count_; }
+
+    // Only uses write(2), so it is safe to call from a signal handler.
+    void dump(int fd, const char* reason) const;
+
+    // Dump the ring on SIGINT, SIGTERM, SIGQUIT, SIGSEGV, SIGBUS, SIGFPE and
+    // SIGABRT, then let the signal take its default action.
+    void installSignalHandlers();
+    void removeSignalHandlers();
+
+private:
+    static int writtenRegister(const Instruction& ins) {
+        switch (ins.token_value) {
+            case TokenValue::kIn:
+            case TokenValue::kAdd:
+            case TokenValue::kSub:
+            case TokenValue::kMul:
+            case TokenValue::kDiv:
+            case TokenValue::kLd:
+            case TokenValue::kLda:
+            case TokenValue::kLdc:
+                return ins.param1;
+
+            case TokenValue::kJlt:
+            case TokenValue::kJle:
+            case TokenValue::kJge:
+            case TokenValue::kJgt:
+            case TokenValue::kJeq:
+            case TokenValue::kJne:
+                return VirtualMachine::kPc;
+
+            default:
+                return -1;
+        }
+    }
+
+    static void handleSignal(int signo);
+
+private:
+    std::vector<TraceEntry> entries_;
+    uint64_t mask_;
+    uint64_t count_;
+    bool handlers_installed_;
+};
+
+} // namespace vm
+
+} // namespace nova
+
+#endif
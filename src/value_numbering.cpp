@@ -0,0 +1,218 @@
+#include "value_numbering.h"
+
+#include "dominators.h"
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace nova {
+
+namespace ir {
+
+namespace {
+
+size_t index(int id) {
+    return static_cast<size_t>(id);
+}
+
+// an operator on the numbers of its operands, or a constant
+struct Expression {
+    bool operator==(const Expression& other) const {
+        return op == other.op && left == other.left && right == other.right && constant == other.constant;
+    }
+
+    Opcode op;
+    ValueId left;
+    ValueId right;
+    int64_t constant;
+};
+
+struct ExpressionHash {
+    size_t operator()(const Expression& e) const {
+        size_t hash = std::hash<int>()(static_cast<int>(e.op));
+        hash = hash * 31 + std::hash<int>()(e.left);
+        hash = hash * 31 + std::hash<int>()(e.right);
+        return hash * 31 + std::hash<int64_t>()(e.constant);
+    }
+};
+
+bool isCommutative(Opcode op) {
+    return op == Opcode::kAdd || op == Opcode::kMul || op == Opcode::kEqual;
+}
+
+class ValueNumbering {
+public:
+    explicit ValueNumbering(Function& function)
+        : function_(function),
+          numbers_(index(function.valueCount()), kNoValue),
+          replaced_(index(function.valueCount()), kNoValue),
+          holders_(index(function.valueCount()), kNoValue),
+          variables_(index(function.valueCount()), -1),
+          current_(index(function.variableCount()), kNoValue),
+          removed_(0) {
+    }
+
+    int run();
+
+private:
+    void numberBlock(BlockId id);
+    ValueId resolve(ValueId value) const;
+    ValueId number(ValueId value) const;
+    ValueId holder(ValueId value) const;
+    void define(ValueId value, int variable);
+
+private:
+    Function& function_;
+    std::vector<ValueId> numbers_;   // by value, the number of its value
+    std::vector<ValueId> replaced_;  // by value, the one that replaces it
+    std::vector<ValueId> holders_;   // by value, the last version of a variable copied from it
+    std::vector<int> variables_;     // by value, the variable it is a version of
+    std::vector<ValueId> current_;   // by variable, its version in the block numbered
+    std::vector<int> defined_;       // the variables given a version by the block
+    std::unordered_map<Expression, ValueId, ExpressionHash> available_;
+    std::vector<Expression> added_;  // to available_ by the blocks on the walk
+    int removed_;
+};
+
+int ValueNumbering::run() {
+    DominatorTree dominators(function_);
+    struct Frame {
+        BlockId block;
+        size_t child;
+        size_t added;
+    };
+    std::vector<Frame> walk;
+    walk.push_back(Frame{function_.entry(), 0, 0});
+    bool entering = true;
+    while (!walk.empty()) {
+        Frame& frame = walk.back();
+        if (entering) {
+            frame.added = added_.size();
+            numberBlock(frame.block);
+        }
+        const std::vector<BlockId>& children = dominators.children(frame.block);
+        if (frame.child < children.size()) {
+            BlockId child = children[frame.child++];
+            walk.push_back(Frame{child, 0, 0});
+            entering = true;
+            continue;
+        }
+        while (added_.size() > frame.added) {
+            available_.erase(added_.back());
+            added_.pop_back();
+        }
+        walk.pop_back();
+        entering = false;
+    }
+
+    // the phis and terminators of blocks numbered earlier may use the
+    // values removed later
+    for (BlockId id : function_.layout()) {
+        BasicBlock& b = function_.block(id);
+        for (Phi& phi : b.phis) {
+            for (ValueId& operand : phi.operands) {
+                operand = resolve(operand);
+            }
+        }
+        if (b.terminator.kind == TerminatorKind::kBranch) {
+            b.terminator.condition = resolve(b.terminator.condition);
+        }
+    }
+    return removed_;
+}
+
+void ValueNumbering::numberBlock(BlockId id) {
+    BasicBlock& b = function_.block(id);
+    for (int variable : defined_) {
+        current_[index(variable)] = kNoValue;
+    }
+    defined_.clear();
+    for (const Phi& phi : b.phis) {
+        numbers_[index(phi.result)] = phi.result;
+        define(phi.result, phi.variable);
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < b.instructions.size(); ++i) {
+        Instruction& ins = b.instructions[i];
+        for (int j = 0; j < operandCount(ins.op); ++j) {
+            ins.operands[j] = resolve(ins.operands[j]);
+        }
+        if (ins.op == Opcode::kCopy) {
+            numbers_[index(ins.result)] = number(ins.operands[0]);
+            if (definesVariable(ins)) {
+                holders_[index(numbers_[index(ins.result)])] = ins.result;
+            }
+        } else if (ins.op == Opcode::kConstant || isBinary(ins.op)) {
+            Expression e{ins.op, kNoValue, kNoValue, ins.constant};
+            if (isBinary(ins.op)) {
+                e.left = number(ins.operands[0]);
+                e.right = number(ins.operands[1]);
+                if (isCommutative(ins.op) && e.right < e.left) {
+                    std::swap(e.left, e.right);
+                }
+            }
+            auto found = available_.find(e);
+            if (found != available_.end() && ins.op == Opcode::kConstant) {
+                // loading a constant again costs no more than keeping it
+                numbers_[index(ins.result)] = found->second;
+            } else if (found != available_.end()) {
+                replaced_[index(ins.result)] = holder(found->second);
+                ++removed_;
+                continue;
+            } else {
+                available_.insert(std::make_pair(e, ins.result));
+                added_.push_back(e);
+                numbers_[index(ins.result)] = ins.result;
+            }
+        } else if (ins.result != kNoValue) {
+            numbers_[index(ins.result)] = ins.result;
+        }
+        if (definesVariable(ins)) {
+            define(ins.result, ins.variable);
+        }
+        b.instructions[kept++] = ins;
+    }
+    b.instructions.resize(kept, Instruction(Opcode::kConstant, kNoValue, 0));
+}
+
+ValueId ValueNumbering::resolve(ValueId value) const {
+    ValueId by = replaced_[index(value)];
+    return by != kNoValue ? by : value;
+}
+
+ValueId ValueNumbering::number(ValueId value) const {
+    ValueId n = numbers_[index(value)];
+    return n != kNoValue ? n : value;
+}
+
+// The version of a variable the block copied the value to, while it is
+// the current one, or else the value. Each version of a variable lives in
+// its slot, so only within the block is the version of the dominator walk
+// the one in the slot.
+ValueId ValueNumbering::holder(ValueId value) const {
+    ValueId version = holders_[index(value)];
+    if (version != kNoValue && current_[index(variables_[index(version)])] == version) {
+        return version;
+    }
+    return value;
+}
+
+void ValueNumbering::define(ValueId value, int variable) {
+    variables_[index(value)] = variable;
+    if (current_[index(variable)] == kNoValue) {
+        defined_.push_back(variable);
+    }
+    current_[index(variable)] = value;
+}
+
+} // namespace
+
+int numberValues(Function& function) {
+    return ValueNumbering(function).run();
+}
+
+} // namespace ir
+
+} // namespace nova
@@ -0,0 +1,32 @@
+#ifndef __NOVA_VALUE_NUMBERING_H__
+#define __NOVA_VALUE_NUMBERING_H__
+
+#include "ir.h"
+
+namespace nova {
+
+namespace ir {
+
+// Removes the computations of a function in SSA form that repeat one whose
+// result is already available, after the dominator-based value numbering
+// of Briggs, Cooper and Simpson. Each block numbers its instructions in
+// order, an operator and the numbers of its operands giving the number of
+// its result, and starts from the table of its immediate dominator, so a
+// block reuses what its dominators computed as well as what it computed
+// itself. A copy has the number of its source, a phi, kInitial and kRead a
+// new one.
+//
+// In SSA form an assignment or a read defines a new version of its
+// variable, which gets a new number, so nothing computed from the old one
+// is reused after it. A repeated operator is replaced by the version of a
+// variable the block assigned its value to while the block has not
+// assigned the variable again, else by the temporary that first computed
+// it. A repeated constant is numbered but kept, loading it again costs no
+// more than keeping it. Returns the number of instructions removed.
+int numberValues(Function& function);
+
+} // namespace ir
+
+} // namespace nova
+
+#endif
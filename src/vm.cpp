@@ -1,7 +1,14 @@
 #include "vm.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "tracer.h"
+#include "metrics.h"
 
-#include <assert.h>
+#include <limits.h>
+#include <signal.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 namespace nova {
 
@@ -9,6 +16,59 @@ namespace vm {
 
 bool Scanner::error_flag_ = false;
 
+namespace {
+
+volatile sig_atomic_t g_metrics_requested = 0;
+
+void handleMetricsSignal(int signo) {
+    g_metrics_requested = 1;
+}
+
+double cpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// the register value of an unsigned result, arithmetic wraps around on
+// overflow as the simplifier folds it
+int wrap(uint32_t value) {
+    return static_cast<int>(value);
+}
+
+size_t decimalLength(int value) {
+    size_t length = value < 0 ? 2 : 1;
+    for (int64_t n = value < 0 ? -static_cast<int64_t>(value) : value; n >= 10; n /= 10) {
+        ++length;
+    }
+    return length;
+}
+
+} // namespace
+
+const char* opcodeName(TokenValue value) {
+    switch (value) {
+        case TokenValue::kHalt: return "HALT";
+        case TokenValue::kIn: return "IN";
+        case TokenValue::kOut: return "OUT";
+        case TokenValue::kAdd: return "ADD";
+        case TokenValue::kSub: return "SUB";
+        case TokenValue::kMul: return "MUL";
+        case TokenValue::kDiv: return "DIV";
+        case TokenValue::kLd: return "LD";
+        case TokenValue::kLda: return "LDA";
+        case TokenValue::kLdc: return "LDC";
+        case TokenValue::kSt: return "ST";
+        case TokenValue::kJlt: return "JLT";
+        case TokenValue::kJle: return "JLE";
+        case TokenValue::kJge: return "JGE";
+        case TokenValue::kJgt: return "JGT";
+        case TokenValue::kJeq: return "JEQ";
+        case TokenValue::kJne: return "JNE";
+        default: return "???";
+    }
+}
+
 Scanner::Scanner(const std::string& code)
     : input_(code), 
       state_(State::kNone), 
@@ -59,7 +119,7 @@ void Scanner::getNextChar() {
 }
 
 char Scanner::peekChar() {
-    return static_cast<const char>(input_.peek());
+    return static_cast<char>(input_.peek());
 }
 
 void Scanner::addToBuffer(char c) {
@@ -154,6 +214,7 @@ void Scanner::handleNumberState() {
 }
 
 void Scanner::handleCommentState() {
+    bool directive = (peekChar() == '.');
     while (current_char_ != '\n' && current_char_ != '\r') {
         if (input_.eof()) {
             std::string message = "End of file happened in comment, eol is expected, buf find ";
@@ -161,8 +222,15 @@ void Scanner::handleCommentState() {
             state_ = State::kNone;
             return;
         }
+        if (directive) {
+            addToBuffer(current_char_);
+        }
         getNextChar();   
     }
+    if (directive) {
+        line_table_.parseDirective(buffer_);
+        buffer_.clear();
+    }
     if (current_char_ == '\r' && peekChar() == '\n') {
         getNextChar();
     }
@@ -196,71 +264,259 @@ bool VirtualMachine::error_flag_ = false;
 VirtualMachine::VirtualMachine(const std::string& code)
     : scanner_(code), 
       global_mem_(64, 0), 
-      tmp_mem_(64, 0) {
+      tmp_mem_(64, 0),
+      sampled_pc_(-1),
+      halted_(false),
+      metrics_(std::make_unique<Metrics>()),
+      count_metrics_(false),
+      running_(false),
+      start_cpu_time_(0) {
     memset(registers_, 0, sizeof(registers_));
     scanner_.getNextToken();
 }
 
+VirtualMachine::~VirtualMachine() {
+}
+
+void VirtualMachine::enableProfiling(const std::string& json_file) {
+    profiler_ = std::make_unique<Profiler>();
+    profile_file_ = json_file;
+}
+
+void VirtualMachine::enableMetrics(const std::string& file) {
+    count_metrics_ = true;
+    metrics_file_ = file;
+}
+
+Metrics VirtualMachine::metrics() const {
+    Metrics snapshot = *metrics_;
+    snapshot.instructions_retired = 0;
+    for (int i = 0; i < kOpcodeCount; ++i) {
+        snapshot.instructions_retired += snapshot.opcode_counts[i];
+    }
+    if (running_) {
+        snapshot.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+        snapshot.cpu_seconds = cpuSeconds() - start_cpu_time_;
+    }
+    return snapshot;
+}
+
+bool VirtualMachine::dumpMetrics(const std::string& file) const {
+    if (!writeMetrics(file, metrics())) {
+        std::cerr << "Can not write metrics to " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void VirtualMachine::enableTracing(size_t entries) {
+    tracer_ = std::make_unique<Tracer>(entries);
+}
+
+void VirtualMachine::enableSampling(int frequency, const std::string& folded_file) {
+    sampler_ = std::make_unique<Sampler>(frequency);
+    sample_file_ = folded_file;
+}
+
 void VirtualMachine::run() {
     registers_[kPc] = 1;
+    metrics_->clear();
+    start_time_ = std::chrono::steady_clock::now();
+    start_cpu_time_ = cpuSeconds();
+    running_ = true;
+
+    int mode = kExecutePlain;
+    if (profiler_) {
+        profiler_->reset(instructions_.empty() ? 0 : instructions_.rbegin()->first);
+        mode |= kExecuteProfile;
+    }
+    if (sampler_ && sampler_->start(&sampled_pc_)) {
+        mode |= kExecuteSample;
+    }
+
+    if (tracer_) {
+        mode |= kExecuteTrace;
+        tracer_->installSignalHandlers();
+    }
+    struct sigaction old_usr1_action;
+    if (count_metrics_) {
+        mode |= kExecuteMetrics;
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = &handleMetricsSignal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, &old_usr1_action);
+    }
+
+    typedef void (VirtualMachine::*Executor)();
+    static const Executor executors[] = {
+        &VirtualMachine::execute<0>,
+        &VirtualMachine::execute<1>,
+        &VirtualMachine::execute<2>,
+        &VirtualMachine::execute<3>,
+        &VirtualMachine::execute<4>,
+        &VirtualMachine::execute<5>,
+        &VirtualMachine::execute<6>,
+        &VirtualMachine::execute<7>,
+        &VirtualMachine::execute<8>,
+        &VirtualMachine::execute<9>,
+        &VirtualMachine::execute<10>,
+        &VirtualMachine::execute<11>,
+        &VirtualMachine::execute<12>,
+        &VirtualMachine::execute<13>,
+        &VirtualMachine::execute<14>,
+        &VirtualMachine::execute<15>,
+    };
+    static_assert(sizeof(executors) / sizeof(executors[0]) == kExecuteModeCount, "missing executor");
+    halted_ = false;
+    (this->*executors[mode])();
+
+    metrics_->wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    metrics_->cpu_seconds = cpuSeconds() - start_cpu_time_;
+    running_ = false;
+    if (mode & kExecuteMetrics) {
+        sigaction(SIGUSR1, &old_usr1_action, nullptr);
+        if (!metrics_file_.empty()) {
+            dumpMetrics(metrics_file_);
+        }
+    }
+
+    if (mode & kExecuteTrace) {
+        tracer_->removeSignalHandlers();
+        if (halted_) {
+            tracer_->dump(STDERR_FILENO, "halt");
+        }
+    }
+    if (mode & kExecuteSample) {
+        finishSampling();
+    }
+    if (mode & kExecuteProfile) {
+        finishProfiling();
+    }
+}
+
+void VirtualMachine::finishProfiling() {
+    profiler_->printReport(std::cerr, instructions_);
+    profiler_->printSourceReport(std::cerr, lineTable());
+    if (!profile_file_.empty() && !profiler_->writeJson(profile_file_, instructions_, lineTable())) {
+        std::cerr << "Can not write profile to " << profile_file_ << std::endl;
+    }
+}
+
+void VirtualMachine::finishSampling() {
+    sampler_->stop();
+    sampled_pc_.store(-1, std::memory_order_relaxed);
+    sampler_->printReport(std::cerr, instructions_, lineTable());
+    if (!sample_file_.empty() && !sampler_->writeFolded(sample_file_, instructions_, lineTable())) {
+        std::cerr << "Can not write samples to " << sample_file_ << std::endl;
+    }
+}
+
+// Every execution mode gets its own instantiation, so the hooks of the modes
+// which are turned off are compiled out of the dispatch loop.
+template <int kMode>
+void VirtualMachine::execute() {
     int running = true;
 
-    while (running && static_cast<size_t>(registers_[kPc]) < instructions_.size()) {
-        InstructionPtr& ins = instructions_[registers_[kPc]];
+    while (running && static_cast<size_t>(registers_[kPc]) <= instructions_.size()) {
+        int pc = registers_[kPc];
+        if (kMode & kExecuteSample) {
+            sampled_pc_.store(pc, std::memory_order_relaxed);
+        }
+        InstructionPtr& ins = instructions_[pc];
+        if (!ins) {
+            trap<kMode>(pc, "no instruction at pc " + std::to_string(pc));
+            return;
+        }
         if (!checkRegisterNumber(ins->param1) || !checkRegisterNumber(ins->param3)) {
+            trap<kMode>(pc, "invalid register number in " + ins->name);
             return;   
         }
+        int address = 0;
+        if (kMode & kExecuteTrace) {
+            address = ins->param2 + registers_[ins->param3];
+        }
         switch (ins->token_value) {
             case TokenValue::kHalt: {
                 running = false;
+                halted_ = true;
                 break;
             }
 
             case TokenValue::kIn: {
                 std::cin >> registers_[ins->param1];
+                if (kMode & kExecuteMetrics) {
+                    ++metrics_->in_count;
+                    metrics_->in_bytes += decimalLength(registers_[ins->param1]);
+                }
                 break;
             }
 
             case TokenValue::kOut: {
                 std::cout << registers_[ins->param1] << std::endl;
+                if (kMode & kExecuteMetrics) {
+                    ++metrics_->out_count;
+                    metrics_->out_bytes += decimalLength(registers_[ins->param1]) + 1;
+                }
                 break;
             }
 
             case TokenValue::kAdd: {
                 if (!checkRegisterNumber(ins->param2)) {
+                    trap<kMode>(pc, "invalid register number in " + ins->name);
                     return;   
                 }
-                registers_[ins->param1] = registers_[ins->param2] + registers_[ins->param3];
+                registers_[ins->param1] = wrap(static_cast<uint32_t>(registers_[ins->param2]) +
+                                               static_cast<uint32_t>(registers_[ins->param3]));
                 break;
             }
 
             case TokenValue::kSub: {
                 if (!checkRegisterNumber(ins->param2)) {
+                    trap<kMode>(pc, "invalid register number in " + ins->name);
                     return;   
                 }
-                registers_[ins->param1] = registers_[ins->param2] - registers_[ins->param3];
+                registers_[ins->param1] = wrap(static_cast<uint32_t>(registers_[ins->param2]) -
+                                               static_cast<uint32_t>(registers_[ins->param3]));
                 break;
             }
 
             case TokenValue::kMul: {
                 if (!checkRegisterNumber(ins->param2)) {
+                    trap<kMode>(pc, "invalid register number in " + ins->name);
                     return;   
                 }
-                registers_[ins->param1] = registers_[ins->param2] * registers_[ins->param3];
+                registers_[ins->param1] = wrap(static_cast<uint32_t>(registers_[ins->param2]) *
+                                               static_cast<uint32_t>(registers_[ins->param3]));
                 break;
             }
 
             case TokenValue::kDiv: {
                 if (!checkRegisterNumber(ins->param2)) {
+                    trap<kMode>(pc, "invalid register number in " + ins->name);
                     return;   
                 }
+                if (registers_[ins->param3] == 0) {
+                    trap<kMode>(pc, "division by zero");
+                    return;
+                }
+                if (registers_[ins->param2] == INT_MIN && registers_[ins->param3] == -1) {
+                    trap<kMode>(pc, "division overflow");
+                    return;
+                }
                 registers_[ins->param1] = registers_[ins->param2] / registers_[ins->param3];
                 break;
             }
 
             case TokenValue::kLd: {
                 bool tmp_mem = (ins->param3 == kMp) ? true : false;
-                registers_[ins->param1] = loadMemory(ins->param2 + registers_[ins->param3], tmp_mem);
+                int index = ins->param2 + registers_[ins->param3];
+                if (index < 0) {
+                    trap<kMode>(pc, "load from negative address " + std::to_string(index));
+                    return;
+                }
+                registers_[ins->param1] = loadMemory(index, tmp_mem);
                 break;
             }
 
@@ -276,7 +532,19 @@ void VirtualMachine::run() {
 
             case TokenValue::kSt: {
                 bool tmp_mem = (ins->param3 == kMp) ? true : false;
-                pushMemory(ins->param2 + registers_[ins->param3], registers_[ins->param1], tmp_mem);
+                int index = ins->param2 + registers_[ins->param3];
+                if (index < 0) {
+                    trap<kMode>(pc, "store to negative address " + std::to_string(index));
+                    return;
+                }
+                pushMemory(index, registers_[ins->param1], tmp_mem);
+                if (kMode & kExecuteMetrics) {
+                    uint64_t& high_water = tmp_mem ? metrics_->tmp_memory_high_water 
+                                                   : metrics_->global_memory_high_water;
+                    if (static_cast<uint64_t>(index) >= high_water) {
+                        high_water = static_cast<uint64_t>(index) + 1;
+                    }
+                }
                 break;
             }
 
@@ -323,13 +591,38 @@ void VirtualMachine::run() {
             }
 
             default: {
-                std::cerr << "Invalid instruction: " << ins->name << std::endl;
-                running = false;
-                break;
+                trap<kMode>(pc, "invalid instruction " + ins->name);
+                return;
             }
         }
 
         ++registers_[kPc];
+        if (kMode & kExecuteTrace) {
+            tracer_->record(pc, *ins, address, registers_);
+        }
+        if (kMode & kExecuteMetrics) {
+            ++metrics_->opcode_counts[opcodeIndex(ins->token_value)];
+            if (g_metrics_requested) {
+                g_metrics_requested = 0;
+                if (!metrics_file_.empty()) {
+                    dumpMetrics(metrics_file_);
+                } else {
+                    writeMetrics(std::cerr, metrics(), MetricsFormat::kPrometheus);
+                }
+            }
+        }
+        if (kMode & kExecuteProfile) {
+            profiler_->record(pc, ins->token_value, registers_[kPc]);
+        }
+    }
+}
+
+template <int kMode>
+void VirtualMachine::trap(int pc, const std::string& message) {
+    ++metrics_->traps;
+    std::cerr << "vm Runtime Error: pc " << pc << ": " << message << std::endl;
+    if (kMode & kExecuteTrace) {
+        tracer_->dump(STDERR_FILENO, "trap");
     }
 }
 
@@ -465,15 +758,10 @@ void VirtualMachine::errorReport(const std::string& message) {
 }
     
 bool VirtualMachine::checkRegisterNumber(int num) {
-    if (num < 0 || num >= kRegisterCount) {
-        std::cerr << "invalid register number '" << num << "'" << std::endl;
-        return false;   
-    }
-    return true;
+    return num >= 0 && num < kRegisterCount;
 }
 
 void VirtualMachine::pushMemory(int index, int val, bool tmp_mem) {
-    assert(index >= 0);
     if (tmp_mem) {
         if (static_cast<size_t>(index) >= tmp_mem_.size()) {
             tmp_mem_.resize(static_cast<size_t>(2 * index));
@@ -487,13 +775,13 @@ void VirtualMachine::pushMemory(int index, int val, bool tmp_mem) {
     }
 }
 
+// memory which was never stored to reads as 0
 int VirtualMachine::loadMemory(int index, bool tmp_mem) {
-    assert(index >= 0);
-    if (tmp_mem) {
-        return tmp_mem_[static_cast<size_t>(index)];   
-    } else {
-        return global_mem_[static_cast<size_t>(index)];
+    const std::vector<int>& mem = tmp_mem ? tmp_mem_ : global_mem_;
+    if (static_cast<size_t>(index) >= mem.size()) {
+        return 0;
     }
+    return mem[static_cast<size_t>(index)];
 }
 
 void VirtualMachine::printInstructions() const {
@@ -8,6 +8,10 @@
 #include <map>
 #include <unordered_map>
 #include <memory>
+#include <atomic>
+#include <chrono>
+
+#include "line_table.h"
 
 namespace nova {
 
@@ -58,6 +62,9 @@ enum class TokenValue {
     kUnReserved,
 };
 
+// mnemonic of an instruction token value, "???" for anything else
+const char* opcodeName(TokenValue value);
+
 struct Token {
     Token(const std::string& name, TokenValue value, TokenType type)
         : token_name(name), 
@@ -93,6 +100,9 @@ public:
 
     Token getToken() const { return token_; }
 
+    // collected from the *.file and *.loc comment directives of the listing
+    const LineTable& lineTable() const { return line_table_; }
+
     static bool getErrorFlag() { return error_flag_; }
     static void setErrorFlag(bool flag) { error_flag_ = flag; }
 
@@ -124,6 +134,7 @@ private:
     State state_;
     Token token_;
     char current_char_;
+    LineTable line_table_;
 
     static bool error_flag_;
 };
@@ -147,6 +158,12 @@ struct Instruction {
 };
 
 typedef std::unique_ptr<Instruction> InstructionPtr;
+typedef std::map<int, InstructionPtr> InstructionList;
+
+class Profiler;
+class Sampler;
+class Tracer;
+struct Metrics;
 
 class VirtualMachine {
 public:
@@ -155,6 +172,7 @@ public:
     static const int kMp = 6;
 
     explicit VirtualMachine(const std::string& code);
+    ~VirtualMachine();
     VirtualMachine(const VirtualMachine&) = delete;
     VirtualMachine& operator=(const VirtualMachine&) = delete;
 
@@ -162,10 +180,50 @@ public:
     void run();
     void printInstructions() const;  // for debug
 
+    // Count executions per pc, branch outcomes and backward branches. The report
+    // is printed to stderr when the program halts, and written as json to
+    // json_file unless it is empty.
+    void enableProfiling(const std::string& json_file = std::string());
+
+    // Sample the pc with a SIGPROF timer at frequency Hz. The histogram is
+    // printed to stderr when the program halts, folded stacks for flamegraph
+    // tooling are written to folded_file unless it is empty.
+    void enableSampling(int frequency = 1000, const std::string& folded_file = std::string());
+
+    // Keep the last entries executed instructions in a ring buffer which is
+    // dumped to stderr on halt, on a runtime trap and on fatal signals.
+    void enableTracing(size_t entries = 64);
+
+    // Count retired instructions per opcode, memory high-water marks and
+    // IN/OUT traffic. The metrics are written to file (prometheus text, or
+    // json for a .json name) when the program exits and whenever the process
+    // receives SIGUSR1. Traps and run time are counted in every mode.
+    void enableMetrics(const std::string& file = std::string());
+    Metrics metrics() const;
+    bool dumpMetrics(const std::string& file) const;
+
+    const LineTable& lineTable() const { return scanner_.lineTable(); }
+
     static bool getErrorFlag() { return error_flag_; }
     static void setErrorFlag(bool flag) { error_flag_ = flag; }
 
 private:
+    enum ExecutionMode {
+        kExecutePlain = 0,
+        kExecuteProfile = 1,
+        kExecuteSample = 2,
+        kExecuteTrace = 4,
+        kExecuteMetrics = 8,
+        kExecuteModeCount = 16,
+    };
+
+    template <int kMode>
+    void execute();
+    template <int kMode>
+    void trap(int pc, const std::string& message);
+    void finishProfiling();
+    void finishSampling();
+
     bool isEndOfFile() const;
     void handleCodeLine();
     
@@ -180,13 +238,24 @@ private:
     int loadMemory(int index, bool tmp_mem);
 
 private:
-    typedef std::map<int, InstructionPtr> InstructionList;
-
     Scanner scanner_;
     InstructionList instructions_;
     int registers_[kRegisterCount];
     std::vector<int> global_mem_;
     std::vector<int> tmp_mem_;
+    std::unique_ptr<Profiler> profiler_;
+    std::string profile_file_;
+    std::unique_ptr<Sampler> sampler_;
+    std::string sample_file_;
+    std::atomic<int> sampled_pc_;
+    std::unique_ptr<Tracer> tracer_;
+    bool halted_;
+    std::unique_ptr<Metrics> metrics_;
+    bool count_metrics_;
+    std::string metrics_file_;
+    bool running_;
+    std::chrono::steady_clock::time_point start_time_;
+    double start_cpu_time_;
 
     static bool error_flag_;
 };
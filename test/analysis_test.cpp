@@ -6,6 +6,7 @@ int main(int argc, char* argv[]) {
     nova::Scanner scanner("test.tiny");
     nova::Parser parser(scanner);
     nova::Analysis analysis(parser.parse());
+    analysis.setRecordLocations(true);
     analysis.buildSymbolTable();
     analysis.typeCheck();
     analysis.printSymbolTable();
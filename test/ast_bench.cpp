@@ -0,0 +1,100 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include "parser.h"
+#include "compiler.h"
+#include "analysis.h"
+#include "ast_visitor.h"
+#include "flat_ast.h"
+
+using namespace nova;
+
+class NodeCounter : public AstVisitor<NodeCounter> {
+public:
+    NodeCounter() : count(0) {}
+    void visitConstant(ConstantAstPtr) { ++count; }
+    void visitVariable(VariableAstPtr) { ++count; }
+    void visitExpression(ExpressionAstPtr) { ++count; }
+    size_t count;
+};
+
+class FlatNodeCounter : public FlatAstVisitor<FlatNodeCounter> {
+public:
+    explicit FlatNodeCounter(const FlatAst& ast) : FlatAstVisitor<FlatNodeCounter>(ast), count(0) {}
+    void visitConstant(NodeId) { ++count; }
+    void visitVariable(NodeId) { ++count; }
+    void visitExpression(NodeId) { ++count; }
+    size_t count;
+};
+
+template<typename Func>
+double measure(int rounds, Func func) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        func();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / rounds;
+}
+
+// usage: ast_bench [file] [rounds]
+int main(int argc, char* argv[]) {
+    std::string file_name = argc > 1 ? argv[1] : "test.tiny";
+    int rounds = argc > 2 ? std::stoi(argv[2]) : 20;
+
+    // read once, every pass below works on the bytes in memory
+    std::ifstream file(file_name);
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    AstContext context;
+    Scanner scanner(file_name, source.data(), source.size());
+    Parser parser(scanner, context);
+    AstPtr root = parser.parse();
+    if (Parser::getErrorFlag()) {
+        return 1;
+    }
+    FlatAst flat(root);
+
+    size_t pointer_count = 0;
+    size_t flat_count = 0;
+    double pointer_walk = measure(rounds, [&]() {
+        NodeCounter counter;
+        counter.traverse(root);
+        pointer_count = counter.count;
+    });
+    double flat_walk = measure(rounds, [&]() {
+        FlatNodeCounter counter(flat);
+        counter.traverse(flat.root());
+        flat_count = counter.count;
+    });
+    double pointer_analysis = measure(rounds, [&]() {
+        Analysis analysis(root);
+        analysis.buildSymbolTable();
+        analysis.typeCheck();
+    });
+    double fused_analysis = measure(rounds, [&]() {
+        Analysis analysis(root);
+        analysis.analyze();
+    });
+    double flat_analysis = measure(rounds, [&]() {
+        Analysis analysis(flat);
+        analysis.buildSymbolTable();
+        analysis.typeCheck();
+    });
+
+    bool compiled = true;
+    double compile = measure(rounds, [&]() {
+        std::ostringstream code;
+        compiled = compileSource(file_name, source.data(), source.size(), CompileOptions(), code) && compiled;
+    });
+
+    std::cout << file_name << ": " << flat.size() << " nodes" << std::endl;
+    std::cout << "layout    bytes      walk ms   analysis ms" << std::endl;
+    std::cout << "pointer   " << context.bytesAllocated() << "   " << pointer_walk << "   " << pointer_analysis << std::endl;
+    std::cout << "flat      " << flat.bytesUsed() << "   " << flat_walk << "   " << flat_analysis << std::endl;
+    std::cout << "fused analysis " << fused_analysis << " ms" << std::endl;
+    std::cout << "compile   " << compile << " ms from memory" << std::endl;
+    return pointer_count == flat_count && compiled ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#include "compiler.h"
+#include "ir.h"
+#include "test_support.h"
+#include "tm_lowering.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Instruction {
+    int address;
+    std::string op;
+    std::string operands;
+};
+
+// the instructions of a TM listing by address, the streaming generator
+// emits the jumps it backpatches out of order
+std::vector<Instruction> instructions(const std::string& code) {
+    std::vector<Instruction> result;
+    std::istringstream is(code);
+    for (std::string line; std::getline(is, line);) {
+        if (line.empty() || !isdigit(static_cast<unsigned char>(line[0]))) {
+            continue;
+        }
+        std::istringstream fields(line);
+        Instruction ins;
+        char colon = 0;
+        fields >> ins.address >> colon >> ins.op >> ins.operands;
+        result.push_back(ins);
+    }
+    std::sort(result.begin(), result.end(), [](const Instruction& a, const Instruction& b) {
+        return a.address < b.address;
+    });
+    return result;
+}
+
+// The code branches once, with jump right after the SUB of the operands of
+// the comparison, on the register it wrote. A comparison leaving 0 or 1
+// branches itself to the LDC 0/LDC 1, so this rules those out.
+bool branchesOnDifference(const std::string& code, const std::string& jump) {
+    std::vector<Instruction> listing = instructions(code);
+    int branches = 0;
+    bool after_sub = false;
+    for (size_t i = 0; i < listing.size(); ++i) {
+        const std::string& op = listing[i].op;
+        if (op.size() != 3 || op[0] != 'J') {
+            continue;
+        }
+        ++branches;
+        after_sub = i > 0 && op == jump && listing[i - 1].op == "SUB" &&
+                    listing[i - 1].operands.substr(0, 2) == listing[i].operands.substr(0, 2);
+    }
+    return branches == 1 && after_sub;
+}
+
+std::string compile(const std::string& program, bool stream) {
+    nova::CompileOptions options;
+    options.stream = stream;
+    options.optimize = false;  // the constants would fold the comparison away
+    std::ostringstream code;
+    if (!nova::compileSource("<program>", program.data(), program.size(), options, code)) {
+        return std::string();
+    }
+    return code.str();
+}
+
+// Compiles the program with the streaming generator and through the IR,
+// both branch with jump on the difference and write expected.
+void testProgram(nova::test::Checks& checks, const std::string& program, const std::string& jump,
+                 const std::string& expected) {
+    std::cout << program << std::endl;
+    for (bool stream : {true, false}) {
+        std::string code = compile(program, stream);
+        bool branches = checks.check(branchesOnDifference(code, jump));
+        std::string output = nova::test::runCode(code).output;
+        bool same = checks.check(output == expected);
+        std::cout << "    " << (stream ? "streaming" : "lowering") << ": " << (branches ? jump : "no " + jump)
+                  << " after SUB, " << (same ? "expected output" : "unexpected output") << std::endl;
+    }
+}
+
+// A branch whose false target comes next, the lowering jumps to the true
+// target with the jump taken on the comparison itself.
+void testJumpIfTrue(nova::test::Checks& checks, const char* op, int left, int right, bool taken) {
+    std::ostringstream text;
+    text << "vars\n"
+            "ssa\n"
+            "b0:\n"
+            "    v0 = const " << left << "\n"
+            "    v1 = const " << right << "\n"
+            "    v2 = " << op << " v0 v1\n"
+            "    branch v2 b1 b2\n"
+            "b2: preds b0\n"
+            "    v3 = const 9\n"
+            "    write v3\n"
+            "    halt\n"
+            "b1: preds b0\n"
+            "    v4 = const 7\n"
+            "    write v4\n"
+            "    halt\n";
+    std::istringstream is(text.str());
+    nova::ir::Function function((std::vector<std::string>()));
+    std::string error;
+    std::string jump = strcmp(op, "lt") == 0 ? "JLT" : "JEQ";
+    std::cout << op << " " << left << " " << right << std::endl;
+    if (!checks.check(nova::ir::Function::parse(is, &function, &error))) {
+        std::cout << "    " << error << std::endl;
+        return;
+    }
+    std::string code = nova::ir::TmLowering(function, "<function>").generateCode();
+    bool branches = checks.check(branchesOnDifference(code, jump));
+    bool same = checks.check(nova::test::runCode(code).output == (taken ? "7\n" : "9\n"));
+    std::cout << "    lowering: " << (branches ? jump : "no " + jump) << " after SUB, "
+              << (same ? "expected output" : "unexpected output") << std::endl;
+}
+
+std::string str(int value) {
+    std::ostringstream os;
+    os << value;
+    return os.str();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    nova::test::Checks checks;
+    // operands on both sides of the boundary of each comparison
+    const std::pair<int, int> operands[] = {{4, 5}, {5, 5}, {6, 5}, {0, 0}, {0, 1}, {1, 0}};
+    for (const std::pair<int, int>& pair : operands) {
+        std::string assign = "x := " + str(pair.first) + "; y := " + str(pair.second) + ";\n";
+        testProgram(checks, assign + "if x < y then write 7 else write 9 end",
+                    "JGE", pair.first < pair.second ? "7\n" : "9\n");
+        testProgram(checks, assign + "if x = y then write 7 else write 9 end",
+                    "JNE", pair.first == pair.second ? "7\n" : "9\n");
+    }
+    // the loop runs until x reaches 0 exactly, from 1 once
+    for (int start : {1, 2, 3}) {
+        std::string expected;
+        for (int x = start; x != 0; --x) {
+            expected += str(x) + "\n";
+        }
+        testProgram(checks, "x := " + str(start) + ";\nrepeat write x; x := x - 1 until x = 0",
+                    "JNE", expected);
+        testProgram(checks, "x := " + str(start) + ";\nrepeat write x; x := x - 1 until x < 1",
+                    "JGE", expected);
+    }
+    for (const std::pair<int, int>& pair : operands) {
+        testJumpIfTrue(checks, "lt", pair.first, pair.second, pair.first < pair.second);
+        testJumpIfTrue(checks, "eq", pair.first, pair.second, pair.first == pair.second);
+    }
+    return checks.exitCode();
+}
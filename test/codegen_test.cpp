@@ -1,7 +1,12 @@
 #include "codegen.h"
 #include "parser.h"
+#include "compiler.h"
+#include "test_support.h"
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 int main(int argc, char* argv[]) {
     nova::Scanner scanner("test.tiny");
@@ -13,5 +18,28 @@ int main(int argc, char* argv[]) {
     nova::CodeGenerator generator(analysis, root, "test.tiny", true);
     nova::CodeBuffer code =  generator.generateCode();
     std::cout << code;
-    return 0;
+
+    // the compiler goes through the IR, its code writes what the AST
+    // generator's does, and reading the source from a stream changes nothing
+    std::ifstream file("test.tiny");
+    std::ostringstream source;
+    source << file.rdbuf();
+    std::string text = source.str();
+    nova::test::Checks checks;
+    nova::CompileOptions options;
+    options.jobs = 1;
+    std::ostringstream from_memory;
+    bool compiled = nova::compileSource("test.tiny", text.data(), text.size(), options, from_memory);
+    std::istringstream is(text);
+    std::ostringstream from_stream;
+    compiled = nova::compileSource("test.tiny", is, options, from_stream) && compiled;
+    bool same_code = checks.check(compiled && from_stream.str() == from_memory.str());
+    std::cout << "Compile from a stream: " << (same_code ? "same code" : "different code") << std::endl;
+    // 13! wraps around
+    for (const char* input : {"0", "1", "5", "12", "13", "-3"}) {
+        std::string expected = nova::test::runCode(code, input).output;
+        bool same = checks.check(nova::test::runCode(from_memory.str(), input).output == expected);
+        std::cout << "Input " << input << ": " << (same ? "same output" : "different output") << std::endl;
+    }
+    return checks.exitCode();
 }
@@ -0,0 +1,122 @@
+#include "analysis.h"
+#include "compiler.h"
+#include "dead_code.h"
+#include "error.h"
+#include "file_table.h"
+#include "parser.h"
+#include "simplifier.h"
+#include "test_support.h"
+
+#include <string.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// A program and its statements after the simplifier and dead code
+// elimination, which removed that many statements. The programs do not
+// read, their writes show what the removal kept.
+struct Case {
+    const char* program;
+    const char* eliminated;
+    size_t removed;
+};
+
+const Case kCases[] = {
+    // an if on a constant becomes the branch it takes
+    {"x := 1; if 1 < 2 then write x else write 0 - x end",
+     "x := 1; write x", 1},
+    {"x := 1; if 2 < 1 then write x end; write 2",
+     "write 2", 2},
+    // a repeat whose test is true runs its body once
+    {"x := 3; repeat write x; x := x - 1 until 1 = 1; write x",
+     "x := 3; write x; x := x - 1; write x", 1},
+    // dead stores, and the stores only read by them
+    {"x := 1; y := 2; x := 3; write x",
+     "x := 3; write x", 2},
+    {"x := 1; y := x + 1; z := y * 2; write x",
+     "x := 1; write x", 2},
+    // a dead store that can trap stays
+    {"x := 0; y := 1 / x; write 1",
+     "x := 0; y := 1 / x; write 1", 0},
+    // the values used by a later iteration or after the loop stay
+    {"x := 0; repeat x := x + 1 until x = 3; write x",
+     "x := 0; repeat x := x + 1 until x = 3; write x", 0},
+    {"x := 5; y := 0; repeat y := y + x; x := x - 1 until x = 0; write y",
+     "x := 5; y := 0; repeat y := y + x; x := x - 1 until x = 0; write y", 0},
+    {"x := 5; y := 0; repeat t := y; y := t + x; x := x - 1; u := y until x = 0; write u",
+     "x := 5; y := 0; repeat t := y; y := t + x; x := x - 1; u := y until x = 0; write u", 0},
+    // both ifs are left empty
+    {"x := 2; if x < 3 then y := 1 else y := 2 end; if x = 2 then z := y end; write x",
+     "x := 2; write x", 5},
+    // y may be read without this if assigning it
+    {"x := 2; if x < 3 then y := 1 end; write y",
+     "x := 2; if x < 3 then y := 1 end; write y", 0},
+    // a store in a loop that no iteration reads
+    {"x := 3; repeat d := x * 2; x := x - 1 until x = 0; write x",
+     "x := 3; repeat x := x - 1 until x = 0; write x", 1},
+};
+
+// the program after the simplifier and dead code elimination alone, the
+// variables dead at its end
+std::string eliminate(const char* program, size_t* removed) {
+    nova::clearErrorFlags();
+    nova::Scanner scanner("<program>", std::string(program));
+    nova::AstContext context;
+    nova::Parser parser(scanner, context);
+    nova::AstPtr root = parser.parse();
+    nova::Analysis analysis(root);
+    analysis.useSymbolTable(parser.symbolTable());
+    nova::Simplifier simplifier(context);
+    analysis.analyze(simplifier);
+    nova::DeadCodeEliminator eliminator(parser.symbolTable());
+    root = eliminator.eliminate(root, false);
+    *removed = eliminator.removed();
+    std::string text = nova::test::sourceText(root);
+    nova::FileTable::instance().remove(scanner.fileId());
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    using nova::test::runCode;
+    using nova::test::instructionCount;
+    nova::test::Checks checks;
+    for (const Case& test_case : kCases) {
+        const char* program = test_case.program;
+        size_t removed = 0;
+        std::string eliminated = eliminate(program, &removed);
+        bool expected = checks.check(eliminated == test_case.eliminated && removed == test_case.removed);
+
+        // the whole compiler, through the IR and streaming, writes what the
+        // plain one does, with less code when statements were removed
+        nova::CompileOptions options;
+        options.jobs = 1;
+        options.optimize = false;
+        std::ostringstream plain;
+        bool compiled = nova::compileSource("<program>", program, strlen(program), options, plain);
+        options.optimize = true;
+        std::ostringstream optimized;
+        compiled = nova::compileSource("<program>", program, strlen(program), options, optimized) && compiled;
+        options.stream = true;
+        std::ostringstream streamed;
+        compiled = nova::compileSource("<program>", program, strlen(program), options, streamed) && compiled;
+
+        nova::test::VmRun before = runCode(plain.str());
+        nova::test::VmRun after = runCode(optimized.str());
+        bool same = checks.check(compiled && after.output == before.output &&
+                                 runCode(streamed.str()).output == before.output);
+        bool shrunk = checks.check(test_case.removed == 0 ||
+                                   instructionCount(optimized.str()) < instructionCount(plain.str()));
+        std::cout << program << "\n    " << eliminated << "\n    " << (expected ? "expected" : "unexpected")
+                  << ", removed " << removed << ", " << (same ? "same output" : "different output") << ", "
+                  << (shrunk ? "" : "not shrunk, ")
+                  << instructionCount(plain.str()) << " -> " << instructionCount(optimized.str())
+                  << " instructions, " << before.instructions << " -> " << after.instructions
+                  << " executed" << std::endl;
+    }
+    return checks.exitCode();
+}
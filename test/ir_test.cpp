@@ -0,0 +1,259 @@
+#include "analysis.h"
+#include "compiler.h"
+#include "dominators.h"
+#include "error.h"
+#include "file_table.h"
+#include "ir.h"
+#include "ir_builder.h"
+#include "licm.h"
+#include "loops.h"
+#include "parser.h"
+#include "ssa.h"
+#include "test_support.h"
+#include "tm_lowering.h"
+#include "value_numbering.h"
+
+#include <string.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace {
+
+// none of them reads
+const char* kPrograms[] = {
+    "x := 3; y := 0; repeat y := y + x; x := x - 1 until x = 0; write y",
+    "x := 2; if x < 3 then y := 1 else y := 2 end; write y",
+    "x := 2; if x < 3 then y := x end; write y",
+    "write x; x := 5; write x",
+    "i := 3; repeat j := 2; repeat s := s + i * j; j := j - 1 until j = 0; i := i - 1 until i = 0; write s",
+    "a := 1; b := 2; n := 5; repeat t := a; a := b; b := t; n := n - 1 until n = 0; write a; write b",
+    "x := 1; repeat if x < 4 then x := x * 2 else x := x + 1 end until 10 < x; write x",
+    "x := 0; repeat x := x + 1 until 1 = 1; write x / (x - 1); write x",
+    "if 1 < 2 then write 1 end; repeat write 2 until 0 = 0; if 2 < 1 then write 3 else write 4 end",
+    "a := 1; b := 2; c := 3; d := 4; n := 4; "
+    "repeat a := (a + b) * (c - d) + (d - a) * ((b + c) - (a * (d + n))); b := b + a / 7; c := c - b; d := d + c; "
+    "n := n - 1 until n = 0; write a; write b; write c; write d",
+};
+
+// computations repeated within a block, in the blocks a block dominates,
+// and after an assignment to one of their operands, which must not reuse
+const char* kRedundant[] = {
+    "a := 2; b := 3; x := a * b + b * a; write x; write a * b",
+    "x := 7; y := x - 1; repeat write x - 1; x := x - 1 until x - 1 < 1; write x - 1; write y",
+    "x := 5; y := 2; if y < x then write x / y end; write x / y; y := x; write x / y",
+    "x := 6; y := x + 1; if y < 3 then y := x + 1 else write x + 1; x := 1 end; write x + 1; write y",
+};
+
+// computations that do not change within a loop, one loop entered by a
+// branch and one after an if, which need a new preheader, a division that
+// may trap, and nested loops
+const char* kInvariant[] = {
+    "a := 3; b := 4; i := 5; repeat s := s + a * b + i * (a - b); i := i - 1 until i = 0; write s",
+    "a := 3; i := 5; if a < 4 then i := 2 end; repeat s := s + a * a; i := i - 1 until i = 0; write s",
+    "a := 3; repeat i := 2; repeat s := s + (a + 1) * (a - 1); i := i - 1 until i = 0; a := a - 1 until a = 0; write s",
+    "a := 0; i := 3; repeat if i < 2 then s := s + 6 / a end; s := s + a / 2; i := i - 1 until i = 0; write s",
+    "n := 3; i := n; repeat j := n; repeat s := s + i * (n * n) + j * (n - 1); j := j - 1 until j = 0; "
+    "i := i - 1 until i = 0; write s",
+};
+
+// Two values swapped on every trip around a loop whose back edge is
+// critical, destructSsa() has to split it and break the cycle.
+const char* kSwap =
+    "vars\n"
+    "ssa\n"
+    "b0:\n"
+    "    v0 = const 1\n"
+    "    v1 = const 2\n"
+    "    v2 = const 3\n"
+    "    jump b1\n"
+    "b1: preds b0 b1\n"
+    "    v3 = phi b0:v0 b1:v4\n"
+    "    v4 = phi b0:v1 b1:v3\n"
+    "    v5 = phi b0:v2 b1:v7\n"
+    "    write v3\n"
+    "    v6 = const 1\n"
+    "    v7 = sub v5 v6\n"
+    "    branch v7 b1 b2\n"
+    "b2: preds b1\n"
+    "    write v3\n"
+    "    write v4\n"
+    "    halt\n";
+
+// A loop entered by a branch and by another block, each with its own value
+// for the phi, hoistLoopInvariants() has to make a preheader merging them.
+const char* kEntered =
+    "vars\n"
+    "ssa\n"
+    "b0:\n"
+    "    v0 = const 2\n"
+    "    v1 = const 3\n"
+    "    v2 = lt v0 v1\n"
+    "    branch v2 b1 b2\n"
+    "b2: preds b0\n"
+    "    v3 = const 5\n"
+    "    jump b1\n"
+    "b1: preds b0 b2 b1\n"
+    "    v4 = phi b0:v0 b2:v3 b1:v7\n"
+    "    v5 = mul v1 v1\n"
+    "    write v5\n"
+    "    v6 = const 1\n"
+    "    v7 = sub v4 v6\n"
+    "    branch v7 b1 b3\n"
+    "b3: preds b1\n"
+    "    write v4\n"
+    "    halt\n";
+
+std::string dump(const nova::ir::Function& function) {
+    std::ostringstream os;
+    function.dump(os);
+    return os.str();
+}
+
+// dump -> parse -> dump gives the same text
+bool roundTrip(const nova::ir::Function& function) {
+    std::string text = dump(function);
+    std::istringstream is(text);
+    nova::ir::Function parsed((std::vector<std::string>()));
+    std::string error;
+    if (!nova::ir::Function::parse(is, &parsed, &error)) {
+        std::cout << "    parse: " << error << std::endl;
+        return false;
+    }
+    return dump(parsed) == text;
+}
+
+bool verify(const nova::ir::Function& function, const char* stage) {
+    std::string error;
+    if (!function.verify(&error)) {
+        std::cout << "    " << stage << ": " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void printDominators(const nova::ir::Function& function) {
+    nova::ir::DominatorTree dominators(function);
+    std::cout << "    idom:";
+    for (nova::ir::BlockId id : function.layout()) {
+        nova::ir::BlockId idom = dominators.idom(id);
+        std::cout << " b" << id << "<-" << (idom == nova::ir::kNoBlock ? std::string("entry") : "b" + std::to_string(idom));
+    }
+    std::cout << std::endl;
+}
+
+void printLoops(const nova::ir::Function& function) {
+    nova::ir::DominatorTree dominators(function);
+    for (const nova::ir::Loop& loop : nova::ir::findLoops(function, dominators)) {
+        std::cout << "    loop";
+        for (nova::ir::BlockId id : loop.blocks) {
+            std::cout << " b" << id;
+        }
+        std::cout << ", latches";
+        for (nova::ir::BlockId id : loop.latches) {
+            std::cout << " b" << id;
+        }
+        std::cout << std::endl;
+    }
+}
+
+void testProgram(nova::test::Checks& checks, const char* program, bool print, bool optimize) {
+    nova::clearErrorFlags();
+    nova::Scanner scanner("<program>", std::string(program));
+    nova::Parser parser(scanner);
+    nova::AstPtr root = parser.parse();
+    nova::Analysis analysis(root);
+    analysis.useSymbolTable(parser.symbolTable());
+    analysis.analyze();
+
+    nova::ir::Function function = nova::ir::IrBuilder(parser.symbolTable()).build(root);
+    bool ok = verify(function, "built");
+    nova::ir::constructSsa(function);
+    ok = verify(function, "ssa") && ok;
+    if (optimize) {
+        printLoops(function);
+        int removed = nova::ir::numberValues(function);
+        ok = verify(function, "numbered") && ok;
+        int hoisted = nova::ir::hoistLoopInvariants(function);
+        ok = verify(function, "hoisted") && ok;
+        std::cout << dump(function) << "    removed " << removed << ", hoisted " << hoisted << std::endl;
+    }
+    if (print) {
+        std::cout << dump(function);
+        printDominators(function);
+    }
+    bool same_text = roundTrip(function);
+    nova::ir::destructSsa(function);
+    ok = verify(function, "out of ssa") && ok;
+    same_text = roundTrip(function) && same_text;
+    std::string code = nova::ir::TmLowering(function, "<program>").generateCode();
+    nova::FileTable::instance().remove(scanner.fileId());
+
+    // the AST code generator of the streaming mode
+    nova::CompileOptions options;
+    options.stream = true;
+    options.optimize = false;
+    std::ostringstream reference;
+    ok = nova::compileSource("<program>", program, strlen(program), options, reference) && ok;
+    std::string output = nova::test::runCode(code).output;
+    bool same_output = output == nova::test::runCode(reference.str()).output;
+    checks.check(ok && same_text && same_output);
+    std::cout << program << "\n    " << (ok ? "verified" : "not verified") << ", "
+              << (same_text ? "same text" : "different text") << ", "
+              << (same_output ? "same output" : "different output") << std::endl;
+}
+
+// Parses the function, optionally hoists its loop invariants, takes it out
+// of SSA form and runs it, expecting the last word of each output line.
+void testFunction(nova::test::Checks& checks, const char* name, const char* text, bool hoist,
+                  const std::string& expected) {
+    std::istringstream is(text);
+    nova::ir::Function function((std::vector<std::string>()));
+    std::string error;
+    if (!nova::ir::Function::parse(is, &function, &error)) {
+        std::cout << name << ": " << error << std::endl;
+        checks.check(false);
+        return;
+    }
+    std::cout << name << std::endl;
+    bool ok = verify(function, "ssa") && roundTrip(function);
+    if (hoist) {
+        printLoops(function);
+        int hoisted = nova::ir::hoistLoopInvariants(function);
+        ok = verify(function, "hoisted") && ok;
+        std::cout << "    hoisted " << hoisted << std::endl;
+    }
+    nova::ir::destructSsa(function);
+    ok = verify(function, "out of ssa") && ok;
+    std::cout << dump(function);
+    std::string output = nova::test::runCode(nova::ir::TmLowering(function, name).generateCode()).output;
+    std::string values;
+    std::istringstream lines(output);
+    for (std::string line; std::getline(lines, line);) {
+        values += (values.empty() ? "" : " ") + line.substr(line.find_last_of(' ') + 1);
+    }
+    checks.check(ok && values == expected);
+    std::cout << "    " << (ok ? "verified" : "not verified") << ", output " << values << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    nova::test::Checks checks;
+    bool print = true;
+    for (const char* program : kPrograms) {
+        testProgram(checks, program, print, false);
+        print = false;
+    }
+    for (const char* program : kRedundant) {
+        testProgram(checks, program, false, true);
+    }
+    for (const char* program : kInvariant) {
+        testProgram(checks, program, false, true);
+    }
+    testFunction(checks, "swap", kSwap, false, "1 2 1 1 2");
+    testFunction(checks, "entered", kEntered, true, "9 9 1");
+    return checks.exitCode();
+}
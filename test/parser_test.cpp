@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "parser.h"
+#include "parallel_parser.h"
 
 using namespace nova;
 
@@ -17,7 +18,7 @@ void printTree(AstPtr root, int& count) {
         printSpace(count);
         switch (root->getAstType()) {
             case AstType::kIf: {
-                IfStatementAstPtr ptr = std::dynamic_pointer_cast<IfStatementAst>(root);
+                IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(root);
                 if (ptr) {
                     std::cout << "If" << std::endl;                                   
                     printTree(ptr->testPart(), count);
@@ -30,7 +31,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kRepeat: {
-                RepeatStatementAstPtr ptr = std::dynamic_pointer_cast<RepeatStatementAst>(root);
+                RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(root);
                 if (ptr) {
                     std::cout << "Repeat" << std::endl;   
                     printTree(ptr->bodyPart(), count);
@@ -40,7 +41,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kAssign: {
-                AssignStatementAstPtr ptr = std::dynamic_pointer_cast<AssignStatementAst>(root);
+                AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(root);
                 if (ptr) {
                     std::cout << "Assign to: " << ptr->variable()->name() << std::endl;
                     printTree(ptr->expression(), count);
@@ -49,7 +50,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kRead: {
-                ReadStatementAstPtr ptr = std::dynamic_pointer_cast<ReadStatementAst>(root);
+                ReadStatementAstPtr ptr = static_cast<ReadStatementAstPtr>(root);
                 if (ptr) {
                     std::cout << "Read: " << ptr->variable()->name() << std::endl;   
                 }
@@ -57,7 +58,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kWrite: {
-                WriteStatementAstPtr ptr = std::dynamic_pointer_cast<WriteStatementAst>(root);
+                WriteStatementAstPtr ptr = static_cast<WriteStatementAstPtr>(root);
                 if (ptr) {
                     std::cout << "Write" << std::endl;
                     printTree(ptr->expression(), count);
@@ -66,7 +67,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kExpression: {
-                ExpressionAstPtr ptr = std::dynamic_pointer_cast<ExpressionAst>(root);
+                ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(root);
                 if (ptr) {
                     std::cout << "Op: " << ptr->operatorName() << std::endl;
                     printTree(ptr->leftPart(), count);
@@ -76,7 +77,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kConstant: {
-                ConstantAstPtr ptr = std::dynamic_pointer_cast<ConstantAst>(root);
+                ConstantAstPtr ptr = static_cast<ConstantAstPtr>(root);
                 if (ptr) {
                     std::cout << "const: " << ptr->intValue() << std::endl;   
                 }
@@ -84,7 +85,7 @@ void printTree(AstPtr root, int& count) {
             }
 
             case AstType::kVariable: {
-                VariableAstPtr ptr = std::dynamic_pointer_cast<VariableAst>(root);
+                VariableAstPtr ptr = static_cast<VariableAstPtr>(root);
                 if (ptr) {
                     std::cout << "Id: " << ptr->name() << std::endl;                   
                 }
@@ -101,10 +102,81 @@ void printTree(AstPtr root, int& count) {
     count -= 4;
 }
 
+bool sameTree(AstPtr lhs, AstPtr rhs);
+
+bool sameNode(AstPtr lhs, AstPtr rhs) {
+    if (lhs->getAstType() != rhs->getAstType() ||
+        lhs->getTokenLocation().offset() != rhs->getTokenLocation().offset()) {
+        return false;
+    }
+    switch (lhs->getAstType()) {
+        case AstType::kIf: {
+            IfStatementAstPtr l = static_cast<IfStatementAstPtr>(lhs);
+            IfStatementAstPtr r = static_cast<IfStatementAstPtr>(rhs);
+            return sameTree(l->testPart(), r->testPart()) && sameTree(l->thenPart(), r->thenPart()) &&
+                   sameTree(l->elsePart(), r->elsePart());
+        }
+
+        case AstType::kRepeat: {
+            RepeatStatementAstPtr l = static_cast<RepeatStatementAstPtr>(lhs);
+            RepeatStatementAstPtr r = static_cast<RepeatStatementAstPtr>(rhs);
+            return sameTree(l->bodyPart(), r->bodyPart()) && sameTree(l->testPart(), r->testPart());
+        }
+
+        case AstType::kAssign: {
+            AssignStatementAstPtr l = static_cast<AssignStatementAstPtr>(lhs);
+            AssignStatementAstPtr r = static_cast<AssignStatementAstPtr>(rhs);
+            return sameTree(l->variable(), r->variable()) && sameTree(l->expression(), r->expression());
+        }
+
+        case AstType::kRead:
+            return sameTree(static_cast<ReadStatementAstPtr>(lhs)->variable(), 
+                            static_cast<ReadStatementAstPtr>(rhs)->variable());
+
+        case AstType::kWrite:
+            return sameTree(static_cast<WriteStatementAstPtr>(lhs)->expression(), 
+                            static_cast<WriteStatementAstPtr>(rhs)->expression());
+
+        case AstType::kExpression: {
+            ExpressionAstPtr l = static_cast<ExpressionAstPtr>(lhs);
+            ExpressionAstPtr r = static_cast<ExpressionAstPtr>(rhs);
+            return l->operatorTokenValue() == r->operatorTokenValue() &&
+                   sameTree(l->leftPart(), r->leftPart()) && sameTree(l->rightPart(), r->rightPart());
+        }
+
+        case AstType::kConstant:
+            return static_cast<ConstantAstPtr>(lhs)->intValue() == static_cast<ConstantAstPtr>(rhs)->intValue();
+
+        case AstType::kVariable:
+            return static_cast<VariableAstPtr>(lhs)->name() == static_cast<VariableAstPtr>(rhs)->name();
+
+        default:
+            return true;
+    }
+}
+
+bool sameTree(AstPtr lhs, AstPtr rhs) {
+    for (; lhs != nullptr && rhs != nullptr; lhs = lhs->next(), rhs = rhs->next()) {
+        if (!sameNode(lhs, rhs)) {
+            return false;
+        }
+    }
+    return lhs == rhs;
+}
+
 int main(int argc, char* argv[]) {
     Scanner scanner("test.tiny");
     Parser parser(scanner);
+    AstPtr root = parser.parse();
     int count = -4;
-    printTree(parser.parse(), count);
+    printTree(root, count);
+
+    // one chunk per top-level statement
+    Scanner parallel_scanner("test.tiny");
+    ParallelParser parallel_parser(parallel_scanner, 4);
+    parallel_parser.setMinChunkSize(1);
+    AstPtr parallel_root = parallel_parser.parse();
+    std::cout << "Parallel parse: " << parallel_parser.chunkCount() << " chunks, "
+              << (sameTree(root, parallel_root) ? "same tree" : "different tree") << std::endl;
     return 0;
 }
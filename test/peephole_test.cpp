@@ -0,0 +1,145 @@
+#include "line_table.h"
+#include "peephole.h"
+#include "test_support.h"
+#include "tm_code.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using nova::PeepholeRule;
+using nova::Register;
+using nova::TmCode;
+using nova::TmInstruction;
+
+const Register ac = Register::ac;
+const Register ac1 = Register::ac1;
+const Register gp = Register::gp;
+const Register mp = Register::mp;
+const Register pc = Register::pc;
+
+TmInstruction ro(const char* op, Register r, Register s, Register t) {
+    TmInstruction ins;
+    ins.op = op;
+    ins.register_only = true;
+    ins.r = r;
+    ins.s = s;
+    ins.t = t;
+    return ins;
+}
+
+TmInstruction rm(const char* op, Register r, int64_t d, Register s) {
+    TmInstruction ins;
+    ins.op = op;
+    ins.r = r;
+    ins.d = d;
+    ins.s = s;
+    return ins;
+}
+
+TmInstruction out(Register r) {
+    return ro("OUT", r, ac, ac);
+}
+
+TmInstruction halt() {
+    return ro("HALT", ac, ac, ac);
+}
+
+struct Case {
+    const char* name;
+    PeepholeRule rule;
+    size_t window;
+    TmCode code;  // jumps by their offset
+};
+
+std::vector<Case> cases() {
+    return {
+        {"store-load into another register", PeepholeRule::kStoreLoad, 4,
+         {rm("LDC", ac, 7, ac), rm("ST", ac, 0, gp), rm("LD", ac1, 0, gp), out(ac1), halt()}},
+        {"store-load into the same register", PeepholeRule::kStoreLoad, 4,
+         {rm("LDC", ac, 7, ac), rm("ST", ac, 0, gp), out(ac), rm("LD", ac, 0, gp), out(ac), halt()}},
+        {"store-load, the register stored changes", PeepholeRule::kStoreLoad, 4,
+         {rm("LDC", ac, 7, ac), rm("ST", ac, 0, gp), rm("LDC", ac, 1, ac), rm("LD", ac1, 0, gp), out(ac1), halt()}},
+        {"store-load, the load is jumped to", PeepholeRule::kStoreLoad, 4,
+         {rm("LDC", ac, 2, ac), rm("ST", ac, 0, gp), rm("LD", ac1, 0, gp), rm("LDC", ac, 1, ac),
+          ro("SUB", ac1, ac1, ac), rm("ST", ac1, 0, gp), out(ac1), rm("JNE", ac1, -6, pc), halt()}},
+        {"push-pop, the value stays in its register", PeepholeRule::kPushPop, 4,
+         {rm("LDC", ac, 5, ac), rm("ST", ac, 0, mp), out(ac), rm("LD", ac1, 0, mp), out(ac1), halt()}},
+        {"push-pop, the value moves at the push", PeepholeRule::kPushPop, 4,
+         {rm("LDC", ac, 5, ac), rm("ST", ac, 0, mp), rm("LDC", ac, 2, ac), rm("LD", ac1, 0, mp),
+          ro("SUB", ac, ac1, ac), out(ac), halt()}},
+        {"push-pop, both registers are used", PeepholeRule::kPushPop, 4,
+         {rm("LDC", ac, 5, ac), rm("ST", ac, 0, mp), rm("LDC", ac, 2, ac), rm("LDC", ac1, 1, ac),
+          ro("ADD", ac, ac, ac1), rm("LD", ac1, 0, mp), ro("SUB", ac, ac1, ac), out(ac), halt()}},
+        {"push-pop, beyond the window", PeepholeRule::kPushPop, 4,
+         {rm("LDC", ac, 5, ac), rm("ST", ac, 0, mp), rm("LDC", ac, 1, ac), rm("LDC", ac, 2, ac),
+          rm("LDC", ac, 3, ac), rm("LDC", ac, 4, ac), rm("LD", ac1, 0, mp), ro("SUB", ac, ac1, ac), out(ac), halt()}},
+        {"push-pop, within a wider window", PeepholeRule::kPushPop, 8,
+         {rm("LDC", ac, 5, ac), rm("ST", ac, 0, mp), rm("LDC", ac, 1, ac), rm("LDC", ac, 2, ac),
+          rm("LDC", ac, 3, ac), rm("LDC", ac, 4, ac), rm("LD", ac1, 0, mp), ro("SUB", ac, ac1, ac), out(ac), halt()}},
+        {"jump-to-next", PeepholeRule::kJumpToNext, 4,
+         {rm("LDC", ac, 1, ac), rm("LDA", pc, 0, pc), out(ac), rm("JEQ", ac, 0, pc), out(ac), halt()}},
+        {"jump-chain", PeepholeRule::kJumpChain, 4,
+         {rm("LDC", ac, 0, ac), rm("JEQ", ac, 2, pc), out(ac), halt(), rm("LDA", pc, 1, pc), out(ac),
+          rm("LDC", ac, 3, ac), out(ac), halt()}},
+        {"jump-chain through two jumps", PeepholeRule::kJumpChain, 4,
+         {rm("LDC", ac, 0, ac), rm("JEQ", ac, 2, pc), out(ac), halt(), rm("LDA", pc, 1, pc), halt(),
+          rm("LDA", pc, 1, pc), halt(), rm("LDC", ac, 3, ac), out(ac), halt()}},
+        {"jump-chain, a loop back to the jump", PeepholeRule::kJumpChain, 4,
+         {rm("LDC", ac, 3, ac), rm("LDC", ac1, 1, ac), out(ac), ro("SUB", ac, ac, ac1), rm("JEQ", ac, 1, pc),
+          rm("LDA", pc, -5, pc), halt()}},
+        {"unreachable", PeepholeRule::kUnreachable, 4,
+         {rm("LDC", ac, 1, ac), rm("LDA", pc, 2, pc), rm("LDC", ac, 9, ac), out(ac), out(ac), halt(), out(ac)}},
+    };
+}
+
+std::string listing(const TmCode& code) {
+    std::ostringstream os;
+    nova::LineTable line_table;
+    nova::writeTmCode(os, code, false, line_table);
+    return os.str();
+}
+
+// the output of the code on the VM
+std::string run(const TmCode& code) {
+    return nova::test::runCode(listing(code)).output;
+}
+
+// Runs the rule of the case alone, then all the rules, neither may change
+// what the code writes.
+void testCase(nova::test::Checks& checks, const Case& test_case) {
+    TmCode code = test_case.code;
+    nova::resolveTargets(code);
+    nova::PeepholeOptions options;
+    options.rules = nova::PeepholeOptions::bit(test_case.rule);
+    options.window = test_case.window;
+    nova::PeepholeOptimizer optimizer(options);
+    TmCode optimized = code;
+    optimizer.optimize(optimized);
+
+    nova::PeepholeOptimizer all;
+    TmCode all_optimized = code;
+    all.optimize(all_optimized);
+
+    std::string expected = run(code);
+    bool same = run(optimized) == expected;
+    bool same_all = run(all_optimized) == expected;
+    checks.check(same && same_all);
+    std::cout << test_case.name << "\n" << listing(optimized) << "    " << nova::PeepholeOptimizer::ruleName(test_case.rule)
+              << " " << optimizer.hits(test_case.rule) << ", " << code.size() << " -> " << optimized.size()
+              << " instructions, " << (same ? "same output" : "different output") << ", "
+              << (same_all ? "same output" : "different output") << " with all rules" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    nova::test::Checks checks;
+    for (const Case& test_case : cases()) {
+        testCase(checks, test_case);
+    }
+    return checks.exitCode();
+}
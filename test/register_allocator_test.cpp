@@ -0,0 +1,90 @@
+#include "register_allocator.h"
+#include "test_support.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using nova::LiveInterval;
+using nova::Register;
+
+struct Case {
+    const char* name;
+    std::vector<LiveInterval> intervals;
+    std::vector<Register> expected;
+};
+
+const Register r2 = Register::r2;
+const Register r3 = Register::r3;
+const Register r4 = Register::r4;
+const Register memory = Register::invalid;
+
+std::vector<Case> cases() {
+    return {
+        // [0, 2] ends before [3, 4] starts, its register is free again; the
+        // end is inclusive, [2, 6] still overlaps [0, 2]
+        {"reuse after expiry",
+         {{0, 2, 1}, {2, 6, 1}, {3, 4, 1}},
+         {r2, r3, r2}},
+        {"reuse by several",
+         {{0, 1, 1}, {0, 2, 1}, {0, 3, 1}, {2, 3, 1}, {4, 5, 1}, {4, 6, 1}},
+         {r2, r3, r4, r2, r2, r3}},
+        // all 3 registers busy, the lightest of the active intervals and the
+        // new one goes to memory
+        {"spill an active interval",
+         {{0, 9, 4}, {1, 9, 2}, {2, 9, 3}, {3, 9, 5}},
+         {r2, memory, r4, r3}},
+        {"spill the new interval",
+         {{0, 9, 4}, {1, 9, 2}, {2, 9, 3}, {3, 9, 1}},
+         {r2, r3, r4, memory}},
+        // an interval no heavier than every active one does not evict any
+        {"equal weights",
+         {{0, 9, 1}, {1, 9, 1}, {2, 9, 1}, {3, 9, 1}, {4, 9, 1}},
+         {r2, r3, r4, memory, memory}},
+        // of two equally light active intervals the one that started first
+        // goes to memory
+        {"equally light active intervals",
+         {{0, 9, 1}, {1, 9, 3}, {2, 9, 1}, {3, 9, 2}},
+         {memory, r3, r4, r2}},
+        // intervals starting together are taken shortest first, wherever
+        // they are in the input
+        {"same start",
+         {{0, 5, 1}, {0, 2, 1}, {0, 8, 1}, {3, 4, 1}},
+         {r3, r2, r4, r2}},
+        {"same start, spilled",
+         {{0, 7, 3}, {0, 5, 1}, {0, 6, 1}, {0, 4, 2}},
+         {r3, memory, r4, r2}},
+    };
+}
+
+std::string name(Register r) {
+    return r == Register::invalid ? "memory" : "r" + std::to_string(static_cast<int>(r));
+}
+
+void testCase(nova::test::Checks& checks, const Case& test_case) {
+    nova::RegisterAllocator allocator({r2, r3, r4});
+    std::vector<Register> allocated = allocator.allocate(test_case.intervals);
+    // the same intervals give the same registers every time
+    bool same = checks.check(allocator.allocate(test_case.intervals) == allocated);
+    bool expected = checks.check(allocated == test_case.expected);
+    std::cout << test_case.name << "\n   ";
+    for (size_t i = 0; i < allocated.size(); ++i) {
+        const LiveInterval& interval = test_case.intervals[i];
+        std::cout << " [" << interval.start << ", " << interval.end << "]:" << interval.weight << " "
+                  << name(allocated[i]);
+    }
+    std::cout << "\n    " << (expected ? "expected" : "unexpected") << ", " << (same ? "same" : "different")
+              << " when allocated again" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    nova::test::Checks checks;
+    for (const Case& test_case : cases()) {
+        testCase(checks, test_case);
+    }
+    return checks.exitCode();
+}
@@ -0,0 +1,105 @@
+#include "analysis.h"
+#include "compiler.h"
+#include "error.h"
+#include "file_table.h"
+#include "parser.h"
+#include "simplifier.h"
+#include "test_support.h"
+
+#include <string.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// A program and its statements after the simplifier. Every program writes
+// what it computes, none of them reads.
+struct Case {
+    const char* program;
+    const char* simplified;
+};
+
+const Case kCases[] = {
+    {"write 2 * 3",
+     "write 6"},
+    // the constant goes to the right of + and *
+    {"y := 4; x := 2 * 3 + y * 1; write x",
+     "y := 4; x := y + 6; write x"},
+    {"x := 7; write x * 1; write 1 * x; write x + 0; write 0 + x; write x - 0; write x / 1",
+     "x := 7; write x; write x; write x; write x; write x; write x"},
+    {"x := 7; write x * 0; write x - x; if x < x then write 1 end; if x = x then write 2 end",
+     "x := 7; write 0; write 0; if 0 then write 1 end; if 1 then write 2 end"},
+    {"x := 7; write (x + 1) + 2; write (x - 1) - 2; write 3 + (x - 5); write (x * 2) * 3",
+     "x := 7; write x + 3; write x - 3; write x - 2; write x * 6"},
+    // wrapping around as the TM machine does, but -2^31 is not folded, LDC
+    // can not load it
+    {"x := 2147483647; write x + 1; write 2147483647 + 1; write 65536 * 65536; write 2147483647 * 2",
+     "x := 2147483647; write x + 1; write 2147483647 + 1; write 0; write -2"},
+    // a < b is the sign of a - b, which wraps around as well
+    {"if 0 - 2147483647 - 1 < 1 then write 1 end; if 2147483647 < 0 - 1 then write 2 end",
+     "if (-2147483647 - 1) < 1 then write 1 end; if 1 then write 2 end"},
+    {"write 7 / 2; write 0 - 7 / 2; write 7 / (0 - 2)",
+     "write 3; write -3; write -3"},
+    {"x := 5; if 1 < 2 then write x * (3 - 2) else write 0 end",
+     "x := 5; if 1 then write x else write 0 end"},
+    {"x := 3; repeat x := x - 1 + 0 until x * 1 = 0; write x",
+     "x := 3; repeat x := x - 1 until x = 0; write x"},
+    // the divisions that trap stay, and so do the operands that contain one
+    {"write 1; write 1 / 0; write 2",
+     "write 1; write 1 / 0; write 2"},
+    {"x := 0 - 2147483647 - 1; write 1; write x / (0 - 1); write 2",
+     "x := -2147483647 - 1; write 1; write x / -1; write 2"},
+    {"write (0 - 2147483647 - 1) / (0 - 1)",
+     "write (-2147483647 - 1) / -1"},
+    {"x := 0; write (1 / x) * 0",
+     "x := 0; write (1 / x) * 0"},
+    {"x := 0; write (1 / x) - (1 / x)",
+     "x := 0; write (1 / x) - (1 / x)"},
+};
+
+// the program after the simplifier alone
+std::string simplify(const char* program) {
+    nova::clearErrorFlags();
+    nova::Scanner scanner("<program>", std::string(program));
+    nova::AstContext context;
+    nova::Parser parser(scanner, context);
+    nova::AstPtr root = parser.parse();
+    nova::Analysis analysis(root);
+    analysis.useSymbolTable(parser.symbolTable());
+    nova::Simplifier simplifier(context);
+    analysis.analyze(simplifier);
+    std::string text = nova::test::sourceText(root);
+    nova::FileTable::instance().remove(scanner.fileId());
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    nova::test::Checks checks;
+    for (const Case& test_case : kCases) {
+        const char* program = test_case.program;
+        std::string simplified = simplify(program);
+        bool expected = checks.check(simplified == test_case.simplified);
+
+        // and the whole optimizing compiler writes what the plain one does
+        nova::CompileOptions options;
+        options.jobs = 1;
+        options.optimize = false;
+        std::ostringstream plain;
+        bool compiled = nova::compileSource("<program>", program, strlen(program), options, plain);
+        options.optimize = true;
+        std::ostringstream optimized;
+        compiled = nova::compileSource("<program>", program, strlen(program), options, optimized) && compiled;
+
+        std::string output = nova::test::runCode(plain.str()).output;
+        bool same = checks.check(compiled && nova::test::runCode(optimized.str()).output == output);
+        std::cout << program << "\n    " << simplified << "\n    "
+                  << (expected ? "expected" : "unexpected") << ", " << (same ? "same output" : "different output")
+                  << ", " << nova::test::instructionCount(plain.str()) << " -> "
+                  << nova::test::instructionCount(optimized.str()) << " instructions" << std::endl;
+    }
+    return checks.exitCode();
+}
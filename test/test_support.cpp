@@ -0,0 +1,135 @@
+#include "test_support.h"
+
+#include "metrics.h"
+#include "vm.h"
+
+#include <ctype.h>
+
+#include <iostream>
+#include <sstream>
+
+namespace nova {
+
+namespace test {
+
+VmRun runCode(const std::string& code, const std::string& input) {
+    std::istringstream is(input);
+    std::ostringstream output;
+    std::streambuf* saved_in = std::cin.rdbuf(is.rdbuf());
+    std::streambuf* saved_out = std::cout.rdbuf(output.rdbuf());
+    std::streambuf* saved_err = std::cerr.rdbuf(output.rdbuf());
+    vm::VirtualMachine vm(code);
+    vm.buildInstructions();
+    vm.enableMetrics();
+    vm.run();
+    std::cin.rdbuf(saved_in);
+    std::cout.rdbuf(saved_out);
+    std::cerr.rdbuf(saved_err);
+
+    VmRun result;
+    result.output = output.str();
+    for (size_t pc = result.output.find("pc "); pc != std::string::npos; pc = result.output.find("pc ", pc)) {
+        result.output.erase(pc, result.output.find(':', pc) + 1 - pc);
+    }
+    result.instructions = vm.metrics().instructions_retired;
+    return result;
+}
+
+namespace {
+
+void writeExpression(std::ostream& os, AstPtr node, bool nested) {
+    switch (node->getAstType()) {
+        case AstType::kConstant:
+            os << static_cast<ConstantAstPtr>(node)->intValue();
+            return;
+
+        case AstType::kVariable:
+            os << static_cast<VariableAstPtr>(node)->name();
+            return;
+
+        default:
+            break;
+    }
+    ExpressionAstPtr ptr = static_cast<ExpressionAstPtr>(node);
+    if (ptr->rightPart() == nullptr) {
+        writeExpression(os, ptr->leftPart(), nested);
+        return;
+    }
+    os << (nested ? "(" : "");
+    writeExpression(os, ptr->leftPart(), true);
+    os << ' ' << ptr->operatorName() << ' ';
+    writeExpression(os, ptr->rightPart(), true);
+    os << (nested ? ")" : "");
+}
+
+void writeStatements(std::ostream& os, AstPtr node) {
+    for (; node != nullptr; node = node->next()) {
+        switch (node->getAstType()) {
+            case AstType::kIf: {
+                IfStatementAstPtr ptr = static_cast<IfStatementAstPtr>(node);
+                os << "if ";
+                writeExpression(os, ptr->testPart(), false);
+                os << " then ";
+                writeStatements(os, ptr->thenPart());
+                if (ptr->elsePart() != nullptr) {
+                    os << " else ";
+                    writeStatements(os, ptr->elsePart());
+                }
+                os << " end";
+                break;
+            }
+
+            case AstType::kRepeat: {
+                RepeatStatementAstPtr ptr = static_cast<RepeatStatementAstPtr>(node);
+                os << "repeat ";
+                writeStatements(os, ptr->bodyPart());
+                os << " until ";
+                writeExpression(os, ptr->testPart(), false);
+                break;
+            }
+
+            case AstType::kAssign: {
+                AssignStatementAstPtr ptr = static_cast<AssignStatementAstPtr>(node);
+                os << ptr->variable()->name() << " := ";
+                writeExpression(os, ptr->expression(), false);
+                break;
+            }
+
+            case AstType::kRead:
+                os << "read " << static_cast<ReadStatementAstPtr>(node)->variable()->name();
+                break;
+
+            case AstType::kWrite:
+                os << "write ";
+                writeExpression(os, static_cast<WriteStatementAstPtr>(node)->expression(), false);
+                break;
+
+            default:
+                break;
+        }
+        os << (node->next() != nullptr ? "; " : "");
+    }
+}
+
+} // namespace
+
+std::string sourceText(AstPtr statements) {
+    std::ostringstream os;
+    writeStatements(os, statements);
+    return os.str();
+}
+
+size_t instructionCount(const std::string& code) {
+    size_t count = 0;
+    std::istringstream is(code);
+    for (std::string line; std::getline(is, line);) {
+        if (!line.empty() && isdigit(static_cast<unsigned char>(line[0]))) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // namespace test
+
+} // namespace nova
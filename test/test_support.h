@@ -0,0 +1,54 @@
+#ifndef __NOVA_TEST_SUPPORT_H__
+#define __NOVA_TEST_SUPPORT_H__
+
+#include <stdint.h>
+
+#include <string>
+
+#include "ast.h"
+
+namespace nova {
+
+namespace test {
+
+struct VmRun {
+    std::string output;     // and the traps, without their pc
+    uint64_t instructions;  // executed
+};
+
+// Runs TM code on the VM, its reads taking the numbers of input. The pc of
+// a trap is left out of the output, it differs between two compilations of
+// one program.
+VmRun runCode(const std::string& code, const std::string& input = std::string());
+
+// the instructions in a TM listing
+size_t instructionCount(const std::string& code);
+
+// The statements as TINY source on one line, an operand that is an
+// operation in parentheses. Shows the shape the AST passes leave.
+std::string sourceText(AstPtr statements);
+
+// Counts the checks that failed, main() returns exitCode() so a mismatch
+// fails the build rather than only being printed.
+class Checks {
+public:
+    Checks()
+        : failed_(0) {
+    }
+
+    // ok, counted when false
+    bool check(bool ok) {
+        failed_ += ok ? 0 : 1;
+        return ok;
+    }
+    int exitCode() const { return failed_ == 0 ? 0 : 1; }
+
+private:
+    int failed_;
+};
+
+} // namespace test
+
+} // namespace nova
+
+#endif
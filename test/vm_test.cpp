@@ -9,8 +9,7 @@ int main(int argc, char* argv[]) {
     nova::Parser parser(scanner);
     nova::AstPtr root = parser.parse();
     nova::Analysis analysis(root);
-    analysis.buildSymbolTable();
-    analysis.typeCheck();
+    analysis.analyze();
     nova::CodeGenerator generator(analysis, root, "test.tiny", true);
     nova::CodeBuffer code =  generator.generateCode();
     nova::vm::VirtualMachine vm(code);